@@ -2,7 +2,7 @@
 
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 normal;
-layout(location = 2) in vec2 texCoord;
+layout(location = 2) in vec2 texCoord;  // 蛇身時是 (s, around)，見 main.cpp 的 createSnakeTubeMesh
 
 uniform mat4 Projection;
 uniform mat4 ViewMatrix;
@@ -11,6 +11,12 @@ uniform mat4 TIModelMatrix;
 uniform mat4 lightSpaceMatrix;
 uniform mat4 spotLightSpaceMatrix;
 
+// 蛇身：tubeCenters 從 tubeBase 開始的 tubeCount 個 texel 是質點（xyz 位置，w 半徑），頭在第 0 個
+uniform bool tubeSkinned;
+uniform samplerBuffer tubeCenters;
+uniform int tubeBase;
+uniform int tubeCount;
+
 out vec2 TexCoord;
 out vec3 Normal;
 out vec3 FragPos;
@@ -19,12 +25,48 @@ out vec4 FragPosSpotLightSpace;
 
 // TODO#3-3: vertex shader
 
+vec4 tubeCenter(int i) { return texelFetch(tubeCenters, tubeBase + clamp(i, 0, tubeCount - 1)); }
+
+vec3 safeNormalize(vec3 v, vec3 fallback) { return dot(v, v) > 1e-12 ? normalize(v) : fallback; }
+
+// s 從 -1 到 tubeCount：0 到 tubeCount - 1 之間沿著質點的曲線走，超出的兩端各是一個半球蓋；
+// around 從 0 到 1 繞一圈。回傳表面上的點，n 是朝外的單位法線（shadow.vert 有同一份）
+vec3 skinTube(float s, float around, out vec3 n) {
+    float last = float(tubeCount - 1);
+    float cs = clamp(s, 0.0, last);
+    int i = min(int(cs), max(tubeCount - 2, 0));
+    float f = cs - float(i);
+    // 通過質點的 Catmull-Rom 曲線（半徑也一起內插），切線是它的導數；兩端的控制點重複最後一個
+    vec4 p0 = tubeCenter(i - 1), p1 = tubeCenter(i), p2 = tubeCenter(i + 1), p3 = tubeCenter(i + 2);
+    vec4 a = 2.0 * p0 - 5.0 * p1 + 4.0 * p2 - p3;
+    vec4 b = -p0 + 3.0 * p1 - 3.0 * p2 + p3;
+    vec4 c = 0.5 * (2.0 * p1 + (p2 - p0) * f + a * f * f + b * f * f * f);
+    vec3 t = safeNormalize(0.5 * (p2 - p0).xyz + a.xyz * f + 1.5 * b.xyz * f * f, vec3(1.0, 0.0, 0.0));
+
+    vec3 up = abs(t.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
+    vec3 side = normalize(up - dot(up, t) * t);
+    float theta = around * 6.28318531;
+    vec3 radial = cos(theta) * side + sin(theta) * cross(t, side);
+
+    float cap = (s < 0.0 ? -s : max(s - last, 0.0)) * 1.57079633;
+    n = cos(cap) * radial + (s < 0.0 ? -1.0 : 1.0) * sin(cap) * t;
+    return c.xyz + c.w * n;
+}
 
 void main() {
-    FragPos = vec3(ModelMatrix * vec4(position, 1.0));
-    Normal = mat3(TIModelMatrix) * normal;
-    TexCoord = texCoord;
+    vec3 p = position;
+    vec3 nrm = normal;
+    vec2 uv = texCoord;
+    if (tubeSkinned) {
+        // 第 k 個實例是 s = k - 1 到 k；頭用貼圖左半邊，身體用右半邊
+        float s = float(gl_InstanceID) - 1.0 + texCoord.x;
+        p = skinTube(s, texCoord.y, nrm);
+        uv = vec2(texCoord.y * 0.5 + (s < 0.5 ? 0.0 : 0.5), texCoord.x);
+    }
+    FragPos = vec3(ModelMatrix * vec4(p, 1.0));
+    Normal = mat3(TIModelMatrix) * nrm;
+    TexCoord = uv;
     FragPosLightSpace = lightSpaceMatrix * vec4(FragPos, 1.0);
     FragPosSpotLightSpace = spotLightSpaceMatrix * vec4(FragPos, 1.0);  // ✅ 新增
-    gl_Position = Projection * ViewMatrix * ModelMatrix * vec4(position, 1.0);
+    gl_Position = Projection * ViewMatrix * ModelMatrix * vec4(p, 1.0);
 }
\ No newline at end of file
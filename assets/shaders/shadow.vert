@@ -1,10 +1,49 @@
 #version 430
 
 layout(location = 0) in vec3 position;
+layout(location = 2) in vec2 texCoord;
 
 uniform mat4 lightSpaceMatrix;
 uniform mat4 ModelMatrix;
 
+// 蛇身，見 light.vert
+uniform bool tubeSkinned;
+uniform samplerBuffer tubeCenters;
+uniform int tubeBase;
+uniform int tubeCount;
+
+vec4 tubeCenter(int i) { return texelFetch(tubeCenters, tubeBase + clamp(i, 0, tubeCount - 1)); }
+
+vec3 safeNormalize(vec3 v, vec3 fallback) { return dot(v, v) > 1e-12 ? normalize(v) : fallback; }
+
+// 和 light.vert 的 skinTube 相同
+vec3 skinTube(float s, float around, out vec3 n) {
+    float last = float(tubeCount - 1);
+    float cs = clamp(s, 0.0, last);
+    int i = min(int(cs), max(tubeCount - 2, 0));
+    float f = cs - float(i);
+    // 通過質點的 Catmull-Rom 曲線（半徑也一起內插），切線是它的導數；兩端的控制點重複最後一個
+    vec4 p0 = tubeCenter(i - 1), p1 = tubeCenter(i), p2 = tubeCenter(i + 1), p3 = tubeCenter(i + 2);
+    vec4 a = 2.0 * p0 - 5.0 * p1 + 4.0 * p2 - p3;
+    vec4 b = -p0 + 3.0 * p1 - 3.0 * p2 + p3;
+    vec4 c = 0.5 * (2.0 * p1 + (p2 - p0) * f + a * f * f + b * f * f * f);
+    vec3 t = safeNormalize(0.5 * (p2 - p0).xyz + a.xyz * f + 1.5 * b.xyz * f * f, vec3(1.0, 0.0, 0.0));
+
+    vec3 up = abs(t.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
+    vec3 side = normalize(up - dot(up, t) * t);
+    float theta = around * 6.28318531;
+    vec3 radial = cos(theta) * side + sin(theta) * cross(t, side);
+
+    float cap = (s < 0.0 ? -s : max(s - last, 0.0)) * 1.57079633;
+    n = cos(cap) * radial + (s < 0.0 ? -1.0 : 1.0) * sin(cap) * t;
+    return c.xyz + c.w * n;
+}
+
 void main() {
-    gl_Position = lightSpaceMatrix * ModelMatrix * vec4(position, 1.0);
+    vec3 p = position;
+    if (tubeSkinned) {
+        vec3 n;
+        p = skinTube(float(gl_InstanceID) - 1.0 + texCoord.x, texCoord.y, n);
+    }
+    gl_Position = lightSpaceMatrix * ModelMatrix * vec4(p, 1.0);
 }
\ No newline at end of file
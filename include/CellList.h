@@ -0,0 +1,43 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+/**
+ * 均勻格子的鄰居搜尋（cell list）
+ *
+ * build() 用計數排序把點依所在格子排好：
+ *   getOrder()[k]      排序後第 k 個點的原始索引
+ *   getCellBegin(c)    格子 c 在排序後陣列的起點
+ *   getCellEnd(c)      格子 c 的終點（不含）
+ * 超出範圍的點會被夾到最外圈的格子，搜尋時仍然用實際距離判斷，只是效率差一點。
+ */
+class CellList {
+ public:
+  CellList(const glm::vec3& boundsMin, const glm::vec3& boundsMax, float cellSize);
+
+  void build(const float* xs, const float* ys, const float* zs, int count);
+
+  glm::ivec3 cellCoord(float x, float y, float z) const {
+    glm::ivec3 c = glm::ivec3(glm::floor((glm::vec3(x, y, z) - boundsMin) * invCellSize));
+    return glm::clamp(c, glm::ivec3(0), dims - 1);
+  }
+  int cellIndex(const glm::ivec3& c) const { return (c.z * dims.y + c.y) * dims.x + c.x; }
+
+  const std::vector<int>& getOrder() const { return order; }
+  int getCellBegin(int cell) const { return cellStart[cell]; }
+  int getCellEnd(int cell) const { return cellStart[cell + 1]; }
+  glm::ivec3 getDims() const { return dims; }
+  float getCellSize() const { return cellSize; }
+  glm::vec3 getBoundsMin() const { return boundsMin; }
+
+ private:
+  glm::vec3 boundsMin;
+  float cellSize;
+  float invCellSize;
+  glm::ivec3 dims;
+
+  std::vector<int> cellOf;     // 每個點所在的格子
+  std::vector<int> cellStart;  // 大小為格子數 + 1
+  std::vector<int> order;
+};
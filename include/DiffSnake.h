@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "GaitSweep.h"
+#include "utils.h"
+
+namespace gait {
+
+/**
+ * 可微分的直線蠕動模擬，用反向模式（adjoint）算一回合前進距離對步態與彈簧參數的梯度
+ *
+ * 與 Snake::update 在 RECTILINEAR、EXPLICIT 下的力相同（重力、軸向彈簧、肌肉改變靜止長度、摩擦），
+ * 全部用 double 與半隱式 Euler，但把不可微分的地方換成平滑的版本：
+ *   - 地面碰撞（夾住高度、反彈）-> softplus 的穿透彈簧加上接觸阻尼
+ *   - 消去向後速度 -> 只在往後滑時作用的 softplus 黏滯力
+ *   - 等向庫侖摩擦的 normalize(v) -> v / sqrt(|v|^2 + eps^2)
+ *   - 彈簧與身體切線的 normalize(d) -> 同上，兩個質點重疊時不會跳號
+ *   - 肌肉的靜止長度 -> 用 softplus 夾在正的最小值以上（振幅大時 s0 (1 - A sin) 會是負的）
+ * 所以數值與 Snake 接近但不會完全一樣，適合拿梯度找方向，最後仍要用 evaluate() 確認。
+ *
+ * 反向傳遞時每隔 checkpointInterval 步存一次狀態，倒著一段一段重算前向再往回傳，
+ * 記憶體是 O(步數 / interval + interval) 個狀態，時間大約是一次前向的 3 倍。
+ */
+class DiffSnake {
+ public:
+  enum Param { SPRING_K, DAMPING, WAVE_AMPLITUDE, WAVE_FREQUENCY, GROUND_FRICTION, NUM_PARAMS };
+
+  struct Result {
+    double distance = 0.0;                     // 質心沿起始前進方向移動的距離，單位：m
+    std::array<double, NUM_PARAMS> gradient{};  // d distance / d 參數，只有 gradient() 會填
+    bool valid = true;          // false 時前向發散或梯度爆掉，gradient 全是 0，不可以拿去用
+    int steps = 0;
+    int checkpoints = 0;        // 存下來的狀態數（含起點）
+    size_t stateBytes = 0;      // 檢查點與重算用的緩衝區加起來的大小
+    double forwardMs = 0.0;
+    double backwardMs = 0.0;    // 包含重算前向
+  };
+
+  // numSegments 決定蛇的大小；checkpointInterval 為 0 時用 sqrt(步數)
+  DiffSnake(int numSegments, const EvalSettings& settings, int checkpointInterval = 0);
+  DELETE_COPY(DiffSnake)
+
+  // 只跑前向
+  Result rollout(const GaitParams& params);
+  // 前向加上反向，params.numSegments 會被忽略。發散或梯度爆掉時印 [ERROR] 並把 Result::valid 設成 false
+  Result gradient(const GaitParams& params);
+
+  int getNumSteps() const { return numSteps; }
+  int getCheckpointInterval() const { return interval; }
+  static const char* getParamName(int param);
+
+ private:
+  struct Coefficients {
+    double springK, damping, amplitude, omega, friction;
+  };
+
+  void setParams(const GaitParams& params);
+  void resetState(glm::dvec3* x, glm::dvec3* v) const;
+  void computeForces(const glm::dvec3* x, const glm::dvec3* v, double t, glm::dvec3* f) const;
+  // 給 lambda = d 目標 / d 力，把 d 目標 / d (x, v, 參數) 累加到 xBar、vBar、paramBar
+  void forcesVjp(const glm::dvec3* x, const glm::dvec3* v, double t, const glm::dvec3* lambda, glm::dvec3* xBar,
+                 glm::dvec3* vBar, double* paramBar) const;
+  void step(glm::dvec3* x, glm::dvec3* v, int stepIndex);
+  double measure(const glm::dvec3* x) const;
+
+  int n;
+  double segmentLength;
+  double groundHeight;
+  double h;  // 子步長
+  int numSteps;
+  int interval;
+  std::vector<double> mass;
+  std::vector<double> phase;  // 每條彈簧的空間相位
+  glm::dvec3 forward;         // 起始前進方向（頭的方向）
+  double totalMass = 0.0;
+  Coefficients c{};
+
+  // 事先配置：目前的狀態、力、檢查點與一段的重算緩衝區、伴隨變數
+  std::vector<glm::dvec3> x, v, force;
+  std::vector<glm::dvec3> checkpointX, checkpointV;  // checkpoints x n
+  std::vector<glm::dvec3> segmentX, segmentV;        // interval x n
+  std::vector<glm::dvec3> xBar, vBar, lambda;
+};
+
+}  // namespace gait
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+/**
+ * 場地摩擦貼圖
+ *
+ * 把場地切成 width x depth 的格子，每格存三個摩擦係數：
+ *   forward  - 沿身體往前滑的係數
+ *   backward - 往後滑的係數（蛇鱗讓它通常比 forward 大很多）
+ *   lateral  - 側向滑動的係數
+ * 取樣時做雙線性內插，格子中心對應 origin + (i + 0.5) * cellSize。
+ *
+ * 三個係數分開存（SoA），sampleBatch 一次處理所有質點，
+ * 迴圈內沒有分支，方便編譯器向量化。
+ */
+class FrictionMap {
+ public:
+  struct Coeffs {
+    float forward;
+    float backward;
+    float lateral;
+  };
+
+  /**
+   * @param width    x 方向格數
+   * @param depth    z 方向格數
+   * @param cellSize 每格邊長，單位：m
+   * @param origin   格子左上角在世界座標的 (x, z)
+   * @param fill     初始係數
+   */
+  FrictionMap(int width, int depth, float cellSize, const glm::vec2& origin, const Coeffs& fill);
+
+  /**
+   * 從文字檔讀取，失敗回傳 NULL
+   * 格式（一行一個指令，# 開頭為註解）：
+   *   size <width> <depth> <cellSize> <originX> <originZ>   必須是第一個指令
+   *   fill <forward> <backward> <lateral>
+   *   rect <x0> <z0> <x1> <z1> <forward> <backward> <lateral> 世界座標的矩形區域
+   *   cell <i> <j> <forward> <backward> <lateral>
+   */
+  static FrictionMap* fromFile(const char* filename);
+
+  void setCell(int i, int j, const Coeffs& c);
+  void fillRect(const glm::vec2& min, const glm::vec2& max, const Coeffs& c);
+
+  Coeffs sample(float x, float z) const;
+  void sampleBatch(const float* xs, const float* zs, int count, float* forwardOut, float* backwardOut,
+                   float* lateralOut) const;
+
+  int getWidth() const { return width; }
+  int getDepth() const { return depth; }
+  float getCellSize() const { return cellSize; }
+  glm::vec2 getOrigin() const { return origin; }
+
+ private:
+  int width;
+  int depth;
+  float cellSize;
+  float invCellSize;
+  glm::vec2 origin;
+
+  std::vector<float> forward;
+  std::vector<float> backward;
+  std::vector<float> lateral;
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "GaitSweep.h"
+#include "JobSystem.h"
+#include "utils.h"
+
+namespace gait {
+
+/**
+ * 用 CMA-ES 自動找步態與身體參數
+ *
+ * 在 bounds 正規化到 [0, 1] 的空間裡維護一個多維常態分布（平均、步長 sigma、共變異矩陣），
+ * 每一代取樣 lambda 組參數，整代一起交給 JobSystem 平行模擬，依成績好壞更新分布（Hansen 的標準版本）。
+ *
+ * 每一組參數對應一條固定的蛇，代與代之間只 reset 並套用新參數，取樣與更新用的矩陣也都事先配置，
+ * 所以每一代的時間幾乎都花在物理上。節數會改變蛇的大小，不能放在 bounds 裡。
+ */
+class GaitOptimizer {
+ public:
+  enum class Objective {
+    DISTANCE,          // 最大化一回合前進的距離
+    COST_OF_TRANSPORT  // 最小化每單位重量、單位距離的驅動功（前進太少視為失敗）
+  };
+
+  struct Settings {
+    std::vector<RandomRange> bounds;  // 要調的參數與範圍
+    Objective objective = Objective::DISTANCE;
+    int populationSize = 0;           // 0 表示 4 + 3 ln(n)
+    float initialSigma = 0.3f;        // 正規化空間裡的初始步長
+    unsigned int seed = 0;
+  };
+
+  struct Generation {
+    int index = 0;
+    double bestFitness = 0.0;  // 越大越好（COST_OF_TRANSPORT 時是負的 cost of transport）
+    double meanFitness = 0.0;  // 不算失敗的個體
+    int unstable = 0;
+    double sigma = 0.0;
+    double wallMs = 0.0;
+    GaitParams best;
+    GaitMetrics bestMetrics;
+  };
+
+  // base 是沒有在 bounds 裡的參數；bounds 有錯時印出 [ERROR]，isValid() 回傳 false
+  GaitOptimizer(const GaitParams& base, const Settings& settings, const EvalSettings& evalSettings, JobSystem& jobs);
+  DELETE_COPY(GaitOptimizer)
+
+  bool isValid() const { return valid; }
+  int getPopulationSize() const { return lambda; }
+
+  // 跑一代並回傳結果
+  const Generation& step();
+
+  // 到目前為止最好的一組
+  const GaitParams& getBest() const { return bestEver; }
+  double getBestFitness() const { return bestEverFitness; }
+
+ private:
+  double fitness(const GaitMetrics& metrics) const;
+  GaitParams toParams(const double* x) const;
+  void updateEigen();
+
+  GaitParams base;
+  Settings settings;
+  EvalSettings evalSettings;
+  JobSystem& jobs;
+  bool valid = true;
+
+  int n = 0;       // 維度
+  int lambda = 0;  // 每代的數量
+  int mu = 0;      // 用來更新的前 mu 名
+  std::vector<double> weights;
+  double mueff = 0.0, cc = 0.0, cs = 0.0, c1 = 0.0, cmu = 0.0, damps = 0.0, chiN = 0.0;
+
+  // 分布
+  std::vector<double> mean, ps, pc;
+  std::vector<double> C, B, D;  // C = B diag(D^2) B^T，n x n 以列為主
+  double sigma = 0.0;
+  int generation = 0;
+
+  // 每代重複使用的暫存
+  std::vector<double> z, y, x;  // lambda x n
+  std::vector<double> oldMean, yw, scratch;
+  std::vector<int> order;
+  std::vector<GaitParams> candidates;
+  std::vector<GaitMetrics> metrics;
+  std::vector<double> fitnesses;
+  std::vector<std::unique_ptr<Snake>> snakes;
+  std::mt19937 rng;
+
+  Generation last;
+  GaitParams bestEver;
+  double bestEverFitness = -1e300;
+};
+
+}  // namespace gait
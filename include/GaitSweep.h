@@ -0,0 +1,113 @@
+#pragma once
+
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "JobSystem.h"
+#include "Snake.h"
+#include "utils.h"
+
+/**
+ * 步態參數掃描
+ * 在沒有視窗的情況下讓一條蛇一直往前爬，量速度、能耗與是否爆掉，
+ * 用網格或隨機取樣產生很多組參數，平行跑完後寫成 CSV，中斷後可以接著跑。
+ */
+namespace gait {
+
+// 可以調的步態與身體參數，預設值與遊戲中的蛇相同
+struct GaitParams {
+  int numSegments = 7;
+  float springK = 1.0f;
+  float damping = 3.5f;
+  float waveAmplitude = 10.0f;  // Snake::waveAmplitudeRectilinear
+  float waveFrequency = 1.2f;   // Snake::waveFrequencyRectilinear，單位：Hz
+  float groundFriction = 0.2f;
+
+  // 依名稱設定，名稱與 CSV 欄位相同；不認得的名稱回傳 false
+  bool set(const std::string& name, float value);
+  float get(const std::string& name) const;  // 不認得的名稱回傳 0
+  static const std::vector<std::string>& getNames();
+};
+
+struct EvalSettings {
+  float simSeconds = 10.0f;
+  float dt = 1.0f / 120.0f;  // 每一步再依 getMaxSubDt() 切子步
+  float segmentMass = 0.02f;
+  float segmentLength = 0.178f;
+  float radius = 0.2f;
+  Snake::SpringIntegrator integrator = Snake::SpringIntegrator::EXPLICIT;
+  // 有摩擦貼圖時蛇從貼圖中央出發，GaitParams::groundFriction 不作用；要比評估活得久
+  const FrictionMap* frictionMap = nullptr;
+};
+
+struct GaitMetrics {
+  float forwardSpeed = 0.0f;      // 質心沿起始方向的平均速度，單位：m/s
+  double actuationWork = 0.0;     // 驅動做的功，單位：J
+  double costOfTransport = 0.0;   // 功 / (重量 × 前進距離)，沒有前進時為 0
+  float maxStretch = 0.0f;        // 最大的 彈簧長度 / 節長
+  bool stable = true;             // 沒有 NaN、沒有拉爆、沒有離開地面
+  float simSeconds = 0.0f;        // 不穩定時提早停止，這是實際跑的時間
+};
+
+// 建一條蛇按住前進，跑 settings.simSeconds 秒
+GaitMetrics evaluate(const GaitParams& params, const EvalSettings& settings);
+// 同上，但重複使用已經建好的蛇（節數必須等於 params.numSegments），只 reset 並套用參數
+GaitMetrics evaluate(Snake& snake, const GaitParams& params, const EvalSettings& settings);
+std::unique_ptr<Snake> createSnake(const GaitParams& params, const EvalSettings& settings);
+
+// 網格：每一軸的每個值的所有組合
+struct GridAxis {
+  std::string name;
+  std::vector<float> values;
+};
+// 隨機取樣：每個參數在 [min, max] 均勻分布
+struct RandomRange {
+  std::string name;
+  float min = 0.0f;
+  float max = 1.0f;
+};
+
+// 名稱錯誤時印出 [ERROR] 並回傳空的
+std::vector<GaitParams> makeGrid(const GaitParams& base, const std::vector<GridAxis>& axes);
+std::vector<GaitParams> makeRandom(const GaitParams& base, const std::vector<RandomRange>& ranges, int count,
+                                   unsigned int seed);
+
+/**
+ * 結果表（CSV），每算完一點就寫一行並 flush
+ * 開啟時會讀回已經存在的行，參數完全相同的點視為已經算完，接著跑時跳過
+ */
+class ResultTable {
+ public:
+  ResultTable() = default;
+  DELETE_COPY(ResultTable)
+
+  bool open(const std::string& path);  // 失敗時印出 [ERROR] 並回傳 false
+  bool isDone(const GaitParams& params) const;  // 不可以和 append 同時呼叫
+  void append(const GaitParams& params, const GaitMetrics& metrics);  // 可以在多個執行緒同時呼叫
+  int getNumDone() const { return (int)done.size(); }
+
+ private:
+  static std::string makeKey(const GaitParams& params);
+
+  std::ofstream file;
+  std::unordered_set<std::string> done;
+  std::mutex mutex;
+};
+
+struct SweepStats {
+  int total = 0;
+  int skipped = 0;   // 上次已經算完的
+  int evaluated = 0;
+  int unstable = 0;
+  double wallSeconds = 0.0;
+};
+
+// 平行算完所有還沒算過的點，每一點一個工作
+SweepStats run(const std::vector<GaitParams>& points, const EvalSettings& settings, ResultTable& table,
+               JobSystem& jobs);
+
+}  // namespace gait
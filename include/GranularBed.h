@@ -0,0 +1,95 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "CellList.h"
+#include "JobSystem.h"
+
+class Snake;
+
+/**
+ * 離散元素（DEM）沙床
+ *
+ * 大量小球用線性彈簧-阻尼接觸（法向）加上庫侖上限的切向阻尼，
+ * 與地板、四面牆以及蛇的質點（半徑 = 蛇的 radius）互相碰撞。
+ *
+ * 資料以 SoA 存放，每次重建 cell list 時依格子重新排列，
+ * 讓同一格的粒子在記憶體中相鄰；粒子間的力交給 JobSystem 平行計算，
+ * 每個粒子只寫自己的力，不需要上鎖。
+ *
+ * 與蛇同步：每次 Snake::update(dt) 之前呼叫 step(dt, snake)，
+ * 沙床用內部的小步長跑完 dt，並把對蛇質點的平均反作用力交給 Snake::addExternalForce。
+ * 蛇的 dt 不要超過 getMaxStableDt()，否則大量接觸同時作用在很輕的質點上會發散。
+ */
+class GranularBed {
+ public:
+  struct Params {
+    float particleRadius = 0.01f;    // m
+    float particleDensity = 1500.0f; // kg/m^3，乾沙大約這個值
+    float stiffness = 200.0f;        // 法向彈簧常數 kn，單位：N/m
+    float restitution = 0.3f;        // 碰撞恢復係數，用來算阻尼
+    float friction = 0.5f;           // 切向庫侖摩擦係數
+    float gravity = 9.8f;
+    JobSystem* jobs = nullptr;       // nullptr 表示使用 JobSystem::shared()
+  };
+
+  struct Stats {
+    long long particleSteps = 0;  // 粒子數 x 子步數的累計
+    double elapsedMs = 0.0;       // 累計的計算時間
+    double lastStepMs = 0.0;      // 上一次 step 花的時間
+    double particlesPerMs() const { return elapsedMs > 0.0 ? particleSteps / elapsedMs : 0.0; }
+  };
+
+  /**
+   * @param boundsMin 沙床範圍（地板高度 = boundsMin.y，四面牆為 x/z 邊界）
+   * @param boundsMax 上方只是用來決定格子數，粒子可以超出
+   */
+  GranularBed(const Params& params, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+  // 在 [min, max] 內以粒徑為間距鋪滿粒子，回傳新增數量
+  int fillBox(const glm::vec3& min, const glm::vec3& max, unsigned int seed = 0);
+  // 移除球內的粒子，放蛇進沙床前用來挖出空間
+  int removeInside(const glm::vec3& center, float radius);
+  void clear();
+
+  void step(float dt);
+  void step(float dt, Snake* snake);
+
+  int getParticleCount() const { return (int)px.size(); }
+  const float* getPositionsX() const { return px.data(); }
+  const float* getPositionsY() const { return py.data(); }
+  const float* getPositionsZ() const { return pz.data(); }
+  float getMaxStableDt() const { return maxSubDt; }
+  const Stats& getStats() const { return stats; }
+  void resetStats() { stats = Stats(); }
+
+ private:
+  void substep(float dt, const std::vector<glm::vec3>& bodyPos, const std::vector<glm::vec3>& bodyVel, float bodyRadius,
+               std::vector<glm::vec3>& bodyForce);
+  void sortByCell();
+  void computeParticleForces(int begin, int end);
+  void computeBodyForces(const std::vector<glm::vec3>& bodyPos, const std::vector<glm::vec3>& bodyVel,
+                         float bodyRadius, std::vector<glm::vec3>& bodyForce);
+  void integrate(int begin, int end, float dt);
+  glm::vec3 contactForce(float overlap, const glm::vec3& normal, const glm::vec3& relVel, float damping) const;
+
+  Params params;
+  glm::vec3 boundsMin;
+  glm::vec3 boundsMax;
+  CellList cells;
+
+  float particleMass;
+  float normalDamping;  // 由恢復係數換算的阻尼 gn（粒子對粒子）
+  float wallDamping;    // 粒子對牆/地板（牆的質量視為無限大）
+  float maxSubDt;
+  JobSystem* jobs;
+
+  // SoA
+  std::vector<float> px, py, pz;
+  std::vector<float> vx, vy, vz;
+  std::vector<float> fx, fy, fz;
+  std::vector<float> scratch;
+
+  Stats stats;
+};
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "utils.h"
+
+/**
+ * 工作竊取（work-stealing）的工作系統
+ *
+ * 每個執行緒有自己的 Chase-Lev 雙端佇列：自己從底部 push/pop，其他執行緒從頂部偷。
+ * 工作（Job）直接存在佇列固定大小的環狀陣列裡（佇列滿了就當場執行），穩定狀態下完全不配置記憶體，
+ * 佇列操作也只用原子操作，只有在沒事做要睡覺 / 叫醒別人時才會碰到 mutex。
+ *
+ * 相依性用計數器（Counter）表示：送出工作時計數器 +1，完成時 -1，
+ * wait(counter) 在等待期間會幫忙執行其他工作，不會佔著執行緒空等。
+ *
+ * parallelFor 只送出一個涵蓋整個範圍的工作，執行時不斷把右半邊切出去給別人偷，
+ * 所以同時存在的工作數量只有 O(log n)，也自然做到負載平衡。
+ *
+ * 建立 JobSystem 的執行緒是 0 號執行緒；其他不屬於這個系統的執行緒也可以送出工作與等待，
+ * 只是它們的工作放在一個有鎖的共用佇列（慢路徑）。
+ * 每個執行緒同時未完成的工作數量不能超過 JOBS_PER_THREAD。
+ *
+ * 多插槽的機器上可以依 NUMA 拓撲建立：執行緒依各節點的 CPU 數分到節點上（可選擇綁定 CPU），
+ * runOnNode 把工作送給指定節點，偷工作時先偷同節點的，都沒有才跨節點。
+ */
+class JobSystem {
+ public:
+  using JobFunction = void (*)(void* context, int begin, int end);
+
+  struct Counter {
+    std::atomic<int> pending{0};
+    bool isDone() const { return pending.load(std::memory_order_acquire) == 0; }
+  };
+
+  // 機器的 NUMA 拓撲：每個節點可以用的 CPU 編號
+  struct Topology {
+    std::vector<std::vector<int>> nodeCpus;
+
+    static Topology detect();  // 讀不到拓撲時回傳單一節點
+    int getNumNodes() const { return (int)nodeCpus.size(); }
+    int getNumCpus() const;
+  };
+
+  explicit JobSystem(int numThreads = 0);  // 含建立者的執行緒總數，0 表示 hardware_concurrency
+  // 依 topology 把執行緒分到各節點（0 號執行緒在第一個節點）；
+  // pinThreads 時工作執行緒綁定到所屬節點的 CPU，建立者的執行緒不綁
+  JobSystem(int numThreads, const Topology& topology, bool pinThreads);
+  ~JobSystem();
+  DELETE_COPY(JobSystem)
+
+  // 整個程式共用的實例，第一次呼叫時建立，呼叫者成為 0 號執行緒
+  static JobSystem& shared();
+
+  int getNumThreads() const { return (int)slots.size(); }
+  int getNumNodes() const { return (int)nodes.size(); }
+  int getNodeThreadCount(int node) const { return nodes[node]->numSlots; }
+  int currentNode() const;  // 目前執行緒所屬的節點，不屬於這個系統時回傳 -1
+
+  // 送出 fn(context, begin, end)；grain > 0 時，範圍大於 grain 的工作在執行時會再切開
+  void run(JobFunction fn, void* context, int begin, int end, int grain, Counter* counter);
+  // 同 run，但工作交給 node 節點的執行緒；該節點的執行緒都在忙時其他節點才會來拿
+  void runOnNode(int node, JobFunction fn, void* context, int begin, int end, int grain, Counter* counter);
+  // 等到 counter 歸零，期間幫忙做其他工作
+  void wait(Counter& counter);
+
+  // 對 [0, count) 以大約 grain 為單位平行呼叫 fn(begin, end)，全部做完才回傳
+  template <typename Fn>
+  void parallelFor(int count, int grain, Fn&& fn) {
+    if (count <= 0) return;
+    using F = std::remove_reference_t<Fn>;
+    if (count <= grain || slots.size() == 1) {
+      fn(0, count);
+      return;
+    }
+    JobFunction thunk = [](void* context, int begin, int end) { (*static_cast<F*>(context))(begin, end); };
+    Counter counter;
+    run(thunk, const_cast<void*>(static_cast<const void*>(std::addressof(fn))), 0, count, grain, &counter);
+    wait(counter);
+  }
+
+  static constexpr int JOBS_PER_THREAD = 4096;  // 2 的次方
+
+ private:
+  struct Job {
+    JobFunction function;
+    void* context;
+    int begin;
+    int end;
+    int grain;
+    Counter* counter;
+  };
+
+  // 固定容量的 Chase-Lev 雙端佇列（Lê et al. 2013 的 C11 記憶體順序），工作以值存放，
+  // 一個位置只有在它離開 [top, bottom) 之後才會被覆寫
+  class WorkStealingDeque {
+   public:
+    bool push(const Job& job);  // 只有擁有者可以呼叫，滿了回傳 false
+    bool pop(Job& out);         // 只有擁有者可以呼叫
+    bool steal(Job& out);       // 任何執行緒
+
+   private:
+    alignas(64) std::atomic<int64_t> top{0};
+    alignas(64) std::atomic<int64_t> bottom{0};
+    Job jobs[JOBS_PER_THREAD];
+  };
+
+  struct Slot {
+    WorkStealingDeque deque;
+    uint32_t rngState = 1;
+    int node = 0;
+    int cpu = -1;  // 綁定的 CPU，-1 表示不綁
+  };
+
+  // 同一個 NUMA 節點的執行緒是連續的 [firstSlot, firstSlot + numSlots)
+  struct Node {
+    int firstSlot = 0;
+    int numSlots = 0;
+    std::mutex mutex;
+    std::vector<Job> jobs;  // runOnNode 從節點外送進來的工作
+  };
+
+  int currentSlot() const;
+  void submit(int slot, const Job& job);
+  bool takeQueued(std::mutex& mutex, std::vector<Job>& queue, Job& out);
+  bool stealFrom(int slot, int firstVictim, int numVictims, uint32_t r, Job& out);
+  bool findJob(int slot, Job& out, bool takeRemote);  // takeRemote：也拿送給其他節點的工作
+  void execute(int slot, Job job);
+  void workerLoop(int slot);
+
+  std::vector<std::unique_ptr<Slot>> slots;
+  std::vector<std::unique_ptr<Node>> nodes;
+  std::vector<std::thread> threads;
+
+  // 建立前這個執行緒原本屬於的系統，解構時還原（同一個執行緒上可以有好幾個 JobSystem）
+  const JobSystem* previousOwner = nullptr;
+  int previousSlot = -1;
+
+  // 不屬於系統的執行緒送出的工作（慢路徑）
+  std::mutex foreignMutex;
+  std::vector<Job> foreignJobs;
+
+  // 閒置執行緒的睡眠與喚醒
+  std::atomic<int> queuedJobs{0};
+  std::atomic<int> sleepers{0};
+  std::atomic<bool> stopping{false};
+  std::mutex sleepMutex;
+  std::condition_variable wakeCondition;
+};
@@ -1,32 +1,51 @@
 #pragma once
 #include <glm/glm.hpp>
 
-class Mass {
+/**
+ * 質點，以純量型別為模板參數
+ *   T   位置與速度的精度
+ *   Acc 累積力的精度（混合精度時用 double 累加，位置仍存 float）
+ * 常用的組合在檔案最後有別名：Mass / MassD / MassMixed
+ */
+template <typename T, typename Acc = T>
+class BasicMass {
  public:
- 
-  Mass(float mass, const glm::vec3& position);
+  using Scalar = T;
+  using Vec3 = glm::vec<3, T>;
+  using AccVec3 = glm::vec<3, Acc>;
+
+  BasicMass(T mass, const Vec3& position);
 
   
-  void applyForce(const glm::vec3& force);
+  void applyForce(const AccVec3& force);
   void resetForce();
-  void update(float dt);
+  void update(T dt);
+  // update 拆成兩半，給彈簧解析解積分在中間插入衝量
+  void integrateVelocity(T dt);
+  void integratePosition(T dt);
 
   // getter
-  glm::vec3 getPosition() const { return position; }
-  glm::vec3 getVelocity() const { return velocity; }
-  float getMass() const { return mass; }
-  glm::vec3 getNewVelocity(float dt) const {
-	glm::vec3 acceleration = force / mass;
-	return velocity + acceleration * dt;
+  Vec3 getPosition() const { return position; }
+  Vec3 getVelocity() const { return velocity; }
+  AccVec3 getForce() const { return force; }
+  T getMass() const { return mass; }
+  Vec3 getNewVelocity(T dt) const {
+	AccVec3 acceleration = force / Acc(mass);
+	return velocity + Vec3(acceleration * Acc(dt));
   }
 
   // setter
-  void setPosition(const glm::vec3& pos) { position = pos; }
-  void setVelocity(const glm::vec3& vel) { velocity = vel; }
+  void setPosition(const Vec3& pos) { position = pos; }
+  void setVelocity(const Vec3& vel) { velocity = vel; }
+  void setMass(T m) { mass = m; }
 
  private:
-  float mass;          // 質量 (m)，單位：kg
-  glm::vec3 position;  // 位置 (x)，單位：m
-  glm::vec3 velocity;  // 速度 (v)，單位：m/s
-  glm::vec3 force;     // 累積的力 (F)，單位：N
+  T mass;            // 質量 (m)，單位：kg
+  Vec3 position;     // 位置 (x)，單位：m
+  Vec3 velocity;     // 速度 (v)，單位：m/s
+  AccVec3 force;     // 累積的力 (F)，單位：N
 };
+
+using Mass = BasicMass<float>;
+using MassD = BasicMass<double>;
+using MassMixed = BasicMass<float, double>;
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "JobSystem.h"
+
+/**
+ * 小型全連接網路（MLP）的批次推論，給蛇的控制策略用，不需要外部框架
+ *
+ * 每一層 y = act(W x + b)。一次把整批觀察（batch x inputs，以列為主）送進 forward，
+ * 每一層都是一個矩陣乘法：權重事先重排成每 16 個輸出一組的面板（panel），
+ * 核心一次算 8 列 x 16 行放在暫存器裡，迴圈是固定長度、沒有分支的乘加，由編譯器沿著 16 行向量化（-march=native）。
+ * 一個面板是 inputs x 16 個 float，隱藏層 256 以內都放得進 L1。
+ *
+ * 權重檔（little endian）：
+ *   char magic[4] = "MLP1"
+ *   uint32 numLayers
+ *   每一層：uint32 inputs, uint32 outputs, uint32 activation（Activation 的值），
+ *           float weights[outputs][inputs]（與 PyTorch nn.Linear.weight 相同的排列），float bias[outputs]
+ */
+class MlpPolicy {
+ public:
+  enum class Activation : uint32_t { LINEAR = 0, RELU = 1, TANH = 2 };
+
+  MlpPolicy() = default;
+
+  // 失敗時印出 [ERROR] 並回傳 NULL
+  static MlpPolicy* fromFile(const char* filename);
+  bool save(const char* filename) const;
+  // sizes = {inputs, hidden..., outputs}，權重用 Xavier 均勻分布，給基準測試與沒有訓練好的權重時用
+  static MlpPolicy createRandom(const std::vector<int>& sizes, Activation hidden, Activation output,
+                                unsigned int seed);
+
+  // weights 是 outputs x inputs；inputs 必須等於上一層的 outputs，否則印出 [ERROR] 並回傳 false
+  bool addLayer(int inputs, int outputs, Activation activation, const float* weights, const float* bias);
+
+  int getNumLayers() const { return (int)layers.size(); }
+  int getInputSize() const { return layers.empty() ? 0 : layers.front().inputs; }
+  int getOutputSize() const { return layers.empty() ? 0 : layers.back().outputs; }
+  long long getFlopsPerSample() const;  // 乘加算兩次
+
+  // input: batch x getInputSize()，output: batch x getOutputSize()，都以列為主
+  // 中間結果放在 thread_local 的暫存，不同執行緒可以同時呼叫
+  void forward(const float* input, int batch, float* output) const;
+  // 把整批切成 rowsPerJob 列一份交給 JobSystem
+  void forward(const float* input, int batch, float* output, JobSystem& jobs, int rowsPerJob = 256) const;
+  // 沒有分塊的參考實作，給基準測試比對結果與速度
+  void forwardReference(const float* input, int batch, float* output) const;
+
+ private:
+  struct Layer {
+    int inputs = 0;
+    int outputs = 0;
+    Activation activation = Activation::LINEAR;
+    std::vector<float> weights;  // 原本的排列 outputs x inputs（存檔與參考實作用）
+    std::vector<float> panels;   // 面板排列：[outputs / 16][inputs][16]，不足 16 的補 0
+    std::vector<float> bias;     // 補到 16 的倍數
+  };
+
+  static void multiply(const Layer& layer, const float* input, int lda, int batch, float* output, int ldc);
+
+  std::vector<Layer> layers;
+  int maxWidth = 0;  // 最寬的一層（補齊到 16 的倍數）
+};
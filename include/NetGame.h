@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "NetSnapshot.h"
+#include "SnakeWorld.h"
+#include "utils.h"
+
+namespace net {
+
+/**
+ * 同一台機器上的多人遊戲：GameServer 跑唯一的 SnakeWorld，GameClient 只送按鍵、收快照來畫
+ *
+ * 傳輸用 UNIX domain socket（SOCK_STREAM），每個訊息是 uint32 長度 + uint8 種類 + 內容（little endian）：
+ *   HELLO     client -> server  uint32 版本
+ *   WELCOME   server -> client  uint32 版本, int32 蛇的編號, float tickRate, arenaWidth, arenaDepth, appleHeight
+ *   INPUT     client -> server  uint32 ackTick, uint8 按鍵（1 前、2 左、4 右）
+ *   SNAPSHOT  server -> client  uint32 tick, uint32 baseTick（0 表示完整快照）, 差分資料（見 NetSnapshot.h）
+ *
+ * 伺服器保留最近 HISTORY_SIZE 個 tick 的量化快照，對每個 client 以它最後確認（ack）的 tick 為基準做差分，
+ * 基準太舊或還沒有 ack 時送完整快照。同一個 tick 基準相同的 client 共用一次編碼。
+ * client 來不及讀、上一份還沒送完時直接丟掉這一份，之後的差分仍以 ack 過的基準為準，所以不會錯。
+ * 沒有 client 控制的蛇由自動駕駛玩，每條蛇在自己的場地裡（見 SnakeWorld），結束後馬上重新開始。
+ *
+ * 只支援 POSIX，Windows 上 start / connect 會印出 [ERROR] 並回傳 false。
+ */
+constexpr uint32_t PROTOCOL_VERSION = 1;
+constexpr int HISTORY_SIZE = 64;
+
+enum MessageType : uint8_t { HELLO = 1, WELCOME = 2, INPUT = 3, SNAPSHOT = 4 };
+
+class GameServer {
+ public:
+  struct Config {
+    std::string socketPath = "/tmp/snake.sock";
+    int numSnakes = 16;
+    float tickRate = 60.0f;
+    unsigned int seed = 0;
+    SnakeWorld::Rules rules;
+    SnakeWorld::SnakeParams snake;
+  };
+
+  struct Stats {
+    long long ticks = 0;
+    long long snapshotsSent = 0;
+    long long fullSnapshots = 0;
+    long long snapshotsDropped = 0;  // client 還沒讀完上一份
+    long long bytesSent = 0;
+    long long bytesReceived = 0;
+    long long encodes = 0;  // 實際編碼的次數（共用的只算一次）
+    double encodeMs = 0.0;  // 量化加上編碼
+    double stepMs = 0.0;
+  };
+
+  explicit GameServer(const Config& config, JobSystem* jobs = nullptr);
+  ~GameServer();
+  DELETE_COPY(GameServer)
+
+  // 建立並監聽 socket（已經存在的檔案會先刪掉），失敗時印出 [ERROR] 並回傳 false
+  bool start();
+  // 接受新連線、讀取輸入、推進 1 / tickRate 秒並送出快照；不會阻塞
+  void tick();
+
+  int getNumClients() const { return (int)clients.size(); }
+  uint32_t getTick() const { return currentTick; }
+  SnakeWorld& getWorld() { return world; }
+  const Stats& getStats() const { return stats; }
+  void resetStats() { stats = Stats(); }
+
+ private:
+  struct Client {
+    int fd = -1;
+    int snake = -1;  // -1 表示沒有空位，只能觀看
+    uint32_t ackTick = 0;
+    std::vector<uint8_t> in;
+    std::vector<uint8_t> out;
+    size_t outPos = 0;
+    bool closed = false;
+  };
+
+  void acceptClients();
+  void readClient(Client& client);
+  void handleMessage(Client& client, uint8_t type, const uint8_t* body, size_t size);
+  void sendSnapshots();
+  void flush(Client& client);
+  void dropClosed();
+  const QuantizedFrame* findFrame(uint32_t tick) const;
+
+  Config config;
+  SnakeWorld world;
+  std::vector<bool> taken;
+  std::vector<Client> clients;
+  std::vector<QuantizedFrame> history;  // 以 tick % HISTORY_SIZE 存放
+  std::vector<uint32_t> baseTicks;      // 這個 tick 已經編碼過的基準
+  std::vector<std::vector<uint8_t>> encoded;
+  int listenFd = -1;
+  uint32_t currentTick = 0;
+  Stats stats;
+};
+
+class GameClient {
+ public:
+  struct Stats {
+    long long snapshots = 0;
+    long long fullSnapshots = 0;
+    long long undecodable = 0;  // 找不到基準或資料壞掉，等伺服器送完整快照
+    long long bytesReceived = 0;
+    double decodeMs = 0.0;
+  };
+
+  GameClient() = default;
+  ~GameClient();
+  DELETE_COPY(GameClient)
+
+  // 連線並送出 HELLO，失敗時印出 [ERROR] 並回傳 false
+  bool connect(const std::string& socketPath);
+  // 讀取所有已經到達的訊息並送出上次沒送完的部分；伺服器斷線時回傳 false
+  bool poll();
+  // 送出按鍵並確認目前最新的快照；上一個訊息還沒送完時丟掉這一個（整個訊息，不會只送一半）
+  void sendInput(bool forward, bool left, bool right);
+
+  bool isWelcomed() const { return welcomed; }
+  int getSnakeIndex() const { return snakeIndex; }
+  uint32_t getTick() const { return latestTick; }
+  float getTickRate() const { return tickRate; }
+  const std::vector<SnakeView>& getSnakes() const { return views; }
+  const Stats& getStats() const { return stats; }
+
+ private:
+  void handleMessage(uint8_t type, const uint8_t* body, size_t size);
+  bool flush();  // 送出 out 裡還沒送的部分，錯誤時回傳 false
+
+  int fd = -1;
+  bool welcomed = false;
+  int snakeIndex = -1;
+  float tickRate = 0.0f;
+  float appleHeight = 0.0f;
+  uint32_t latestTick = 0;
+  std::vector<uint8_t> in;
+  std::vector<uint8_t> out;
+  size_t outPos = 0;
+  std::vector<QuantizedFrame> history = std::vector<QuantizedFrame>(HISTORY_SIZE);
+  std::vector<SnakeView> views;
+  Stats stats;
+};
+
+}  // namespace net
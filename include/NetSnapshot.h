@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "SnakeWorld.h"
+
+namespace net {
+
+/**
+ * 網路快照：把 SnakeWorld 裡畫面需要的狀態量化成整數，並對基準快照做差分壓縮
+ *
+ * 每條蛇是一串 int16 欄位：
+ *   0 狀態（GameState | GameResult << 2 | hitWall << 4）  1 分數  2 剩餘時間（1/100 s）
+ *   3-4 蘋果 x, z  5 質點數  之後每個質點 x, y, z
+ * 長度都以 POSITION_QUANTUM（約 0.5 mm）為單位，可表示 ±16 m。
+ *
+ * 差分編碼：每條蛇先寫欄位數，基準裡有同一條蛇且欄位數相同時對基準相減，否則對 0 相減（等於完整傳送）。
+ * 差值序列用 varint 的 token 表示：(連續 0 的個數 << 1) 或 (zigzag(差值) << 1 | 1)，
+ * 所以沒動的蛇只要 2 個位元組，一幀移動幾 mm 的質點每個座標 1 個位元組。
+ */
+constexpr float POSITION_QUANTUM = 1.0f / 2048.0f;
+
+struct QuantizedFrame {
+  uint32_t tick = 0;
+  std::vector<std::vector<int16_t>> snakes;
+};
+
+// 給畫面用的還原結果
+struct SnakeView {
+  SnakeWorld::GameState state = SnakeWorld::GameState::STOPPED;
+  SnakeWorld::GameResult result = SnakeWorld::GameResult::NONE;
+  bool hitWall = false;
+  int score = 0;
+  float timer = 0.0f;
+  glm::vec3 applePosition = glm::vec3(0.0f);  // y 是 Rules::appleHeight
+  std::vector<glm::vec3> masses;
+};
+
+void quantize(const SnakeWorld& world, uint32_t tick, QuantizedFrame& out);
+void dequantize(const QuantizedFrame& frame, float appleHeight, std::vector<SnakeView>& out);
+
+// base 為 nullptr 表示完整快照；結果附加在 out 後面
+void encodeDelta(const QuantizedFrame* base, const QuantizedFrame& frame, std::vector<uint8_t>& out);
+// 資料不完整或與 base 對不上時回傳 false；out.tick 由呼叫端設定
+bool decodeDelta(const QuantizedFrame* base, const uint8_t* data, size_t size, QuantizedFrame& out);
+
+}  // namespace net
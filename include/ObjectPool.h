@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "utils.h"
+
+/**
+ * 固定位址的物件池
+ *
+ * 以 BlockSize 個物件為一塊向系統要記憶體，塊一旦配置就不會移動，
+ * 所以 create() 回傳的指標在 destroy() 之前都有效（Spring 可以放心存 Mass*）。
+ * destroy() 後的位置放進 free list，下次 create() 優先重複使用。
+ */
+template <typename T, size_t BlockSize = 32>
+class ObjectPool {
+ public:
+  ObjectPool() = default;
+  ~ObjectPool() = default;  // 物件由使用者 destroy，這裡只釋放記憶體
+  DELETE_COPY(ObjectPool)
+
+  template <typename... Args>
+  T* create(Args&&... args) {
+    if (freeList.empty()) grow();
+    Slot* slot = freeList.back();
+    freeList.pop_back();
+    ++liveCount;
+    return new (slot->storage) T(std::forward<Args>(args)...);
+  }
+
+  void destroy(T* object) {
+    if (!object) return;
+    object->~T();
+    freeList.push_back(reinterpret_cast<Slot*>(object));
+    --liveCount;
+  }
+
+  // 預先準備至少 count 個空位，之後 create 不會再配置記憶體
+  void reserve(size_t count) {
+    while (freeList.size() < count) grow();
+  }
+
+  size_t size() const { return liveCount; }
+  size_t capacity() const { return blocks.size() * BlockSize; }
+
+ private:
+  struct Slot {
+    alignas(T) unsigned char storage[sizeof(T)];
+  };
+
+  void grow() {
+    blocks.emplace_back(new Slot[BlockSize]);
+    Slot* block = blocks.back().get();
+    freeList.reserve(freeList.size() + BlockSize);
+    // 反向放入，讓 create 依位址遞增取用
+    for (size_t i = BlockSize; i > 0; --i) freeList.push_back(&block[i - 1]);
+  }
+
+  std::vector<std::unique_ptr<Slot[]>> blocks;
+  std::vector<Slot*> freeList;
+  size_t liveCount = 0;
+};
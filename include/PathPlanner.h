@@ -0,0 +1,118 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "utils.h"
+
+class Snake;
+
+/**
+ * 自動駕駛用的路徑規劃：在場地的佔用格子上用 D* Lite 從蛇頭找到蘋果的路
+ *
+ * 格子是 8 連通，斜走不能切過被擋住的角。擋住的格子有兩種：
+ *   - 牆：離牆小於 wallMargin + clearance 的格子，建立時算好，不會變
+ *   - 蛇身：第 skipSegments 節以後的質點半徑內的格子（終點周圍一格除外），每次 plan 重新標記
+ *
+ * D* Lite 從終點往起點搜尋，蛇頭移動只是把 km 加上移動的距離，
+ * 每次 plan 只對狀態有變的格子（蛇身移開或移入、起點換格）更新，不重新搜尋整張圖。
+ * 蘋果換位置時終點變了，這時才整個重來（一回合只有 winScore 次）。
+ *
+ * 每次 plan 最多花 budgetMicros 微秒：佔用有變的格子的更新與搜尋的展開都一步一步做，每一步之前看時間，
+ * 時間到就停，剩下的留給下一次 plan 接著做。整個重來只換一個搜尋編號（g、rhs 用到時才初始化），
+ * 堆積裡過時的項目太多時在下一次 plan 一開始重建，所以每次 plan 在搜尋之外只有標記蛇身（和蛇長成正比）
+ * 與可能的一次重建（和格子數成正比）不能中斷。
+ * 搜尋還沒完成時 plan 仍然沿著目前的 g 值往下走，起點還沒有任何鄰居有 g 值時回傳 false，
+ * 由呼叫端改用直接轉向。時間限制讓結果和機器快慢有關，要可重現時把 budgetMicros 設成 0、只用 maxExpansions。
+ */
+class PathPlanner {
+ public:
+  struct Config {
+    float cellSize = 0.128f;     // m，預設場地切成 64 x 40 格
+    float clearance = 0.25f;     // 牆的格子再往內多擋這麼遠，m
+    int skipSegments = 2;        // 蛇頭與脖子不算障礙
+    int lookaheadCells = 4;      // 路點取路徑上第幾格
+    float budgetMicros = 25.0f;  // 每次 plan 的時間上限，0 表示不限
+    int maxExpansions = 0;       // 每次 plan 展開的格子數上限，0 表示不限
+  };
+
+  struct Stats {
+    long long plans = 0;
+    long long expansions = 0;
+    long long searches = 0;    // 終點改變、整個重來的次數
+    long long incomplete = 0;  // 用完預算還沒搜完的 plan
+    long long overBudget = 0;  // 實際花的時間超過 budgetMicros 的 plan
+    long long noPath = 0;      // 回傳 false 的 plan
+    double totalMicros = 0.0;
+    double maxMicros = 0.0;
+  };
+
+  PathPlanner(const Config& config, float arenaWidth, float arenaDepth, float wallMargin);
+  DELETE_COPY(PathPlanner)
+
+  // 忘掉之前的搜尋，下一次 plan 重新開始（新的一回合）
+  void reset();
+  // 從蛇頭規劃到 goal，成功時把路徑上的下一個路點（水平座標，y 與 goal 相同）寫進 waypoint
+  bool plan(const Snake& snake, const glm::vec3& goal, glm::vec3& waypoint);
+
+  int getWidth() const { return width; }
+  int getDepth() const { return depth; }
+  bool isBlocked(int cx, int cz) const { return !isFree(cx + cz * width); }
+  const Stats& getStats() const { return stats; }
+
+ private:
+  struct Key {
+    float k1, k2;
+    bool operator<(const Key& other) const { return k1 < other.k1 || (k1 == other.k1 && k2 < other.k2); }
+  };
+  struct Entry {
+    Key key;
+    int cell;
+  };
+  static bool greater(const Entry& a, const Entry& b);
+
+  int cellOf(float x, float z) const;
+  glm::vec3 centerOf(int cell, float y) const;
+  bool isFree(int cell) const { return cell == goal || cell == start || (!wall[cell] && !body[cell]); }
+  // 不是這一次搜尋寫過的格子都當作無限大
+  float gOf(int cell) const { return stamp[cell] == search ? g[cell] : INFINITY; }
+  float rhsOf(int cell) const { return stamp[cell] == search ? rhs[cell] : INFINITY; }
+  void touch(int cell);
+  float heuristic(int a, int b) const;
+  int neighbor(int cell, int k) const;    // 第 k 個鄰居，超出格子時回傳 -1
+  float cost(int from, int k) const;      // 走到第 k 個鄰居的代價，走不過去是無限大
+  Key calculateKey(int cell) const;
+  void push(int cell);
+  void updateVertex(int cell);
+  void updateAround(int cell);
+  void markBody(const Snake& snake, int goalCell);
+  void rebuildHeap();
+  bool outOfTime(std::chrono::steady_clock::time_point began, std::chrono::steady_clock::time_point& last) const;
+  // 先更新 changed 裡的格子再搜尋；回傳 true 表示都做完（起點一致），用完預算回傳 false
+  bool computeShortestPath(std::chrono::steady_clock::time_point began);
+
+  Config config;
+  int width, depth;
+  static const int OFFSET_X[8];
+  static const int OFFSET_Z[8];
+
+  std::vector<uint8_t> wall;
+  std::vector<uint8_t> body;
+  std::vector<int> bodyCells;    // 上一次標記的蛇身格子
+  std::vector<int> markedCells;  // 這一次標記的蛇身格子
+  std::vector<int> bodyStamp;    // 這一次標記過的格子記上 tick
+  std::vector<int> changed;      // 佔用狀態有變、還沒更新的格子
+  std::vector<float> g, rhs;
+  std::vector<int> stamp;        // g、rhs 是第幾次搜尋寫的
+  std::vector<Entry> heap;       // 最小堆積；過時的項目不刪，取出時略過
+  bool heapStale = false;        // 過時的項目太多，下一次 plan 先重建
+  int tick = 0;
+  int search = 0;
+  int goal = -1;
+  int start = -1;
+  float km = 0.0f;
+  Stats stats;
+};
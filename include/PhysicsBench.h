@@ -0,0 +1,127 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "MlpPolicy.h"
+#include "Snake.h"
+#include "SnakeWorld.h"
+
+/**
+ * 物理核心的基準測試與誤差報告
+ * 在沒有視窗的情況下量測不同設定的速度與精度，方便決定大規模模擬要用哪一種
+ */
+namespace bench {
+
+// 自由的一串質點彈簧（沒有重力與摩擦），一開始有正弦形狀的伸縮
+struct ChainScenario {
+  int numMasses = 64;
+  int steps = 100000;
+  float dt = 0.002f;
+  float mass = 0.02f;
+  float springK = 1.0f;
+  float damping = 0.0f;
+  float restLength = 0.178f;
+  float offset = 1000.0f;  // 整串離原點的距離，越遠 float 的解析度越差
+};
+
+struct PrecisionResult {
+  std::string name;
+  double nsPerMassStep = 0.0;     // 每個質點每一步的時間
+  double rmsPositionError = 0.0;  // 與 double 參考解的位置 RMS 誤差，單位：m
+  double energyDrift = 0.0;       // 相對能量漂移 |E - E0| / E0
+};
+
+// 分別以 float / mixed(float + double 累加) / double 跑同一個情境
+std::vector<PrecisionResult> runPrecisionComparison(const ChainScenario& scenario);
+void printPrecisionReport(std::ostream& out, const ChainScenario& scenario, const std::vector<PrecisionResult>& results);
+
+// 一條往前爬的蛇（有重力、摩擦與地板），比較顯式小步長與解析解大步長
+struct IntegratorScenario {
+  int numSegments = 7;
+  float simSeconds = 5.0f;
+  float referenceDt = 0.0005f;  // 參考解：顯式積分、很小的步長
+  std::vector<float> analyticDts = {0.002f, 0.005f, 0.01f, 0.02f, 0.033f};
+};
+
+struct IntegratorResult {
+  std::string name;
+  float dt = 0.0f;
+  double msPerSimSecond = 0.0;  // 模擬 1 秒需要的計算時間
+  double headError = 0.0;       // 蛇頭與參考解的距離，單位：m
+  bool stable = true;           // 結果沒有 NaN 且沒有飛出場地
+};
+
+std::vector<IntegratorResult> runIntegratorComparison(const IntegratorScenario& scenario);
+void printIntegratorReport(std::ostream& out, const IntegratorScenario& scenario,
+                           const std::vector<IntegratorResult>& results);
+
+// 同一條蛇用 FULL 與 KINEMATIC 各爬一次，比較每步的成本與蛇頭的位置
+struct LodScenario {
+  int numSegments = 7;
+  float simSeconds = 200.0f;
+  float dt = 0.002f;
+};
+
+struct LodResult {
+  std::string name;
+  double usPerStep = 0.0;
+  double travelled = 0.0;  // 蛇頭離起點的水平距離，單位：m
+  double headError = 0.0;  // 與 FULL 的蛇頭距離，單位：m
+};
+
+std::vector<LodResult> runLodComparison(const LodScenario& scenario);
+void printLodReport(std::ostream& out, const LodScenario& scenario, const std::vector<LodResult>& results);
+// SnakeWorld 的自動切換：觀察者在場地一角時，另一角的蛇要換成 KINEMATIC，觀察者走近後要換回 FULL。
+// 每一項印一行 [CHECK]，全部通過回傳 true
+bool checkLodSwitching(std::ostream& out);
+
+// SnakeWorld 在不同蛇數下的吞吐量，每條蛇都用自動駕駛玩遊戲
+struct WorldScenario {
+  std::vector<int> snakeCounts = {1, 10, 100, 1000, 10000, 100000};
+  int numThreads = 0;                          // 0 表示使用 JobSystem::shared()
+  float frameDt = 1.0f / 60.0f;
+  long long snakeFrameBudget = 200000;         // 每個蛇數跑 budget / count 幀（至少 minFrames）
+  int minFrames = 4;
+  Snake::SpringIntegrator integrator = Snake::SpringIntegrator::EXPLICIT;
+  bool numaAware = false;  // 依 NUMA 拓撲綁定執行緒並 shardByNode（需要 numThreads > 0）
+};
+
+struct WorldResult {
+  int snakes = 0;
+  int frames = 0;
+  double stepsPerSecond = 0.0;   // 所有蛇的 Snake::update 次數 / 牆鐘秒
+  double msPerFrame = 0.0;
+  double simSecondsPerSecond = 0.0;  // 所有蛇合計的模擬秒數 / 牆鐘秒
+  std::vector<SnakeWorld::NodeStats> nodes;  // numaAware 時每個節點的計數
+  std::vector<double> nodeStepsPerSecond;
+};
+
+std::vector<WorldResult> runWorldScaling(const WorldScenario& scenario, int* threadsUsed = nullptr);
+void printWorldReport(std::ostream& out, const WorldScenario& scenario, int threadsUsed,
+                      const std::vector<WorldResult>& results);
+
+// MlpPolicy 在不同批次大小下的延遲與吞吐量，隨機權重、隨機輸入
+struct InferenceScenario {
+  std::vector<int> layerSizes = {11, 64, 64, 4};  // VecEnv 的觀察 -> CONTINUOUS_GAIT 的動作
+  std::vector<int> batchSizes = {1, 16, 64, 256, 1024, 4096, 16384};
+  double secondsPerBatchSize = 0.2;
+  int numThreads = 0;  // 0 表示使用 JobSystem::shared()
+};
+
+struct InferenceResult {
+  int batch = 0;
+  double usPerBatch = 0.0;             // 單執行緒一次 forward 的延遲
+  double samplesPerSecond = 0.0;       // 單執行緒（每個核心）的吞吐量
+  double gflops = 0.0;
+  double referenceSamplesPerSecond = 0.0;  // 沒有分塊的參考實作
+  double parallelSamplesPerSecond = 0.0;   // 整批交給 JobSystem
+  double maxError = 0.0;                   // 與參考實作的最大差距
+};
+
+std::vector<InferenceResult> runInferenceBenchmark(const InferenceScenario& scenario, int* threadsUsed = nullptr);
+void printInferenceReport(std::ostream& out, const InferenceScenario& scenario, int threadsUsed,
+                          const std::vector<InferenceResult>& results);
+
+}  // namespace bench
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <glm/glm.hpp>
+#include <thread>
+#include <vector>
+
+#include "SnakeWorld.h"
+#include "SnapshotRing.h"
+#include "SpscQueue.h"
+#include "TripleBuffer.h"
+#include "utils.h"
+
+/**
+ * 專用的物理執行緒
+ *
+ * 以固定的 tick 推進 SnakeWorld，和畫面更新完全分開：畫面慢了物理照樣準時，物理慢了畫面也不會卡住。
+ *   - render 執行緒 -> 物理：send() 把指令放進 wait-free 的 SPSC 佇列，每個 tick 開頭一次處理完；
+ *     佇列滿了就先留在 render 執行緒這邊，之後每次 send() / acquireLatest() 照順序補送，指令不會遺失
+ *   - 物理 -> render 執行緒：每個 tick 結束把要畫的狀態寫進三重緩衝，acquireLatest() 永遠拿到最新的完整一份
+ * 之後 render 執行緒不可以再直接碰 SnakeWorld 或 Snake。
+ *
+ * SET_TIME_SCALE 讓模擬時間比牆鐘快（加速模式）：tick 長度不變，只是 tick 之間睡得比較少，
+ * 所以計時、分數、勝負都照模擬時間走，結果和 1 倍速相同。timeScale 為 0 時完全不睡，CPU 能跑多快就多快。
+ *
+ * 倒帶用的 SnapshotRing 也在這裡，只有物理執行緒會用到。
+ */
+class PhysicsThread {
+ public:
+  struct Command {
+    enum class Type {
+      START,     // 重新開始遊戲
+      PAUSE,
+      RESUME,
+      MOVE,      // direction: 0 前、1 左、2 右；pressed: 按下/放開
+      CYCLE_MOVEMENT_MODE,
+      TOGGLE_FRICTION_MAP,
+      TOGGLE_SPRING_INTEGRATOR,
+      REWIND,    // ticks: 往回幾個 tick
+      SET_TIME_SCALE  // timeScale: 模擬時間 / 牆鐘時間，0 表示不限
+    };
+    Type type;
+    int direction = 0;
+    bool pressed = false;
+    int ticks = 0;
+    float timeScale = 1.0f;
+  };
+
+  // 發佈給 render 執行緒的狀態（被觀察的那一條蛇）
+  struct Frame {
+    long long tick = 0;
+    double simTime = 0.0;   // 累積的模擬秒數（不含暫停，倒帶不回退）
+    float timeScale = 1.0f;
+    std::vector<glm::vec3> positions;
+    float radius = 0.0f;
+    glm::vec3 forwardDirection = glm::vec3(0.0f);
+    glm::vec3 applePosition = glm::vec3(0.0f);
+    int score = 0;
+    float timer = 0.0f;
+    SnakeWorld::GameState state = SnakeWorld::GameState::STOPPED;
+    SnakeWorld::GameResult result = SnakeWorld::GameResult::NONE;
+    bool hitWall = false;
+    bool paused = false;
+    bool frictionMapOn = false;
+    Snake::SpringIntegrator springIntegrator = Snake::SpringIntegrator::EXPLICIT;
+    Snake::MovementMode movementMode = Snake::MovementMode::RECTILINEAR;
+  };
+
+  /**
+   * @param world       要推進的世界，執行緒啟動後只由物理執行緒存取
+   * @param snakeIndex  發佈到 Frame 的蛇
+   * @param tickDt      固定的物理 tick，單位：s
+   * @param frictionMap TOGGLE_FRICTION_MAP 切換用，可以是 nullptr
+   */
+  PhysicsThread(SnakeWorld* world, int snakeIndex, float tickDt, const FrictionMap* frictionMap);
+  ~PhysicsThread();
+  DELETE_COPY(PhysicsThread)
+
+  void start();
+  void stop();
+
+  // render 執行緒呼叫，不會阻塞也不會丟指令（佇列滿了留到下一幀再送）
+  void send(const Command& command);
+  // render 執行緒呼叫，不會阻塞
+  const Frame& acquireLatest() {
+    flushPending();
+    frames.update();
+    return frames.getReadBuffer();
+  }
+
+  float getTickDt() const { return tickDt; }
+
+ private:
+  void run();
+  void applyCommand(const Command& command);
+  void publish();
+  void flushPending();
+
+  SnakeWorld* world;
+  int snakeIndex;
+  float tickDt;
+  const FrictionMap* frictionMap;
+
+  std::thread thread;
+  std::atomic<bool> running{false};
+  SpscQueue<Command, 256> commands;
+  TripleBuffer<Frame> frames;
+  std::deque<Command> pending;  // 只在 render 執行緒使用：佇列滿時還沒送出去的指令
+
+  // 以下只在物理執行緒使用
+  bool paused = false;
+  long long tick = 0;
+  double simTime = 0.0;
+  float timeScale = 1.0f;
+  SnapshotRing history;
+};
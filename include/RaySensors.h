@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "CellList.h"
+#include "SnakeWorld.h"
+
+/**
+ * 蛇的射線感測器：從蛇頭沿著前進方向張開的扇形射出 K 條水平射線，
+ * 回傳每條射線最先打到的東西（牆、蘋果或蛇身）與距離，給 AI 蛇當觀察
+ *
+ * 全部在水平面（x, z）上算：牆是場地的四邊，蘋果是半徑 Rules::appleRadius 的圓，
+ * 蛇身是每個質點半徑 Snake::getRadius() 的圓。射線起點在圓裡面的不算（蛇頭與緊鄰的節）。
+ *
+ * SnakeWorld 裡每條蛇在自己的場地玩，所以預設只看得到自己的身體；seeOtherSnakes 開著時
+ * 把所有蛇當成在同一個場地裡，update() 把全部質點放進 CellList（與 GranularBed 相同的格子），
+ * cast() 只查射線範圍內的格子。
+ *
+ * 每個候選物體對 K 條射線一起做沒有分支的測試（K 在最內層，由編譯器向量化），
+ * cast() 只讀世界、只寫 out，不同的蛇可以在不同執行緒同時算。
+ */
+class RaySensors {
+ public:
+  enum HitType { NONE = 0, WALL = 1, APPLE = 2, BODY = 3 };
+
+  // 每條射線寫出的值：距離 / maxRange（沒打到是 1），接著是牆、蘋果、蛇身的 one-hot
+  static constexpr int VALUES_PER_RAY = 4;
+  static constexpr int MAX_RAYS = 64;
+
+  struct Config {
+    int numRays = 0;                  // 0 表示關閉，最多 MAX_RAYS 條
+    float fieldOfView = 3.14159265f;  // 扇形的張角，單位：rad；第 0 條在最左邊
+    float maxRange = 4.0f;            // m
+    bool seeOtherSnakes = false;
+    float cellSize = 0.5f;            // seeOtherSnakes 的格子大小，m
+  };
+
+  RaySensors(const Config& config, const SnakeWorld::Rules& rules);
+
+  // 每次 SnakeWorld::step 之後、cast 之前呼叫；只有 seeOtherSnakes 時需要做事（收集質點並重建格子）
+  void update(SnakeWorld& world);
+  // 把第 index 條蛇的 getNumValues() 個值寫進 out。自己的身體、蘋果與牆都讀當下的狀態，
+  // 所以剛 start() 過的蛇不必重新 update；其他蛇的位置是上一次 update 的
+  void cast(const SnakeWorld& world, int index, float* out) const;
+  // update 之後平行地算所有蛇，第 i 條寫到 out + i * stride
+  void castAll(SnakeWorld& world, float* out, size_t stride);
+
+  int getNumRays() const { return config.numRays; }
+  int getNumValues() const { return config.numRays * VALUES_PER_RAY; }
+  const Config& getConfig() const { return config; }
+
+ private:
+  struct Rays {
+    float dx[MAX_RAYS], dz[MAX_RAYS];
+    float distance[MAX_RAYS], type[MAX_RAYS];
+  };
+
+  // 把圓心 (cx, cz) 半徑 radius 的圓對所有射線測試一次，比較近的就換掉
+  void hitCircle(float ox, float oz, float cx, float cz, float radius, float hitType, Rays& rays) const;
+
+  Config config;
+  SnakeWorld::Rules rules;
+  std::vector<float> cosAngle, sinAngle;  // 每條射線相對前進方向的轉角
+
+  // seeOtherSnakes：所有蛇的質點（SoA）與所屬的蛇
+  CellList cells;
+  std::vector<float> xs, ys, zs;
+  std::vector<int> owner;
+  std::vector<float> radii;
+};
@@ -4,7 +4,9 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <vector>
 
+#include "FrictionMap.h"
 #include "Mass.h"
+#include "ObjectPool.h"
 #include "Spring.h"
 
 class Snake {
@@ -15,6 +17,18 @@ class Snake {
     RECTILINEAR  // 直線蠕動（蚯蚓式）
   };
 
+  // 彈簧的積分方式
+  enum class SpringIntegrator {
+    EXPLICIT,  // 彈簧力與其他力一起做半隱式 Euler，步長要很小
+    ANALYTIC   // 彈簧軸向用封閉解，其他較慢的力（重力、摩擦、轉向）照舊，可以用大很多的步長
+  };
+
+  // 物理細緻度：沒人看的蛇不需要完整的質點彈簧模擬
+  enum class PhysicsLod {
+    FULL,      // 完整的質點彈簧模擬
+    KINEMATIC  // 頭部當成一個點沿著中心線前進，其他節依序跟隨，不算彈簧與摩擦
+  };
+
   Snake(int numSegments, float segmentMass, float segmentLength, float springK, float damping,
         const glm::vec3& startPos, float radius);
   ~Snake();
@@ -29,8 +43,20 @@ class Snake {
   void stopMoving() { isMoving = false; }
   bool getIsMoving() const { return isMoving; }
   void setSnakeMoveDirection(int index, bool value);
+  // 類比輸入（搖桿或強化學習的連續動作）：forward 在 [0, 1]，turn 在 [-1, 1]（負的往左）
+  // 與三個按鍵相加；按鍵相當於 forward = 1、turn = -1 / +1
+  void setSteering(float forward, float turn);
   void reset();
 
+  // 動態增減節數（吃到蘋果變長）
+  // 質點與彈簧都來自物件池，位址不會變，回傳的 Mass* 可以當作穩定的 handle
+  // 只會重新接上插入/移除位置附近的彈簧，不會重建整條蛇
+  Mass* insertSegment(int index);  // index == 節數 時接在尾巴
+  Mass* growTail() { return insertSegment((int)masses.size()); }
+  bool removeSegment(int index);
+  int indexOf(const Mass* mass) const;
+  int getNumSegments() const { return (int)masses.size(); }
+
   // 模式
   void setMovementMode(MovementMode mode) { movementMode = mode; }
   MovementMode getMovementMode() const { return movementMode; }
@@ -51,6 +77,51 @@ class Snake {
   void setWaveFrequency(float freq) { waveFrequencyRectilinear = freq; }
   float getWaveAmplitude() const { return waveAmplitudeRectilinear; }
   float getWaveFrequency() const { return waveFrequencyRectilinear; }
+
+  // 積分方式與對應的最大子步長，呼叫端用 getMaxSubDt() 決定一幀要切幾步
+  void setSpringIntegrator(SpringIntegrator integrator) { springIntegrator = integrator; }
+  SpringIntegrator getSpringIntegrator() const { return springIntegrator; }
+  float getMaxSubDt() const {
+    // KINEMATIC 沒有彈簧，不受顯式積分的穩定限制
+    if (lod == PhysicsLod::KINEMATIC || springIntegrator == SpringIntegrator::ANALYTIC) return MAX_SUB_DT_ANALYTIC;
+    return MAX_SUB_DT_EXPLICIT;
+  }
+
+  // 細緻度
+  // observed 為 true 時永遠是 FULL；否則 updateLod 依與觀察者的距離切換（有遲滯，避免來回跳）
+  // 切換時保留位置與總動量，中心線上的節距就是彈簧的靜止長度，切回 FULL 時不會彈開
+  void setObserved(bool value) { observed = value; }
+  bool isObserved() const { return observed; }
+  void setLodDistances(float nearDistance, float farDistance) {
+    lodNearDistance = nearDistance;
+    lodFarDistance = farDistance;
+  }
+  void updateLod(const glm::vec3& viewerPos);
+  void setLod(PhysicsLod level);
+  PhysicsLod getLod() const { return lod; }
+
+  // 狀態快照：質點位置/速度/質量、彈簧靜止長度、控制狀態，存成固定格式的二進位資料
+  // 節數相同時 restore 只做 memcpy 等級的複製，不配置記憶體；節數不同時用物件池增減節數
+  static size_t getSnapshotSize(int segmentCount);
+  size_t getSnapshotSize() const { return getSnapshotSize((int)masses.size()); }
+  size_t saveSnapshot(void* buffer, size_t capacity) const;  // 回傳寫入的位元組數，空間不足回傳 0
+  bool restoreSnapshot(const void* buffer, size_t size);
+
+  // 外力（例如沙床的反作用力），在下一次 update 套用後清除
+  void addExternalForce(int index, const glm::vec3& force);
+
+  // 摩擦貼圖，nullptr 時使用原本的 groundFrictionCoeff 與消去向後速度
+  void setFrictionMap(const FrictionMap* map) { frictionMap = map; }
+  const FrictionMap* getFrictionMap() const { return frictionMap; }
+  void setGroundFriction(float coeff) { groundFrictionCoeff = coeff; }
+  // 改變所有彈簧（包括之後長出來的）的剛度與阻尼，不用重建整條蛇
+  void setSpringConstants(float k, float dampingConstant);
+  float getGroundFriction() const { return groundFrictionCoeff; }
+
+  // 驅動做的功（肌肉改變彈簧靜止長度、SIMPLE 模式的頭部推力），單位：J
+  // 給步態調參算能耗用，reset 時歸零，不在快照裡
+  double getActuationWork() const { return actuationWork; }
+  void resetActuationWork() { actuationWork = 0.0; }
   
  private:
 
@@ -66,21 +137,33 @@ class Snake {
   //void enforceDistanceConstraints();
   void enforceSoftDistanceConstraints();*/
   void applySteeringForce();
-  void updateTarget(float dt);
+  void actuateSpring(int index, float restLength);
+  void updateTarget();
   void handleGroundCollision(Mass* mass);
+  void integrateAnalytic(float dt);
+  void updateKinematic(float dt);
+  glm::vec3 getHorizontalMomentumVelocity() const;
   
   // 運動模式
   //void applyLateralUndulation();
   void applyRectilinearProgression();
   void applyGroundFriction(Mass* mass);
   void applyDirectionalFriction();
+  void applyMappedFriction();
+  glm::vec3 getBodyTangent(int i) const;
 
   // 數據
+  // 一塊 16 個：遊戲中吃完蘋果的長度放得下，SnakeWorld 有上萬條蛇時也不會浪費太多
+  ObjectPool<Mass, 16> massPool;
+  ObjectPool<Spring, 16> springPool;
   std::vector<Mass*> masses;
-  std::vector<Spring*> axialSprings;
+  std::vector<Spring*> axialSprings;  // axialSprings[i] 連接 masses[i] 與 masses[i + 1]
+  std::vector<glm::vec3> externalForces;
 
   // 參數
-  int numSegments;
+  struct SnapshotHeader;
+
+  int numSegments;  // 建立時的節數，reset 會回到這個長度
   float segmentMass;
   float segmentLength;
   float springK;
@@ -91,25 +174,47 @@ class Snake {
   float steeringStrength = 0.05f;  // 12211759 for experiment we can change this value
   
   // 運動狀態
-  glm::vec3 forwardDirection;
-  glm::vec3 targetDirection;
+  glm::vec3 forwardDirection = glm::vec3(1.0f, 0.0f, 0.0f);  // 與 reset() 相同
+  glm::vec3 targetDirection = glm::vec3(1.0f, 0.0f, 0.0f);
   float waveAmplitudeRectilinear = 10.0f; //如果覺得爬太慢了，調這個
   float waveFrequencyRectilinear = 1.2f;
   //float waveSpeed;
   bool isMoving;
   bool snakeMoveDirection[3] = {false, false, false};  // 前、左、右
+  float steerForward = 0.0f;                           // setSteering 的類比輸入
+  float steerTurn = 0.0f;
   float movementTimer = 0.0f;
   float groundFrictionCoeff = 0.2f;
+  const FrictionMap* frictionMap = nullptr;
+  std::vector<float> frictionScratch;  // 取樣用暫存: x, z, forward, backward, lateral 各 numSegments 個
 
 
   // 環境
   float groundHeight; 
   MovementMode movementMode;
+  SpringIntegrator springIntegrator = SpringIntegrator::EXPLICIT;
+  std::vector<float> springCorrections;  // 解析解積分位置更新後要補的相對速度
+
+  // 細緻度
+  PhysicsLod lod = PhysicsLod::FULL;
+  bool observed = false;
+  float lodNearDistance = 4.0f;  // 預設約為遊戲場地對角線（9.7 m）的 0.4 與 0.6 倍
+  float lodFarDistance = 6.0f;
+  float crawlSpeed = DEFAULT_CRAWL_SPEED;  // FULL 模式下量到的平均爬行速度，KINEMATIC 用來前進
+  double actuationWork = 0.0;
+  float kinematicSpeed = 0.0f;
   
   // 常數
   static constexpr float GRAVITY = 9.8f;
+  static constexpr float MAX_SUB_DT_EXPLICIT = 0.002f;
+  static constexpr float MAX_SUB_DT_ANALYTIC = 0.02f;
+  static constexpr float DEFAULT_CRAWL_SPEED = 0.24f;  // 預設參數下直線蠕動的速度，m/s
+  static constexpr float CRAWL_SPEED_TAU = 2.0f;       // 量爬行速度的平滑時間，比蠕動週期長
+  static constexpr float KINEMATIC_ACCEL = 0.5f;       // m/s^2
+  static constexpr float KINEMATIC_TURN_RATE = 1.0f;   // rad/s
   // static constexpr float GROUND_HEIGHT = 0.15f;
   static constexpr float FRICTION_FORWARD = 0.5f;
+  static constexpr float FRICTION_SLIP_EPS = 0.05f;  // 低於這個速度摩擦力線性變小，避免來回抖動
   //static constexpr float FRICTION_LATERAL = 3.0f;
 
   
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "JobSystem.h"
+#include "PathPlanner.h"
+#include "Snake.h"
+#include "utils.h"
+
+/**
+ * 多條蛇的批次模擬
+ *
+ * 每條蛇都在自己的一份場地裡玩貪食蛇（彼此不碰撞）：各自有蘋果、分數、計時與勝負，
+ * 所以可以完全平行地更新。step(dt) 把蛇交給 JobSystem，每條蛇依自己的 getMaxSubDt() 切子步。
+ *
+ * 蘋果位置用每條蛇自己的亂數產生器，結果與執行緒數量無關。
+ *
+ * setViewer() 之後每一步依蛇頭與觀察者的距離切換 Snake::PhysicsLod（見 Rules::lodNear / lodFar），
+ * 觀察者以場地座標表示，每份場地都當成從同一個位置看；setObserved 的蛇永遠是 FULL。
+ *
+ * 多插槽的機器上可以呼叫 shardByNode()：蛇依 JobSystem 的 NUMA 節點切成連續的分片，
+ * 每個分片在自己節點的執行緒上重新建立（記憶體第一次寫入在本地節點），之後也只交給該節點更新。
+ */
+class SnakeWorld {
+ public:
+  // 每條蛇的參數，預設值與遊戲中的蛇相同
+  struct SnakeParams {
+    int numSegments = 7;
+    float segmentMass = 0.02f;
+    float segmentLength = 0.178f;
+    float springK = 1.0f;
+    float damping = 3.5f;
+    float radius = 0.2f;
+    Snake::SpringIntegrator integrator = Snake::SpringIntegrator::EXPLICIT;
+    const FrictionMap* frictionMap = nullptr;  // 以場地座標取樣，要比 SnakeWorld 活得久；nullptr 表示均勻摩擦
+  };
+
+  // 遊戲規則，預設值與 main.cpp 的場地相同
+  struct Rules {
+    float arenaWidth = 8.192f;
+    float arenaDepth = 5.12f;
+    float wallMargin = 0.3f;      // 蛇頭離牆小於這個距離算撞牆
+    float appleRadius = 0.5f;     // 蛇頭離蘋果小於這個距離算吃到
+    float appleMargin = 1.0f;     // 蘋果離牆至少這麼遠
+    float appleHeight = 0.4f;
+    glm::vec3 firstApple = glm::vec3(3.0f, 0.4f, 3.0f);
+    float timeLimit = 60.0f;
+    int winScore = 5;
+    // 有觀察者時，蛇頭離觀察者超過場地對角線的 lodFar 倍改用 KINEMATIC，小於 lodNear 倍切回 FULL
+    float lodNear = 0.4f;
+    float lodFar = 0.6f;
+  };
+
+  enum class GameState { STOPPED, RUNNING };
+  enum class GameResult { NONE, WIN, LOSE };
+
+  struct Agent {
+    std::unique_ptr<Snake> snake;
+    SnakeParams params;  // 建立時的參數，shardByNode 重新建立時用
+    glm::vec3 startPos;
+    glm::vec3 applePosition;
+    int score = 0;
+    float timer = 0.0f;  // 剩餘時間
+    float elapsed = 0.0f;
+    GameState state = GameState::STOPPED;
+    GameResult result = GameResult::NONE;
+    bool hitWall = false;  // LOSE 的原因：撞牆（false 表示時間到）
+    bool autopilot = false;  // true 時每一步自動轉向蘋果
+    std::unique_ptr<PathPlanner> planner;  // 有的話自動駕駛沿著規劃的路繞過牆與自己的身體
+    std::mt19937 rng;
+  };
+
+  // 每個 NUMA 節點分片的計數
+  struct NodeStats {
+    int snakes = 0;
+    long long snakeSteps = 0;   // 這個分片的 Snake::update 次數
+    long long remoteSteps = 0;  // 其中被其他節點（或不屬於 JobSystem）的執行緒做掉的
+  };
+
+  struct Stats {
+    long long snakeSteps = 0;  // 所有蛇的 Snake::update 次數
+    double elapsedMs = 0.0;
+    double lastStepMs = 0.0;
+    std::vector<NodeStats> nodes;  // shardByNode 之後才有
+    double stepsPerSecond() const { return elapsedMs > 0.0 ? snakeSteps * 1000.0 / elapsedMs : 0.0; }
+    double nodeStepsPerSecond(int node) const {
+      return elapsedMs > 0.0 ? nodes[node].snakeSteps * 1000.0 / elapsedMs : 0.0;
+    }
+  };
+
+  explicit SnakeWorld(const Rules& rules, JobSystem* jobs = nullptr);  // nullptr 表示使用 JobSystem::shared()
+  DELETE_COPY(SnakeWorld)
+
+  // 回傳蛇的編號；startPos 是蛇頭位置，seed 決定這條蛇的蘋果序列。會取消 shardByNode 的分片
+  int addSnake(const SnakeParams& params, const glm::vec3& startPos, unsigned int seed);
+  // 依各節點的執行緒數把蛇切成分片，並在所屬節點上依 SnakeParams 重新建立蛇（回到剛建立的狀態），
+  // 所以要在 start 之前、其他設定（觀察、摩擦貼圖）之前呼叫。只有一個節點時不做事
+  void shardByNode();
+  int getNumShards() const { return (int)shards.size(); }
+  void reserve(int count) { agents.reserve(count); }
+
+  void start(int index);  // 重置蛇、分數、計時與蘋果，開始遊戲
+  void startAll();
+  void setInput(int index, bool forward, bool left, bool right);
+  void setSteering(int index, float forward, float turn) { agents[index].snake->setSteering(forward, turn); }
+  void setAutopilot(int index, bool enabled) { agents[index].autopilot = enabled; }
+  // 開啟自動駕駛並改用 PathPlanner（D* Lite）找路，每條蛇各自一份規劃狀態
+  void setPlannedAutopilot(int index, const PathPlanner::Config& config = PathPlanner::Config());
+  // 觀察者（通常是相機）的位置；沒有觀察者時不切換細緻度
+  void setViewer(const glm::vec3& position) {
+    viewer = position;
+    hasViewer = true;
+  }
+  void clearViewer() { hasViewer = false; }
+  int countLod(Snake::PhysicsLod lod) const;
+
+  // 推進 dt 秒（通常是一幀），只更新 RUNNING 的蛇
+  void step(float dt);
+
+  int getNumSnakes() const { return (int)agents.size(); }
+  Agent& getAgent(int index) { return agents[index]; }
+  const Agent& getAgent(int index) const { return agents[index]; }
+  Snake* getSnake(int index) { return agents[index].snake.get(); }
+  const Rules& getRules() const { return rules; }
+  int getNumThreads() const { return jobs->getNumThreads(); }
+  JobSystem& getJobs() { return *jobs; }
+  const Stats& getStats() const { return stats; }
+  void resetStats();
+
+ private:
+  struct Shard {
+    int node;
+    int begin;
+    int end;
+  };
+
+  long long stepAgent(Agent& agent, float dt);  // 回傳子步數
+  void stepShards(float dt);
+  void steerTowardApple(Agent& agent);
+  void steerAlongPath(Agent& agent);
+  glm::vec3 randomApplePosition(Agent& agent);
+  bool hitWall(const Agent& agent) const;
+  void applyLodDistances(Snake& snake) const;
+
+  Rules rules;
+  std::vector<Agent> agents;
+  std::vector<Shard> shards;
+  JobSystem* jobs;
+  Stats stats;
+  glm::vec3 viewer = glm::vec3(0.0f);
+  bool hasViewer = false;
+};
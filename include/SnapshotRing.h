@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "utils.h"
+
+class Snake;
+
+/**
+ * 蛇狀態的環狀緩衝區（倒帶、分支實驗、當機重現用）
+ *
+ * 建立時一次配置 capacity 個固定大小的格子，之後 record / restore 都不會再配置記憶體。
+ * 每格記錄一個 tick 的 Snake 快照，滿了之後覆蓋最舊的。tick 必須遞增。
+ *
+ * 用法：
+ *   SnapshotRing ring(600, Snake::getSnapshotSize(64));
+ *   ring.record(*snake, tick);        // 每個 tick 呼叫
+ *   ring.rewind(*snake, 60);          // 回到 60 個 tick 前，之後的紀錄會被丟掉
+ *   ring.writeFile("crash.snap");     // 存檔，之後用 SnapshotRing::fromFile 讀回來重現
+ */
+class SnapshotRing {
+ public:
+  SnapshotRing(int capacity, size_t slotBytes);
+  DELETE_COPY(SnapshotRing)
+
+  // 快照超過 slotBytes 時回傳 false，不會覆蓋任何紀錄
+  bool record(const Snake& snake, long long tick);
+  // 還原到指定 tick，找不到回傳 false
+  bool restore(Snake& snake, long long tick) const;
+  // 還原到往回第 ticksBack 筆紀錄（超過就用最舊的），並丟掉比它新的紀錄；回傳還原後的 tick，沒有紀錄回傳 -1
+  long long rewind(Snake& snake, int ticksBack);
+  // 丟掉比 tick 新的紀錄（分支實驗從這裡繼續）
+  void truncateAfter(long long tick);
+  void clear() { count = 0; }
+
+  int size() const { return count; }
+  int getCapacity() const { return capacity; }
+  size_t getSlotBytes() const { return slotBytes; }
+  long long getOldestTick() const { return count > 0 ? ticks[slotOf(0)] : -1; }
+  long long getNewestTick() const { return count > 0 ? ticks[slotOf(count - 1)] : -1; }
+
+  // 二進位檔案，失敗時回傳 false / NULL
+  bool writeFile(const char* filename) const;
+  static SnapshotRing* fromFile(const char* filename);
+
+ private:
+  int slotOf(int logicalIndex) const { return (first + logicalIndex) % capacity; }
+  int find(long long tick) const;  // 回傳邏輯索引（0 = 最舊），找不到回傳 -1
+
+  int capacity;
+  size_t slotBytes;
+  int first = 0;  // 最舊紀錄所在的格子
+  int count = 0;
+  std::vector<unsigned char> storage;
+  std::vector<long long> ticks;
+  std::vector<size_t> sizes;
+};
@@ -3,8 +3,14 @@
 #include <glm/glm.hpp>
 #include "Mass.h"
 
-class Spring {
+/**
+ * 彈簧，精度與 BasicMass 相同：T 為長度與參數的精度，Acc 為計算力的精度
+ */
+template <typename T, typename Acc = T>
+class BasicSpring {
  public:
+  using MassType = BasicMass<T, Acc>;
+
   /**
    * 
    * @param m1 質量1
@@ -13,7 +19,7 @@ class Spring {
    * @param restLength 靜止長度 L，單位：m
    * @param dampingConstant 阻尼係數 D，單位：Ns/m
    */
-  Spring(Mass* m1, Mass* m2, float springConstant, float restLength, float dampingConstant);
+  BasicSpring(MassType* m1, MassType* m2, T springConstant, T restLength, T dampingConstant);
 
   /**
    * 計算並施加彈簧力
@@ -24,6 +30,22 @@ class Spring {
    */
   void applyForce();
 
+  /**
+   * 解析解子積分的前半段
+   * 沿彈簧軸向的相對運動是一維的彈簧-阻尼系統 mu * x'' + D * x' + k * x = 0，
+   * 其中 mu 為兩質點的約化質量，有封閉解，任何 dt 都穩定。
+   * 1. 由目前的相對位移 x0、相對速度 v0 算出 dt 後的 x(dt)、v(dt)
+   * 2. 給兩個質點沿軸向的衝量，讓位置積分後的相對位移剛好是 x(dt)
+   *
+   * @return 位置更新之後還要補的相對速度 v(dt) - (x(dt) - x0) / dt，交給 applyAxialImpulse
+   */
+  T beginAnalyticStep(T dt);
+
+  /**
+   * 沿目前的彈簧軸向改變相對速度 dv，依質量分配，總動量不變
+   */
+  void applyAxialImpulse(T relativeVelocityChange);
+
   /**
    * 設置靜止長度
    * 這是模擬肌肉收縮的關鍵！
@@ -31,21 +53,37 @@ class Spring {
    *
    * @param length 新的靜止長度
    */
-  void setRestLength(float length) { restLength = length; }
+  void setRestLength(T length) { restLength = length; }
 
   /**
    * 獲取靜止長度
    */
-  float getRestLength() const { return restLength; }
+  T getRestLength() const { return restLength; }
+
+  // 改變剛度與阻尼（調參時重複使用同一條蛇）
+  void setConstants(T k, T damping) {
+    springConstant = k;
+    dampingConstant = damping;
+  }
 
   // === Getters ===
-  Mass* getMass1() const { return mass1; }
-  Mass* getMass2() const { return mass2; }
+  MassType* getMass1() const { return mass1; }
+  MassType* getMass2() const { return mass2; }
+
+  // 蛇增減節數時重新接上相鄰的質點
+  void setMasses(MassType* m1, MassType* m2) {
+    mass1 = m1;
+    mass2 = m2;
+  }
 
  private:
-  Mass* mass1;            // 第一個質點
-  Mass* mass2;            // 第二個質點
-  float springConstant;   // k - 彈簧常數（剛度）
-  float restLength;       // L - 靜止長度
-  float dampingConstant;  // D - 阻尼係數
+  MassType* mass1;    // 第一個質點
+  MassType* mass2;    // 第二個質點
+  T springConstant;   // k - 彈簧常數（剛度）
+  T restLength;       // L - 靜止長度
+  T dampingConstant;  // D - 阻尼係數
 };
+
+using Spring = BasicSpring<float>;
+using SpringD = BasicSpring<double>;
+using SpringMixed = BasicSpring<float, double>;
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+#include "utils.h"
+
+/**
+ * 固定容量的單一生產者、單一消費者佇列
+ *
+ * push / pop 都是 wait-free：各自只讀對方的索引、寫自己的索引，沒有迴圈重試。
+ * 滿了 push 回傳 false，空的 pop 回傳 false。
+ */
+template <typename T, size_t Capacity>
+class SpscQueue {
+ public:
+  SpscQueue() = default;
+  DELETE_COPY(SpscQueue)
+
+  bool push(const T& value) {
+    size_t t = tail.load(std::memory_order_relaxed);
+    if (t - head.load(std::memory_order_acquire) >= Capacity) return false;
+    items[t % Capacity] = value;
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(T& value) {
+    size_t h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire)) return false;
+    value = items[h % Capacity];
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+ private:
+  T items[Capacity];
+  alignas(64) std::atomic<size_t> head{0};
+  alignas(64) std::atomic<size_t> tail{0};
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <glad/gl.h>
+#include <cstddef>
+
+#include "utils.h"
+
+/**
+ * 每幀變動的頂點資料（蛇每節的實例、方向指示器）用的串流緩衝
+ *
+ * 一個長期存在的 GL buffer 切成 NUM_REGIONS 段，每一幀只寫其中一段，所以 CPU 寫的時候 GPU 讀的是前幾幀的段落。
+ * 有 GL 4.4 或 ARB_buffer_storage 時整個 buffer 持續映射（persistent + coherent），upload 只是 memcpy，
+ * 每段用完放一個 fence，下一次輪到這段時才等它；沒有時退回 glBufferSubData，每次繞回第一段先 orphan。
+ * 兩種做法每幀都不會建立或刪除 GL 物件。建構與所有呼叫都需要目前的 GL context。
+ */
+class StreamBuffer {
+ public:
+  static constexpr int NUM_REGIONS = 3;
+  static constexpr size_t ALIGNMENT = 16;
+
+  explicit StreamBuffer(size_t regionSize = 64 * 1024);
+  ~StreamBuffer();
+  DELETE_COPY(StreamBuffer)
+
+  // 每幀畫任何東西之前呼叫：換到下一段，GPU 還沒用完時等它
+  void beginFrame();
+  // 這一幀所有用到串流資料的繪圖指令都送出之後呼叫
+  void endFrame();
+  // 複製進這一段並回傳在 buffer 裡的位元組位移；放不下時印出 [ERROR]（只印一次）並回傳 -1
+  GLintptr upload(const void* data, size_t size);
+
+  GLuint getBuffer() const { return buffer; }
+  bool isPersistent() const { return mapped != nullptr; }
+
+ private:
+  GLuint buffer = 0;
+  unsigned char* mapped = nullptr;
+  size_t regionSize;
+  int region = 0;
+  size_t head = 0;
+  GLsync fences[NUM_REGIONS] = {};
+  bool overflowReported = false;
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "utils.h"
+
+/**
+ * 單一寫入者、單一讀取者的三重緩衝
+ *
+ * 寫入者永遠寫自己的那一份，寫完 publish() 與中間那一份交換；
+ * 讀取者 update() 時如果中間有新資料，就與自己的那一份交換。
+ * 兩邊都只做一次原子交換，不會互相等待，讀取者拿到的一定是完整的最新一份。
+ */
+template <typename T>
+class TripleBuffer {
+ public:
+  TripleBuffer() = default;
+  DELETE_COPY(TripleBuffer)
+
+  // ===== 寫入端 =====
+  T& getWriteBuffer() { return buffers[writeIndex]; }
+  void publish() { writeIndex = shared.exchange(writeIndex | DIRTY, std::memory_order_acq_rel) & INDEX_MASK; }
+
+  // ===== 讀取端 =====
+  // 有新資料時換過來並回傳 true
+  bool update() {
+    if (!(shared.load(std::memory_order_relaxed) & DIRTY)) return false;
+    readIndex = shared.exchange(readIndex, std::memory_order_acq_rel) & INDEX_MASK;
+    return true;
+  }
+  const T& getReadBuffer() const { return buffers[readIndex]; }
+
+ private:
+  static constexpr uint8_t INDEX_MASK = 3;
+  static constexpr uint8_t DIRTY = 4;
+
+  T buffers[3];
+  alignas(64) uint8_t writeIndex = 0;
+  alignas(64) std::atomic<uint8_t> shared{1};
+  alignas(64) uint8_t readIndex = 2;
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "RaySensors.h"
+#include "SnakeWorld.h"
+#include "utils.h"
+
+/**
+ * 給強化學習用的批次環境：N 條蛇各玩各的貪食蛇，一次 step 全部推進
+ *
+ * 動作、觀察、獎勵與結束旗標都是以環境為主的連續陣列，放在呼叫端給的記憶體裡
+ * （可以是 shm_open / mmap 出來、和訓練程式共用的共享記憶體），step 直接讀寫這些陣列，不做任何複製。
+ * 沒有 bind 時使用自己配置的一塊。
+ *
+ * 一回合結束（吃滿、撞牆或時間到）時，該步的獎勵與旗標照常寫出，autoReset 開著的話
+ * 觀察已經是新一回合的第一個觀察，結束前的最後觀察寫在 finalObservations（有給的話）。
+ */
+class VecEnv {
+ public:
+  enum class ActionMode {
+    BUTTONS,          // 每個環境 3 個值：前、左、右，大於 0.5 算按下（與 I/J/L 相同）
+    CONTINUOUS,       // 每個環境 2 個值：forward 在 [0, 1]、turn 在 [-1, 1]，見 Snake::setSteering
+    CONTINUOUS_GAIT  // 再加 2 個步態命令：蠕動頻率與振幅各乘上 1 + 值，值夾在 [-0.5, 0.5]
+  };
+
+  // 觀察（都在蛇頭的水平座標系裡，長度單位：m）：
+  //   0-1  蛇頭位置 / 場地大小      2-3  前進方向 x, z
+  //   4-5  到蘋果的向量（前、右）    6    到蘋果的距離
+  //   7    蛇頭往前的速度            8    離最近的牆的距離
+  //   9    分數 / winScore           10   剩餘時間 / timeLimit
+  // Config::rays.numRays > 0 時後面接著射線感測器的值，見 RaySensors（getObservationSize() 是總長度）
+  static constexpr int OBSERVATION_SIZE = 11;
+
+  struct Config {
+    int numEnvs = 16;
+    ActionMode actionMode = ActionMode::BUTTONS;
+    float dt = 1.0f / 60.0f;  // 每次 step 推進的時間，蛇依自己的 getMaxSubDt() 切子步
+    bool autoReset = true;
+    unsigned int seed = 0;  // 第 i 個環境的蘋果序列用 seed + i
+    float appleReward = 1.0f;
+    float wallPenalty = 1.0f;
+    float approachReward = 1.0f;  // 每往蘋果靠近 1 m
+    SnakeWorld::Rules rules;
+    SnakeWorld::SnakeParams snake;
+    glm::vec3 startPos = glm::vec3(4.0f, 0.5f, 2.5f);
+    RaySensors::Config rays;  // 預設關閉
+  };
+
+  struct Buffers {
+    float* actions = nullptr;            // numEnvs x getActionSize()，呼叫端在 step 之前寫入
+    float* observations = nullptr;       // numEnvs x getObservationSize()
+    float* rewards = nullptr;            // numEnvs
+    uint8_t* terminated = nullptr;       // numEnvs，吃滿或撞牆
+    uint8_t* truncated = nullptr;        // numEnvs，時間到
+    float* finalObservations = nullptr;  // numEnvs x getObservationSize()，可以是 nullptr
+  };
+
+  // 所有陣列排在一塊記憶體裡的位置（相對於開頭的位元組數，每個都 64 位元組對齊）
+  struct Layout {
+    size_t actions = 0;
+    size_t observations = 0;
+    size_t rewards = 0;
+    size_t terminated = 0;
+    size_t truncated = 0;
+    size_t finalObservations = 0;
+    size_t totalSize = 0;
+  };
+  static Layout getLayout(const Config& config);
+  static int getActionSize(ActionMode mode) {
+    return mode == ActionMode::BUTTONS ? 3 : mode == ActionMode::CONTINUOUS ? 2 : 4;
+  }
+  static int getObservationSize(const Config& config) {
+    return OBSERVATION_SIZE + std::clamp(config.rays.numRays, 0, RaySensors::MAX_RAYS) * RaySensors::VALUES_PER_RAY;
+  }
+
+  explicit VecEnv(const Config& config, JobSystem* jobs = nullptr);  // nullptr 表示使用 JobSystem::shared()
+  DELETE_COPY(VecEnv)
+
+  // 改用呼叫端的記憶體；除了 finalObservations 都不能是 nullptr，否則印出 [ERROR] 並回傳 false
+  bool bind(const Buffers& buffers);
+  // 依 getLayout 切開一塊記憶體；size 不夠時印出 [ERROR] 並回傳 false
+  bool bindBlock(void* memory, size_t size);
+  const Buffers& getBuffers() const { return buffers; }
+
+  // 重置 mask[i] != 0 的環境並寫出它們的觀察，mask 為 nullptr 時全部重置；建好之後要先呼叫一次
+  void reset(const uint8_t* mask = nullptr);
+  // 套用動作並推進 dt，actions 為 nullptr 時讀 bind 的 actions 陣列
+  void step(const float* actions = nullptr);
+
+  int getNumEnvs() const { return config.numEnvs; }
+  int getActionSize() const { return getActionSize(config.actionMode); }
+  int getObservationSize() const { return getObservationSize(config); }
+  const Config& getConfig() const { return config; }
+  SnakeWorld& getWorld() { return world; }
+  long long getEpisodeCount() const { return episodes; }
+
+ private:
+  struct EnvState {
+    int score = 0;
+    float appleDistance = 0.0f;
+    bool running = false;
+  };
+
+  void startEnv(int index);
+  void applyAction(int index, const float* action);
+  void writeObservation(int index, float* out) const;
+  float getAppleDistance(int index) const;
+
+  Config config;
+  SnakeWorld world;
+  RaySensors sensors;
+  std::vector<EnvState> envs;
+  std::vector<unsigned char> ownBlock;
+  Buffers buffers;
+  long long episodes = 0;
+  float baseWaveFrequency = 0.0f;  // CONTINUOUS_GAIT 的基準，取自剛建好的蛇
+  float baseWaveAmplitude = 0.0f;
+};
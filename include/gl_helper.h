@@ -1,6 +1,8 @@
 #pragma once
 
 #include <glad/gl.h>
+#include <string>
+#include <vector>
 
 GLuint quickCreateProgram(const char* vert_shader_filename, const char* frag_shader_filename);
 
@@ -8,4 +10,8 @@ GLuint createShader(const char* filename, GLenum type);
 
 GLuint createProgram(GLuint vert, GLuint frag);
 
-GLuint createTexture(const char* filename);
\ No newline at end of file
+GLuint createTexture(const char* filename);
+
+// 用 JobSystem 平行解碼圖檔並暫存，之後 createTexture 同一個檔案時只需要上傳到 GPU
+void prefetchTextures(const std::vector<std::string>& filenames);
+void clearTextureCache();
\ No newline at end of file
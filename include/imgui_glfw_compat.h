@@ -0,0 +1,11 @@
+#pragma once
+
+// extern/glfw 是 3.4 正式版之前的版本：版本號已經是 3.4，卻還沒有 glfwGetPlatform()，
+// imgui_impl_glfw.cpp 在 Linux 上依版本號呼叫它就編不過。這版 GLFW 的平台在編譯時決定（預設 X11），
+// 所以一律回報不是 Wayland。只在 CMake 的 Linux 建置裡強制 include 給 imgui_impl_glfw.cpp。
+#include <GLFW/glfw3.h>
+
+#ifndef GLFW_PLATFORM_WAYLAND
+#define GLFW_PLATFORM_WAYLAND 0x00060003
+inline int glfwGetPlatform() { return 0; }
+#endif
@@ -0,0 +1,35 @@
+#include "CellList.h"
+#include <algorithm>
+
+CellList::CellList(const glm::vec3& boundsMin, const glm::vec3& boundsMax, float cellSize)
+    : boundsMin(boundsMin), cellSize(cellSize), invCellSize(1.0f / cellSize) {
+  dims = glm::max(glm::ivec3(glm::ceil((boundsMax - boundsMin) * invCellSize)), glm::ivec3(1));
+  cellStart.assign((size_t)dims.x * dims.y * dims.z + 1, 0);
+}
+
+void CellList::build(const float* xs, const float* ys, const float* zs, int count) {
+  cellOf.resize(count);
+  order.resize(count);
+  std::fill(cellStart.begin(), cellStart.end(), 0);
+
+  // 1. 計算每格的點數
+  for (int i = 0; i < count; ++i) {
+    int cell = cellIndex(cellCoord(xs[i], ys[i], zs[i]));
+    cellOf[i] = cell;
+    ++cellStart[cell + 1];
+  }
+
+  // 2. 前綴和得到每格起點
+  for (size_t c = 1; c < cellStart.size(); ++c) {
+    cellStart[c] += cellStart[c - 1];
+  }
+
+  // 3. 依格子放入（借用 cellStart 當游標，最後再往回移一格）
+  for (int i = 0; i < count; ++i) {
+    order[cellStart[cellOf[i]]++] = i;
+  }
+  for (size_t c = cellStart.size() - 1; c > 0; --c) {
+    cellStart[c] = cellStart[c - 1];
+  }
+  cellStart[0] = 0;
+}
@@ -0,0 +1,336 @@
+#include "DiffSnake.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+namespace gait {
+
+namespace {
+
+const double GRAVITY = 9.8;
+const double MAX_SUB_DT = 0.002;          // 與 Snake 的 EXPLICIT 相同
+const int WAVE_LENGTH = 3;                // Snake::waveLength
+const double CONTACT_STIFFNESS = 1.0e4;   // 每單位質量，1/s^2，靜止時陷入地面約 1 mm
+const double CONTACT_DAMPING = 100.0;     // 每單位質量，1/s
+const double CONTACT_SMOOTHING = 0.002;   // softplus 的寬度，單位：m
+const double BACKSLIDE_RATE = 200.0;      // 往後滑時的黏滯，1/s，取代直接消去向後速度
+const double BACKSLIDE_SMOOTHING = 0.005; // 單位：m/s
+const double FRICTION_SLIP_EPS = 0.01;    // 低於這個速度摩擦力平滑地變小，單位：m/s
+const double LENGTH_SMOOTHING = 0.001;    // 彈簧與切線的長度用 sqrt(|d|^2 + eps^2)，兩點重疊時方向平滑地變 0，單位：m
+const double MIN_REST_FRACTION = 0.2;     // 肌肉把靜止長度縮到最短是 segmentLength 的這個比例
+const double REST_SMOOTHING_FRACTION = 0.05;  // 最短長度的 softplus 寬度，也是 segmentLength 的比例
+const double MAX_ADJOINT = 1.0e6;         // 伴隨變數超過這個大小就當作梯度爆掉了，正常的回合在 10 以下
+const double TWO_PI = 6.283185307179586;
+
+// softplus(z) / beta，z 很大時約等於 z，很小時趨近 0
+double softplus(double z, double beta) {
+  return (std::max(beta * z, 0.0) + std::log1p(std::exp(-std::abs(beta * z)))) / beta;
+}
+
+double sigmoid(double z) {
+  if (z >= 0.0) return 1.0 / (1.0 + std::exp(-z));
+  double e = std::exp(z);
+  return e / (1.0 + e);
+}
+
+glm::dvec3 horizontal(glm::dvec3 a) { return glm::dvec3(a.x, 0.0, a.z); }
+
+double smoothLength(const glm::dvec3& d) { return std::sqrt(glm::dot(d, d) + LENGTH_SMOOTHING * LENGTH_SMOOTHING); }
+
+// 肌肉的靜止長度 s0 (1 - A sin(angle))，振幅大時會變成負的，用 softplus 平滑地夾在 MIN_REST_FRACTION * s0 以上。
+// slope 回傳 d 夾住後 / d 夾住前
+double restLengthOf(double segmentLength, double amplitude, double angle, double* slope) {
+  double minimum = MIN_REST_FRACTION * segmentLength;
+  double beta = 1.0 / (REST_SMOOTHING_FRACTION * segmentLength);
+  double raw = segmentLength * (1.0 - amplitude * std::sin(angle));
+  if (slope) *slope = sigmoid(beta * (raw - minimum));
+  return minimum + softplus(raw - minimum, beta);
+}
+
+bool isFinite(const glm::dvec3& a) { return std::isfinite(a.x) && std::isfinite(a.y) && std::isfinite(a.z); }
+
+}  // namespace
+
+DiffSnake::DiffSnake(int numSegments, const EvalSettings& settings, int checkpointInterval)
+    : n(std::max(3, numSegments)), segmentLength(settings.segmentLength), groundHeight(settings.radius) {
+  int substeps = std::max(1, (int)std::ceil(settings.dt / MAX_SUB_DT));
+  h = (double)settings.dt / substeps;
+  numSteps = (int)std::ceil(settings.simSeconds / settings.dt) * substeps;
+  interval = checkpointInterval > 0 ? checkpointInterval : std::max(1, (int)std::sqrt((double)numSteps));
+  int numCheckpoints = (numSteps + interval - 1) / interval;
+
+  // 質量分布與 Snake::createMassSpringSystem 相同
+  mass.resize(n);
+  for (int i = 0; i < n; ++i) {
+    mass[i] = settings.segmentMass * (0.5 + std::min(0.5, (double)i / n));
+    totalMass += mass[i];
+  }
+  phase.resize(n - 1);
+  for (int j = 0; j < n - 1; ++j) phase[j] = TWO_PI * (j % WAVE_LENGTH) / WAVE_LENGTH;
+  forward = glm::dvec3(-1.0, 0.0, 0.0);  // 頭在 x 最小的那端
+
+  x.resize(n);
+  v.resize(n);
+  force.resize(n);
+  checkpointX.resize((size_t)numCheckpoints * n);
+  checkpointV.resize((size_t)numCheckpoints * n);
+  segmentX.resize((size_t)interval * n);
+  segmentV.resize((size_t)interval * n);
+  xBar.resize(n);
+  vBar.resize(n);
+  lambda.resize(n);
+}
+
+const char* DiffSnake::getParamName(int param) {
+  static const char* const names[NUM_PARAMS] = {"springK", "damping", "waveAmplitude", "waveFrequency",
+                                                "groundFriction"};
+  return param >= 0 && param < NUM_PARAMS ? names[param] : "";
+}
+
+void DiffSnake::setParams(const GaitParams& params) {
+  c.springK = params.springK;
+  c.damping = params.damping;
+  c.amplitude = params.waveAmplitude;
+  c.omega = TWO_PI * params.waveFrequency;
+  c.friction = params.groundFriction;
+}
+
+// 與 Snake 剛建好時相同：伸直躺在地上、靜止
+void DiffSnake::resetState(glm::dvec3* xs, glm::dvec3* vs) const {
+  for (int i = 0; i < n; ++i) {
+    xs[i] = glm::dvec3(i * segmentLength, groundHeight, 0.0);
+    vs[i] = glm::dvec3(0.0);
+  }
+}
+
+// ========== 前向 ==========
+
+void DiffSnake::computeForces(const glm::dvec3* xs, const glm::dvec3* vs, double t, glm::dvec3* f) const {
+  for (int i = 0; i < n; ++i) f[i] = glm::dvec3(0.0, -GRAVITY * mass[i], 0.0);
+
+  // 軸向彈簧，靜止長度 L = s0 (1 - A sin(omega t - phase))，夾在正的最小值以上
+  for (int j = 0; j < n - 1; ++j) {
+    glm::dvec3 d = xs[j] - xs[j + 1];
+    double length = smoothLength(d);
+    glm::dvec3 u = d / length;
+    double restLength = restLengthOf(segmentLength, c.amplitude, c.omega * t - phase[j], nullptr);
+    double magnitude = -c.springK * (length - restLength) - c.damping * glm::dot(vs[j] - vs[j + 1], u);
+    f[j] += magnitude * u;
+    f[j + 1] -= magnitude * u;
+  }
+
+  const double contactBeta = 1.0 / CONTACT_SMOOTHING;
+  const double slideBeta = 1.0 / BACKSLIDE_SMOOTHING;
+  for (int i = 0; i < n; ++i) {
+    // 地面：穿透深度的 softplus 當彈簧，接觸時才有阻尼
+    double depth = groundHeight - xs[i].y;
+    double contact = sigmoid(contactBeta * depth);
+    f[i].y += mass[i] * (CONTACT_STIFFNESS * softplus(depth, contactBeta) - CONTACT_DAMPING * contact * vs[i].y);
+
+    // 蛇鱗：沿身體切線往後滑時往前推
+    int p = i == 0 ? 0 : i - 1;
+    int q = i == n - 1 ? n - 1 : i + 1;
+    glm::dvec3 e = horizontal(xs[p] - xs[q]);
+    glm::dvec3 tangent = e / smoothLength(e);
+    f[i] += mass[i] * BACKSLIDE_RATE * softplus(-glm::dot(vs[i], tangent), slideBeta) * tangent;
+
+    // 等向庫侖摩擦
+    glm::dvec3 w = horizontal(vs[i]);
+    double r = std::sqrt(glm::dot(w, w) + FRICTION_SLIP_EPS * FRICTION_SLIP_EPS);
+    f[i] -= c.friction * mass[i] * GRAVITY * w / r;
+  }
+}
+
+void DiffSnake::step(glm::dvec3* xs, glm::dvec3* vs, int stepIndex) {
+  computeForces(xs, vs, stepIndex * h, force.data());
+  for (int i = 0; i < n; ++i) {
+    vs[i] += force[i] * (h / mass[i]);
+    xs[i] += vs[i] * h;
+  }
+}
+
+double DiffSnake::measure(const glm::dvec3* xs) const {
+  double sum = 0.0;
+  for (int i = 0; i < n; ++i) sum += mass[i] * glm::dot(xs[i], forward);
+  return sum / totalMass;
+}
+
+DiffSnake::Result DiffSnake::rollout(const GaitParams& params) {
+  auto start = std::chrono::steady_clock::now();
+  setParams(params);
+  resetState(x.data(), v.data());
+  double startPos = measure(x.data());
+  for (int k = 0; k < numSteps; ++k) step(x.data(), v.data(), k);
+
+  Result result;
+  result.distance = measure(x.data()) - startPos;
+  result.steps = numSteps;
+  result.forwardMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  return result;
+}
+
+// ========== 反向 ==========
+
+void DiffSnake::forcesVjp(const glm::dvec3* xs, const glm::dvec3* vs, double t, const glm::dvec3* lam,
+                          glm::dvec3* xb, glm::dvec3* vb, double* paramBar) const {
+  for (int j = 0; j < n - 1; ++j) {
+    glm::dvec3 d = xs[j] - xs[j + 1];
+    double length = smoothLength(d);
+    glm::dvec3 u = d / length;
+    double angle = c.omega * t - phase[j];
+    double restSlope = 0.0;
+    double restLength = restLengthOf(segmentLength, c.amplitude, angle, &restSlope);
+    glm::dvec3 rel = vs[j] - vs[j + 1];
+    double s = glm::dot(rel, u);
+    double magnitude = -c.springK * (length - restLength) - c.damping * s;
+
+    // 兩端的力是 +-magnitude * u
+    glm::dvec3 l = lam[j] - lam[j + 1];
+    double magnitudeBar = glm::dot(l, u);
+    glm::dvec3 uBar = magnitude * l;
+
+    paramBar[SPRING_K] -= (length - restLength) * magnitudeBar;
+    paramBar[DAMPING] -= s * magnitudeBar;
+    double lengthBar = -c.springK * magnitudeBar;
+    double restBar = c.springK * magnitudeBar * restSlope;  // 對夾住前的靜止長度
+    double sBar = -c.damping * magnitudeBar;
+
+    paramBar[WAVE_AMPLITUDE] -= segmentLength * std::sin(angle) * restBar;
+    double omegaBar = -segmentLength * c.amplitude * std::cos(angle) * t * restBar;
+    paramBar[WAVE_FREQUENCY] += TWO_PI * omegaBar;
+
+    uBar += sBar * rel;
+    vb[j] += sBar * u;
+    vb[j + 1] -= sBar * u;
+
+    // u = d / sqrt(|d|^2 + eps^2)：du = (dd - u (u . dd)) / length，d length = u . dd
+    glm::dvec3 dBar = (uBar - glm::dot(uBar, u) * u) / length + lengthBar * u;
+    xb[j] += dBar;
+    xb[j + 1] -= dBar;
+  }
+
+  const double contactBeta = 1.0 / CONTACT_SMOOTHING;
+  const double slideBeta = 1.0 / BACKSLIDE_SMOOTHING;
+  for (int i = 0; i < n; ++i) {
+    double m = mass[i];
+
+    // 地面
+    double depth = groundHeight - xs[i].y;
+    double contact = sigmoid(contactBeta * depth);
+    double penetrationBar = m * CONTACT_STIFFNESS * lam[i].y;
+    double contactBar = -m * CONTACT_DAMPING * vs[i].y * lam[i].y;
+    vb[i].y -= m * CONTACT_DAMPING * contact * lam[i].y;
+    double depthBar = penetrationBar * contact + contactBar * contactBeta * contact * (1.0 - contact);
+    xb[i].y -= depthBar;
+
+    // 蛇鱗
+    int p = i == 0 ? 0 : i - 1;
+    int q = i == n - 1 ? n - 1 : i + 1;
+    glm::dvec3 e = horizontal(xs[p] - xs[q]);
+    double eLength = smoothLength(e);
+    glm::dvec3 tangent = e / eLength;
+    double z = glm::dot(vs[i], tangent);
+    double push = softplus(-z, slideBeta);
+    double pushBar = m * BACKSLIDE_RATE * glm::dot(lam[i], tangent);
+    glm::dvec3 tangentBar = m * BACKSLIDE_RATE * push * lam[i];
+    double zBar = -pushBar * sigmoid(-slideBeta * z);
+    vb[i] += zBar * tangent;
+    tangentBar += zBar * vs[i];
+    glm::dvec3 eBar = horizontal((tangentBar - glm::dot(tangentBar, tangent) * tangent) / eLength);
+    xb[p] += eBar;
+    xb[q] -= eBar;
+
+    // 等向庫侖摩擦
+    glm::dvec3 w = horizontal(vs[i]);
+    double r = std::sqrt(glm::dot(w, w) + FRICTION_SLIP_EPS * FRICTION_SLIP_EPS);
+    glm::dvec3 lh = horizontal(lam[i]);
+    double lw = glm::dot(lh, w);
+    paramBar[GROUND_FRICTION] -= m * GRAVITY * lw / r;
+    vb[i] -= c.friction * m * GRAVITY * (lh / r - lw * w / (r * r * r));
+  }
+}
+
+DiffSnake::Result DiffSnake::gradient(const GaitParams& params) {
+  Result result;
+  result.steps = numSteps;
+  result.checkpoints = (numSteps + interval - 1) / interval;
+  result.stateBytes =
+      (checkpointX.size() + checkpointV.size() + segmentX.size() + segmentV.size()) * sizeof(glm::dvec3);
+
+  // 1. 前向，每 interval 步存一次
+  auto start = std::chrono::steady_clock::now();
+  setParams(params);
+  resetState(x.data(), v.data());
+  double startPos = measure(x.data());
+  for (int k = 0; k < numSteps; ++k) {
+    if (k % interval == 0) {
+      std::copy(x.begin(), x.end(), checkpointX.begin() + (size_t)(k / interval) * n);
+      std::copy(v.begin(), v.end(), checkpointV.begin() + (size_t)(k / interval) * n);
+    }
+    step(x.data(), v.data(), k);
+  }
+  result.distance = measure(x.data()) - startPos;
+  auto mid = std::chrono::steady_clock::now();
+  if (!std::isfinite(result.distance)) {
+    std::cout << "[ERROR] DiffSnake: the rollout diverged; the spring is too stiff for the " << h << " s step"
+              << std::endl;
+    result.valid = false;
+    result.forwardMs = std::chrono::duration<double, std::milli>(mid - start).count();
+    return result;
+  }
+
+  // 2. 反向：d distance / d x_T = m_i / M * forward
+  double paramBar[NUM_PARAMS] = {};
+  for (int i = 0; i < n; ++i) {
+    xBar[i] = forward * (mass[i] / totalMass);
+    vBar[i] = glm::dvec3(0.0);
+  }
+  for (int segment = result.checkpoints - 1; segment >= 0; --segment) {
+    int first = segment * interval;
+    int last = std::min(numSteps, first + interval);
+
+    // 從檢查點重算這一段每一步開始時的狀態
+    std::copy_n(checkpointX.begin() + (size_t)segment * n, n, segmentX.begin());
+    std::copy_n(checkpointV.begin() + (size_t)segment * n, n, segmentV.begin());
+    for (int k = first; k < last - 1; ++k) {
+      glm::dvec3* xs = &segmentX[(size_t)(k - first) * n];
+      glm::dvec3* vs = &segmentV[(size_t)(k - first) * n];
+      std::copy_n(xs, n, xs + n);
+      std::copy_n(vs, n, vs + n);
+      step(xs + n, vs + n, k);
+    }
+
+    // v' = v + h F / m，x' = x + h v'
+    for (int k = last - 1; k >= first; --k) {
+      const glm::dvec3* xs = &segmentX[(size_t)(k - first) * n];
+      const glm::dvec3* vs = &segmentV[(size_t)(k - first) * n];
+      for (int i = 0; i < n; ++i) {
+        vBar[i] += h * xBar[i];
+        lambda[i] = vBar[i] * (h / mass[i]);
+      }
+      forcesVjp(xs, vs, k * h, lambda.data(), xBar.data(), vBar.data(), paramBar);
+    }
+
+    // 伴隨變數往回傳時指數成長表示軌跡對初值混沌，這樣的梯度沒有意義，不要交給最佳化
+    bool exploded = false;
+    for (int i = 0; i < n && !exploded; ++i) {
+      exploded = !isFinite(xBar[i]) || !isFinite(vBar[i]) || glm::length(xBar[i]) > MAX_ADJOINT ||
+                 glm::length(vBar[i]) > MAX_ADJOINT;
+    }
+    if (exploded) {
+      std::cout << "[ERROR] DiffSnake: the gradient exploded going back to t = " << first * h
+                << " s; the trajectory is chaotic in the parameters, try a shorter simSeconds" << std::endl;
+      result.valid = false;
+      break;
+    }
+  }
+  if (result.valid) std::copy(paramBar, paramBar + NUM_PARAMS, result.gradient.begin());
+
+  auto end = std::chrono::steady_clock::now();
+  result.forwardMs = std::chrono::duration<double, std::milli>(mid - start).count();
+  result.backwardMs = std::chrono::duration<double, std::milli>(end - mid).count();
+  return result;
+}
+
+}  // namespace gait
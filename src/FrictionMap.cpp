@@ -0,0 +1,134 @@
+#include "FrictionMap.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+FrictionMap::FrictionMap(int width, int depth, float cellSize, const glm::vec2& origin, const Coeffs& fill)
+    : width(std::max(1, width)),
+      depth(std::max(1, depth)),
+      cellSize(cellSize),
+      invCellSize(1.0f / cellSize),
+      origin(origin),
+      forward(this->width * this->depth, fill.forward),
+      backward(this->width * this->depth, fill.backward),
+      lateral(this->width * this->depth, fill.lateral) {}
+
+FrictionMap* FrictionMap::fromFile(const char* filename) {
+  std::ifstream file(filename);
+  if (!file.is_open()) {
+    std::cout << "[ERROR] Can't open friction map: " << filename << std::endl;
+    return NULL;
+  }
+
+  FrictionMap* map = NULL;
+  std::string line;
+  int lineNumber = 0;
+  while (std::getline(file, line)) {
+    ++lineNumber;
+    std::istringstream iss(line);
+    std::string prefix;
+    if (!(iss >> prefix) || prefix[0] == '#') continue;
+
+    bool ok = true;
+    if (prefix == "size") {
+      int w, d;
+      float cell;
+      glm::vec2 o;
+      ok = static_cast<bool>(iss >> w >> d >> cell >> o.x >> o.y) && w > 0 && d > 0 && cell > 0.0f && !map;
+      if (ok) map = new FrictionMap(w, d, cell, o, {0.2f, 0.2f, 0.2f});
+    } else if (!map) {
+      ok = false;
+    } else if (prefix == "fill") {
+      Coeffs c;
+      ok = static_cast<bool>(iss >> c.forward >> c.backward >> c.lateral);
+      if (ok) map->fillRect(map->origin, map->origin + glm::vec2(map->width, map->depth) * map->cellSize, c);
+    } else if (prefix == "rect") {
+      glm::vec2 lo, hi;
+      Coeffs c;
+      ok = static_cast<bool>(iss >> lo.x >> lo.y >> hi.x >> hi.y >> c.forward >> c.backward >> c.lateral);
+      if (ok) map->fillRect(lo, hi, c);
+    } else if (prefix == "cell") {
+      int i, j;
+      Coeffs c;
+      ok = static_cast<bool>(iss >> i >> j >> c.forward >> c.backward >> c.lateral);
+      if (ok) map->setCell(i, j, c);
+    } else {
+      ok = false;
+    }
+
+    if (!ok) {
+      std::cout << "[ERROR] " << filename << ":" << lineNumber << " bad friction map line: " << line << std::endl;
+      delete map;
+      return NULL;
+    }
+  }
+
+  if (!map) std::cout << "[ERROR] Friction map has no size line: " << filename << std::endl;
+  return map;
+}
+
+void FrictionMap::setCell(int i, int j, const Coeffs& c) {
+  if (i < 0 || i >= width || j < 0 || j >= depth) return;
+  int idx = j * width + i;
+  forward[idx] = c.forward;
+  backward[idx] = c.backward;
+  lateral[idx] = c.lateral;
+}
+
+void FrictionMap::fillRect(const glm::vec2& min, const glm::vec2& max, const Coeffs& c) {
+  // 以格子中心判斷是否落在矩形內
+  for (int j = 0; j < depth; ++j) {
+    float z = origin.y + (j + 0.5f) * cellSize;
+    if (z < min.y || z > max.y) continue;
+    for (int i = 0; i < width; ++i) {
+      float x = origin.x + (i + 0.5f) * cellSize;
+      if (x < min.x || x > max.x) continue;
+      setCell(i, j, c);
+    }
+  }
+}
+
+FrictionMap::Coeffs FrictionMap::sample(float x, float z) const {
+  Coeffs c;
+  sampleBatch(&x, &z, 1, &c.forward, &c.backward, &c.lateral);
+  return c;
+}
+
+void FrictionMap::sampleBatch(const float* xs, const float* zs, int count, float* forwardOut, float* backwardOut,
+                              float* lateralOut) const {
+  const float maxU = (float)(width - 1);
+  const float maxV = (float)(depth - 1);
+  const float* f = forward.data();
+  const float* b = backward.data();
+  const float* l = lateral.data();
+
+  for (int n = 0; n < count; ++n) {
+    // 換成以格子中心為基準的連續座標，超出邊界就夾到最外圈
+    float u = std::clamp((xs[n] - origin.x) * invCellSize - 0.5f, 0.0f, maxU);
+    float v = std::clamp((zs[n] - origin.y) * invCellSize - 0.5f, 0.0f, maxV);
+    float u0f = std::floor(u);
+    float v0f = std::floor(v);
+    int i0 = (int)u0f;
+    int j0 = (int)v0f;
+    int i1 = std::min(i0 + 1, width - 1);
+    int j1 = std::min(j0 + 1, depth - 1);
+    float tu = u - u0f;
+    float tv = v - v0f;
+
+    float w00 = (1.0f - tu) * (1.0f - tv);
+    float w10 = tu * (1.0f - tv);
+    float w01 = (1.0f - tu) * tv;
+    float w11 = tu * tv;
+    int a = j0 * width + i0;
+    int bIdx = j0 * width + i1;
+    int c = j1 * width + i0;
+    int d = j1 * width + i1;
+
+    forwardOut[n] = w00 * f[a] + w10 * f[bIdx] + w01 * f[c] + w11 * f[d];
+    backwardOut[n] = w00 * b[a] + w10 * b[bIdx] + w01 * b[c] + w11 * b[d];
+    lateralOut[n] = w00 * l[a] + w10 * l[bIdx] + w01 * l[c] + w11 * l[d];
+  }
+}
@@ -0,0 +1,246 @@
+#include "GaitOptimizer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+
+namespace gait {
+
+namespace {
+
+const double FAILED_FITNESS = -1e9;  // 不穩定或沒有前進的個體
+
+// 對稱矩陣的 Jacobi 特徵分解：a 會被破壞，vectors 的第 j 行是第 j 個特徵向量
+void jacobiEigen(int n, double* a, double* vectors, double* values) {
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < n; ++j) vectors[i * n + j] = i == j ? 1.0 : 0.0;
+  }
+  for (int sweep = 0; sweep < 50; ++sweep) {
+    double off = 0.0;
+    for (int i = 0; i < n; ++i) {
+      for (int j = i + 1; j < n; ++j) off += a[i * n + j] * a[i * n + j];
+    }
+    if (off < 1e-30) break;
+
+    for (int p = 0; p < n; ++p) {
+      for (int q = p + 1; q < n; ++q) {
+        double apq = a[p * n + q];
+        if (std::abs(apq) < 1e-300) continue;
+        double theta = (a[q * n + q] - a[p * n + p]) / (2.0 * apq);
+        double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+        double c = 1.0 / std::sqrt(t * t + 1.0);
+        double s = t * c;
+        for (int k = 0; k < n; ++k) {
+          double akp = a[k * n + p], akq = a[k * n + q];
+          a[k * n + p] = c * akp - s * akq;
+          a[k * n + q] = s * akp + c * akq;
+        }
+        for (int k = 0; k < n; ++k) {
+          double apk = a[p * n + k], aqk = a[q * n + k];
+          a[p * n + k] = c * apk - s * aqk;
+          a[q * n + k] = s * apk + c * aqk;
+        }
+        for (int k = 0; k < n; ++k) {
+          double vkp = vectors[k * n + p], vkq = vectors[k * n + q];
+          vectors[k * n + p] = c * vkp - s * vkq;
+          vectors[k * n + q] = s * vkp + c * vkq;
+        }
+      }
+    }
+  }
+  for (int i = 0; i < n; ++i) values[i] = a[i * n + i];
+}
+
+}  // namespace
+
+GaitOptimizer::GaitOptimizer(const GaitParams& base, const Settings& settings, const EvalSettings& evalSettings,
+                             JobSystem& jobs)
+    : base(base), settings(settings), evalSettings(evalSettings), jobs(jobs), rng(settings.seed) {
+  GaitParams probe;
+  for (const auto& range : settings.bounds) {
+    if (range.name == "numSegments" || !probe.set(range.name, 0.0f)) {
+      std::cout << "[ERROR] Cannot optimize gait parameter: " << range.name << std::endl;
+      valid = false;
+    } else if (!(range.max > range.min)) {
+      std::cout << "[ERROR] Empty range for " << range.name << std::endl;
+      valid = false;
+    }
+  }
+  n = (int)settings.bounds.size();
+  if (n == 0) {
+    std::cout << "[ERROR] No parameters to optimize" << std::endl;
+    valid = false;
+  }
+  if (!valid) return;
+
+  // ===== 策略參數（Hansen, The CMA Evolution Strategy: A Tutorial）=====
+  lambda = settings.populationSize > 0 ? settings.populationSize : 4 + (int)std::floor(3.0 * std::log((double)n));
+  lambda = std::max(lambda, 2);
+  mu = lambda / 2;
+  weights.resize(mu);
+  for (int i = 0; i < mu; ++i) weights[i] = std::log(mu + 0.5) - std::log(i + 1.0);
+  double sum = std::accumulate(weights.begin(), weights.end(), 0.0);
+  double sumSq = 0.0;
+  for (double& w : weights) {
+    w /= sum;
+    sumSq += w * w;
+  }
+  mueff = 1.0 / sumSq;
+  cc = (4.0 + mueff / n) / (n + 4.0 + 2.0 * mueff / n);
+  cs = (mueff + 2.0) / (n + mueff + 5.0);
+  c1 = 2.0 / ((n + 1.3) * (n + 1.3) + mueff);
+  cmu = std::min(1.0 - c1, 2.0 * (mueff - 2.0 + 1.0 / mueff) / ((n + 2.0) * (n + 2.0) + mueff));
+  damps = 1.0 + 2.0 * std::max(0.0, std::sqrt((mueff - 1.0) / (n + 1.0)) - 1.0) + cs;
+  chiN = std::sqrt((double)n) * (1.0 - 1.0 / (4.0 * n) + 1.0 / (21.0 * n * n));
+
+  // ===== 初始分布：從 base 開始 =====
+  mean.resize(n);
+  for (int i = 0; i < n; ++i) {
+    const RandomRange& range = settings.bounds[i];
+    mean[i] = std::clamp((double)(base.get(range.name) - range.min) / (range.max - range.min), 0.0, 1.0);
+  }
+  ps.assign(n, 0.0);
+  pc.assign(n, 0.0);
+  C.assign(n * n, 0.0);
+  B.assign(n * n, 0.0);
+  D.assign(n, 1.0);
+  for (int i = 0; i < n; ++i) C[i * n + i] = B[i * n + i] = 1.0;
+  sigma = settings.initialSigma;
+
+  // ===== 每代重複使用的暫存 =====
+  z.resize(lambda * n);
+  y.resize(lambda * n);
+  x.resize(lambda * n);
+  oldMean.resize(n);
+  yw.resize(n);
+  scratch.resize(n * n);
+  order.resize(lambda);
+  candidates.resize(lambda, base);
+  metrics.resize(lambda);
+  fitnesses.resize(lambda);
+  for (int k = 0; k < lambda; ++k) snakes.push_back(createSnake(base, evalSettings));
+  bestEver = base;
+}
+
+double GaitOptimizer::fitness(const GaitMetrics& m) const {
+  if (!m.stable) return FAILED_FITNESS;
+  if (settings.objective == Objective::DISTANCE) return (double)m.forwardSpeed * m.simSeconds;
+  return m.costOfTransport > 0.0 ? -m.costOfTransport : FAILED_FITNESS;
+}
+
+GaitParams GaitOptimizer::toParams(const double* point) const {
+  GaitParams params = base;
+  for (int i = 0; i < n; ++i) {
+    const RandomRange& range = settings.bounds[i];
+    params.set(range.name, range.min + (float)std::clamp(point[i], 0.0, 1.0) * (range.max - range.min));
+  }
+  return params;
+}
+
+const GaitOptimizer::Generation& GaitOptimizer::step() {
+  auto start = std::chrono::steady_clock::now();
+
+  // 1. 取樣 x = mean + sigma * B * D * z，超出範圍的在評估時夾回邊界
+  std::normal_distribution<double> normal(0.0, 1.0);
+  for (int k = 0; k < lambda; ++k) {
+    double* zk = &z[k * n];
+    double* yk = &y[k * n];
+    double* xk = &x[k * n];
+    for (int i = 0; i < n; ++i) zk[i] = normal(rng);
+    for (int i = 0; i < n; ++i) {
+      double v = 0.0;
+      for (int j = 0; j < n; ++j) v += B[i * n + j] * D[j] * zk[j];
+      yk[i] = v;
+      xk[i] = mean[i] + sigma * v;
+    }
+    candidates[k] = toParams(xk);
+  }
+
+  // 2. 整代平行模擬，每個個體用自己的那條蛇
+  jobs.parallelFor(lambda, 1, [this](int begin, int end) {
+    for (int k = begin; k < end; ++k) metrics[k] = evaluate(*snakes[k], candidates[k], evalSettings);
+  });
+
+  // 3. 排名
+  for (int k = 0; k < lambda; ++k) fitnesses[k] = fitness(metrics[k]);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [this](int a, int b) { return fitnesses[a] > fitnesses[b]; });
+
+  // 4. 平均往前 mu 名的加權平均移動
+  oldMean = mean;
+  for (int i = 0; i < n; ++i) {
+    double v = 0.0;
+    for (int r = 0; r < mu; ++r) v += weights[r] * x[order[r] * n + i];
+    mean[i] = v;
+    yw[i] = (mean[i] - oldMean[i]) / sigma;
+  }
+
+  // 5. 演化路徑：ps 用 C^{-1/2} yw = B D^{-1} B^T yw
+  for (int j = 0; j < n; ++j) {
+    double v = 0.0;
+    for (int i = 0; i < n; ++i) v += B[i * n + j] * yw[i];
+    scratch[j] = v / D[j];
+  }
+  double psNorm = 0.0;
+  for (int i = 0; i < n; ++i) {
+    double v = 0.0;
+    for (int j = 0; j < n; ++j) v += B[i * n + j] * scratch[j];
+    ps[i] = (1.0 - cs) * ps[i] + std::sqrt(cs * (2.0 - cs) * mueff) * v;
+    psNorm += ps[i] * ps[i];
+  }
+  psNorm = std::sqrt(psNorm);
+  double hsigThreshold = (1.4 + 2.0 / (n + 1.0)) * chiN;
+  bool hsig = psNorm / std::sqrt(1.0 - std::pow(1.0 - cs, 2.0 * (generation + 1))) < hsigThreshold;
+  for (int i = 0; i < n; ++i) {
+    pc[i] = (1.0 - cc) * pc[i] + (hsig ? std::sqrt(cc * (2.0 - cc) * mueff) : 0.0) * yw[i];
+  }
+
+  // 6. 共變異矩陣：rank-one 加 rank-mu
+  double oldWeight = 1.0 - c1 - cmu + (hsig ? 0.0 : c1 * cc * (2.0 - cc));
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j <= i; ++j) {
+      double rankMu = 0.0;
+      for (int r = 0; r < mu; ++r) rankMu += weights[r] * y[order[r] * n + i] * y[order[r] * n + j];
+      double v = oldWeight * C[i * n + j] + c1 * pc[i] * pc[j] + cmu * rankMu;
+      C[i * n + j] = C[j * n + i] = v;
+    }
+  }
+
+  // 7. 步長
+  sigma *= std::exp((cs / damps) * (psNorm / chiN - 1.0));
+  sigma = std::clamp(sigma, 1e-8, 1.0);
+  updateEigen();
+
+  // 8. 紀錄
+  last.index = generation++;
+  last.bestFitness = fitnesses[order[0]];
+  last.meanFitness = 0.0;
+  last.unstable = 0;
+  int counted = 0;
+  for (int k = 0; k < lambda; ++k) {
+    if (!metrics[k].stable) ++last.unstable;
+    if (fitnesses[k] > FAILED_FITNESS) {
+      last.meanFitness += fitnesses[k];
+      ++counted;
+    }
+  }
+  last.meanFitness = counted > 0 ? last.meanFitness / counted : FAILED_FITNESS;
+  last.sigma = sigma;
+  last.best = candidates[order[0]];
+  last.bestMetrics = metrics[order[0]];
+  if (last.bestFitness > bestEverFitness) {
+    bestEverFitness = last.bestFitness;
+    bestEver = last.best;
+  }
+  last.wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  return last;
+}
+
+void GaitOptimizer::updateEigen() {
+  scratch = C;
+  jacobiEigen(n, scratch.data(), B.data(), D.data());
+  for (int i = 0; i < n; ++i) D[i] = std::sqrt(std::max(D[i], 1e-20));
+}
+
+}  // namespace gait
@@ -0,0 +1,290 @@
+#include "GaitSweep.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <random>
+
+namespace gait {
+
+namespace {
+
+const char* const METRIC_COLUMNS = "forwardSpeed,actuationWork,costOfTransport,maxStretch,stable,simSeconds";
+const float SETTLE_SECONDS = 1.0f;   // 先不動讓蛇落地，這段不算
+const float MAX_STRETCH = 3.0f;      // 彈簧長度超過節長這麼多倍算拉爆
+const float MIN_HEIGHT = -1.0f;      // 離開這個高度範圍算飛出去
+const float MAX_HEIGHT = 3.0f;
+const float MIN_DISTANCE = 0.01f;    // 前進不到這個距離時不算 cost of transport
+
+void stepSnake(Snake& snake, float dt) {
+  int substeps = std::clamp((int)std::ceil(dt / snake.getMaxSubDt()), 1, 30);
+  for (int s = 0; s < substeps; ++s) snake.update(dt / substeps);
+}
+
+glm::vec3 getCenterOfMass(const Snake& snake) {
+  glm::vec3 sum(0.0f);
+  float total = 0.0f;
+  for (const Mass* mass : snake.getMasses()) {
+    sum += mass->getPosition() * mass->getMass();
+    total += mass->getMass();
+  }
+  return total > 0.0f ? sum / total : sum;
+}
+
+// 回傳最大的 彈簧長度 / 節長，有 NaN 或飛出去時回傳 -1
+float checkState(const Snake& snake, float segmentLength) {
+  const auto& masses = snake.getMasses();
+  float maxStretch = 0.0f;
+  for (size_t i = 0; i < masses.size(); ++i) {
+    glm::vec3 p = masses[i]->getPosition();
+    if (!std::isfinite(p.x) || !std::isfinite(p.y) || !std::isfinite(p.z)) return -1.0f;
+    if (p.y < MIN_HEIGHT || p.y > MAX_HEIGHT) return -1.0f;
+    if (i > 0) maxStretch = std::max(maxStretch, glm::length(p - masses[i - 1]->getPosition()) / segmentLength);
+  }
+  return maxStretch;
+}
+
+}  // namespace
+
+// ========== 參數 ==========
+
+bool GaitParams::set(const std::string& name, float value) {
+  if (name == "numSegments") {
+    numSegments = std::max(3, (int)std::lround(value));
+  } else if (name == "springK") {
+    springK = value;
+  } else if (name == "damping") {
+    damping = value;
+  } else if (name == "waveAmplitude") {
+    waveAmplitude = value;
+  } else if (name == "waveFrequency") {
+    waveFrequency = value;
+  } else if (name == "groundFriction") {
+    groundFriction = value;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+float GaitParams::get(const std::string& name) const {
+  if (name == "numSegments") return (float)numSegments;
+  if (name == "springK") return springK;
+  if (name == "damping") return damping;
+  if (name == "waveAmplitude") return waveAmplitude;
+  if (name == "waveFrequency") return waveFrequency;
+  if (name == "groundFriction") return groundFriction;
+  return 0.0f;
+}
+
+const std::vector<std::string>& GaitParams::getNames() {
+  static const std::vector<std::string> names = {"numSegments",   "springK",       "damping",
+                                                 "waveAmplitude", "waveFrequency", "groundFriction"};
+  return names;
+}
+
+std::vector<GaitParams> makeGrid(const GaitParams& base, const std::vector<GridAxis>& axes) {
+  GaitParams probe;
+  for (const auto& axis : axes) {
+    if (!probe.set(axis.name, 0.0f)) {
+      std::cout << "[ERROR] Unknown gait parameter: " << axis.name << std::endl;
+      return {};
+    }
+    if (axis.values.empty()) return {};
+  }
+
+  std::vector<GaitParams> points = {base};
+  for (const auto& axis : axes) {
+    std::vector<GaitParams> expanded;
+    expanded.reserve(points.size() * axis.values.size());
+    for (const auto& point : points) {
+      for (float value : axis.values) {
+        expanded.push_back(point);
+        expanded.back().set(axis.name, value);
+      }
+    }
+    points.swap(expanded);
+  }
+  return points;
+}
+
+std::vector<GaitParams> makeRandom(const GaitParams& base, const std::vector<RandomRange>& ranges, int count,
+                                   unsigned int seed) {
+  GaitParams probe;
+  for (const auto& range : ranges) {
+    if (!probe.set(range.name, 0.0f)) {
+      std::cout << "[ERROR] Unknown gait parameter: " << range.name << std::endl;
+      return {};
+    }
+  }
+
+  std::mt19937 rng(seed);
+  std::vector<GaitParams> points(std::max(0, count), base);
+  for (auto& point : points) {
+    for (const auto& range : ranges) {
+      point.set(range.name, std::uniform_real_distribution<float>(range.min, range.max)(rng));
+    }
+  }
+  return points;
+}
+
+// ========== 評估 ==========
+
+std::unique_ptr<Snake> createSnake(const GaitParams& params, const EvalSettings& settings) {
+  glm::vec3 startPos(0.0f, 0.5f, 0.0f);
+  if (const FrictionMap* map = settings.frictionMap) {
+    glm::vec2 center = map->getOrigin() + 0.5f * map->getCellSize() * glm::vec2(map->getWidth(), map->getDepth());
+    startPos = glm::vec3(center.x, 0.5f, center.y);
+  }
+  return std::make_unique<Snake>(params.numSegments, settings.segmentMass, settings.segmentLength, params.springK,
+                                 params.damping, startPos, settings.radius);
+}
+
+GaitMetrics evaluate(const GaitParams& params, const EvalSettings& settings) {
+  return evaluate(*createSnake(params, settings), params, settings);
+}
+
+GaitMetrics evaluate(Snake& snake, const GaitParams& params, const EvalSettings& settings) {
+  snake.reset();
+  snake.setSpringConstants(params.springK, params.damping);
+  snake.setObserved(true);
+  snake.setMovementMode(Snake::MovementMode::RECTILINEAR);
+  snake.setSpringIntegrator(settings.integrator);
+  snake.setWaveAmplitude(params.waveAmplitude);
+  snake.setWaveFrequency(params.waveFrequency);
+  snake.setGroundFriction(params.groundFriction);
+  snake.setFrictionMap(settings.frictionMap);
+
+  GaitMetrics metrics;
+  for (float t = 0.0f; t < SETTLE_SECONDS; t += settings.dt) stepSnake(snake, settings.dt);
+
+  glm::vec3 forward = snake.getForwardDirection();
+  forward.y = 0.0f;
+  forward = glm::length(forward) > 0.001f ? glm::normalize(forward) : glm::vec3(1.0f, 0.0f, 0.0f);
+  glm::vec3 start = getCenterOfMass(snake);
+  snake.resetActuationWork();
+  snake.setSnakeMoveDirection(0, true);
+
+  int steps = (int)std::ceil(settings.simSeconds / settings.dt);
+  for (int i = 0; i < steps; ++i) {
+    stepSnake(snake, settings.dt);
+    metrics.simSeconds += settings.dt;
+    float stretch = checkState(snake, settings.segmentLength);
+    if (stretch < 0.0f || stretch > MAX_STRETCH) {
+      metrics.stable = false;
+      if (stretch > 0.0f) metrics.maxStretch = stretch;
+      break;
+    }
+    metrics.maxStretch = std::max(metrics.maxStretch, stretch);
+  }
+
+  metrics.actuationWork = snake.getActuationWork();
+  if (metrics.stable) {
+    float distance = glm::dot(getCenterOfMass(snake) - start, forward);
+    float totalMass = settings.segmentMass * snake.getNumSegments();
+    metrics.forwardSpeed = distance / metrics.simSeconds;
+    if (distance > MIN_DISTANCE) metrics.costOfTransport = metrics.actuationWork / (totalMass * 9.8 * distance);
+  }
+  return metrics;
+}
+
+// ========== 結果表 ==========
+
+std::string ResultTable::makeKey(const GaitParams& params) {
+  char buffer[256];
+  std::snprintf(buffer, sizeof(buffer), "%d,%.6g,%.6g,%.6g,%.6g,%.6g", params.numSegments, params.springK,
+                params.damping, params.waveAmplitude, params.waveFrequency, params.groundFriction);
+  return buffer;
+}
+
+bool ResultTable::open(const std::string& path) {
+  std::string header;
+  for (const auto& name : GaitParams::getNames()) header += name + ",";
+  header += METRIC_COLUMNS;
+
+  done.clear();
+  bool exists = false;
+  bool endsWithNewline = true;
+  {
+    std::ifstream in(path, std::ios::binary);
+    std::string line;
+    if (in && std::getline(in, line)) {
+      exists = true;
+      if (!line.empty() && line.back() == '\r') line.pop_back();
+      if (line != header) {
+        std::cout << "[ERROR] " << path << " has different columns, refusing to append" << std::endl;
+        return false;
+      }
+      // 參數欄位就是 key；最後一行可能只寫了一半，沒有換行或欄位不完整就不算
+      size_t columns = GaitParams::getNames().size() + 6;
+      while (std::getline(in, line)) {
+        if (in.eof()) break;
+        if ((size_t)std::count(line.begin(), line.end(), ',') + 1 != columns) continue;
+        size_t end = 0;
+        for (size_t k = 0; k < GaitParams::getNames().size(); ++k) end = line.find(',', end) + 1;
+        done.insert(line.substr(0, end - 1));
+      }
+      in.clear();
+      in.seekg(-1, std::ios::end);
+      endsWithNewline = in.get() == '\n';
+    }
+  }
+
+  file.open(path, std::ios::app);
+  if (!file) {
+    std::cout << "[ERROR] Cannot open " << path << " for writing" << std::endl;
+    return false;
+  }
+  if (!exists) file << header << "\n" << std::flush;
+  if (!endsWithNewline) file << "\n";  // 上次中斷在一行的中間
+  return true;
+}
+
+bool ResultTable::isDone(const GaitParams& params) const { return done.count(makeKey(params)) > 0; }
+
+void ResultTable::append(const GaitParams& params, const GaitMetrics& metrics) {
+  char buffer[256];
+  std::snprintf(buffer, sizeof(buffer), "%s,%.6g,%.6g,%.6g,%.6g,%d,%.6g", makeKey(params).c_str(),
+                metrics.forwardSpeed, metrics.actuationWork, metrics.costOfTransport, metrics.maxStretch,
+                metrics.stable ? 1 : 0, metrics.simSeconds);
+  std::lock_guard<std::mutex> lock(mutex);
+  file << buffer << "\n" << std::flush;
+  done.insert(makeKey(params));
+}
+
+// ========== 掃描 ==========
+
+SweepStats run(const std::vector<GaitParams>& points, const EvalSettings& settings, ResultTable& table,
+               JobSystem& jobs) {
+  SweepStats stats;
+  stats.total = (int)points.size();
+
+  std::vector<const GaitParams*> pending;
+  for (const auto& point : points) {
+    if (table.isDone(point)) {
+      ++stats.skipped;
+    } else {
+      pending.push_back(&point);
+    }
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  std::atomic<int> unstable{0};
+  jobs.parallelFor((int)pending.size(), 1, [&](int begin, int end) {
+    for (int i = begin; i < end; ++i) {
+      GaitMetrics metrics = evaluate(*pending[i], settings);
+      if (!metrics.stable) unstable.fetch_add(1, std::memory_order_relaxed);
+      table.append(*pending[i], metrics);
+    }
+  });
+
+  stats.evaluated = (int)pending.size();
+  stats.unstable = unstable.load();
+  stats.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return stats;
+}
+
+}  // namespace gait
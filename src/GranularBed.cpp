@@ -0,0 +1,241 @@
+#include "GranularBed.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+#include "Snake.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846f
+#endif
+
+GranularBed::GranularBed(const Params& params, const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+    : params(params),
+      boundsMin(boundsMin),
+      boundsMax(boundsMax),
+      cells(boundsMin, boundsMax, 2.0f * params.particleRadius) {
+  float r = params.particleRadius;
+  particleMass = params.particleDensity * 4.0f / 3.0f * (float)M_PI * r * r * r;
+
+  // 由恢復係數 e 換算臨界阻尼比 zeta，gn = 2 * zeta * sqrt(m_eff * kn)
+  float logE = std::log(std::clamp(params.restitution, 0.01f, 1.0f));
+  float zeta = -logE / std::sqrt((float)M_PI * (float)M_PI + logE * logE);
+  normalDamping = 2.0f * zeta * std::sqrt(0.5f * particleMass * params.stiffness);
+  wallDamping = 2.0f * zeta * std::sqrt(particleMass * params.stiffness);
+
+  // 接觸時間的 1/20 作為子步長
+  float contactTime = (float)M_PI * std::sqrt(0.5f * particleMass / params.stiffness);
+  maxSubDt = contactTime / 20.0f;
+
+  jobs = params.jobs ? params.jobs : &JobSystem::shared();
+}
+
+int GranularBed::fillBox(const glm::vec3& min, const glm::vec3& max, unsigned int seed) {
+  std::mt19937 rng(seed);
+  float spacing = 2.0f * params.particleRadius * 1.01f;
+  std::uniform_real_distribution<float> jitter(-0.05f * params.particleRadius, 0.05f * params.particleRadius);
+
+  int added = 0;
+  for (float y = min.y + params.particleRadius; y <= max.y - params.particleRadius; y += spacing) {
+    for (float z = min.z + params.particleRadius; z <= max.z - params.particleRadius; z += spacing) {
+      for (float x = min.x + params.particleRadius; x <= max.x - params.particleRadius; x += spacing) {
+        px.push_back(x + jitter(rng));
+        py.push_back(y);
+        pz.push_back(z + jitter(rng));
+        ++added;
+      }
+    }
+  }
+  vx.resize(px.size(), 0.0f);
+  vy.resize(px.size(), 0.0f);
+  vz.resize(px.size(), 0.0f);
+  fx.resize(px.size(), 0.0f);
+  fy.resize(px.size(), 0.0f);
+  fz.resize(px.size(), 0.0f);
+  return added;
+}
+
+int GranularBed::removeInside(const glm::vec3& center, float radius) {
+  float reach = radius + params.particleRadius;
+  size_t kept = 0;
+  for (size_t i = 0; i < px.size(); ++i) {
+    glm::vec3 d(px[i] - center.x, py[i] - center.y, pz[i] - center.z);
+    if (glm::dot(d, d) < reach * reach) continue;
+    for (auto* v : {&px, &py, &pz, &vx, &vy, &vz}) (*v)[kept] = (*v)[i];
+    ++kept;
+  }
+  int removed = (int)(px.size() - kept);
+  for (auto* v : {&px, &py, &pz, &vx, &vy, &vz, &fx, &fy, &fz}) v->resize(kept);
+  return removed;
+}
+
+void GranularBed::clear() {
+  for (auto* v : {&px, &py, &pz, &vx, &vy, &vz, &fx, &fy, &fz}) v->clear();
+}
+
+void GranularBed::step(float dt) { step(dt, nullptr); }
+
+void GranularBed::step(float dt, Snake* snake) {
+  if (px.empty() || dt <= 0.0f) return;
+  auto start = std::chrono::steady_clock::now();
+
+  // 蛇的質點在這段時間內視為等速移動的大球
+  std::vector<glm::vec3> bodyPos, bodyVel, bodyForce, bodyForceSum;
+  float bodyRadius = 0.0f;
+  if (snake) {
+    for (auto* mass : snake->getMasses()) {
+      bodyPos.push_back(mass->getPosition());
+      bodyVel.push_back(mass->getVelocity());
+    }
+    bodyRadius = snake->getRadius();
+  }
+  bodyForce.resize(bodyPos.size());
+  bodyForceSum.assign(bodyPos.size(), glm::vec3(0.0f));
+
+  int substeps = std::max(1, (int)std::ceil(dt / maxSubDt));
+  float h = dt / substeps;
+  for (int s = 0; s < substeps; ++s) {
+    substep(h, bodyPos, bodyVel, bodyRadius, bodyForce);
+    for (size_t b = 0; b < bodyPos.size(); ++b) {
+      bodyForceSum[b] += bodyForce[b];
+      bodyPos[b] += bodyVel[b] * h;
+    }
+  }
+
+  // 反作用力取整段時間的平均，讓蛇在自己的步長內感受到相同的衝量
+  for (size_t b = 0; b < bodyPos.size(); ++b) {
+    snake->addExternalForce((int)b, bodyForceSum[b] / (float)substeps);
+  }
+
+  double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  stats.particleSteps += (long long)px.size() * substeps;
+  stats.elapsedMs += ms;
+  stats.lastStepMs = ms;
+}
+
+void GranularBed::substep(float dt, const std::vector<glm::vec3>& bodyPos, const std::vector<glm::vec3>& bodyVel,
+                          float bodyRadius, std::vector<glm::vec3>& bodyForce) {
+  sortByCell();
+
+  int n = (int)px.size();
+  jobs->parallelFor(n, 1024, [this](int begin, int end) { computeParticleForces(begin, end); });
+
+  // 蛇的質點只有幾個，附近的粒子也不多，單執行緒處理即可
+  computeBodyForces(bodyPos, bodyVel, bodyRadius, bodyForce);
+
+  jobs->parallelFor(n, 1024, [this, dt](int begin, int end) { integrate(begin, end, dt); });
+}
+
+// 依 cell list 的順序重新排列 SoA，之後同一格的粒子在記憶體中連續
+void GranularBed::sortByCell() {
+  int n = (int)px.size();
+  cells.build(px.data(), py.data(), pz.data(), n);
+  const std::vector<int>& order = cells.getOrder();
+
+  scratch.resize(n);
+  for (auto* v : {&px, &py, &pz, &vx, &vy, &vz}) {
+    for (int k = 0; k < n; ++k) scratch[k] = (*v)[order[k]];
+    v->swap(scratch);
+  }
+}
+
+glm::vec3 GranularBed::contactForce(float overlap, const glm::vec3& normal, const glm::vec3& relVel,
+                                    float damping) const {
+  float vn = glm::dot(relVel, normal);
+  float fn = std::max(0.0f, params.stiffness * overlap - damping * vn);  // 不允許黏住
+
+  glm::vec3 vt = relVel - vn * normal;
+  float vtLen = glm::length(vt);
+  glm::vec3 ft(0.0f);
+  if (vtLen > 1e-6f) {
+    float ftMag = std::min(damping * vtLen, params.friction * fn);
+    ft = -vt / vtLen * ftMag;
+  }
+  return normal * fn + ft;
+}
+
+void GranularBed::computeParticleForces(int begin, int end) {
+  const float diameter = 2.0f * params.particleRadius;
+  const float diameter2 = diameter * diameter;
+  const glm::ivec3 dims = cells.getDims();
+
+  for (int i = begin; i < end; ++i) {
+    glm::vec3 pi(px[i], py[i], pz[i]);
+    glm::vec3 vi(vx[i], vy[i], vz[i]);
+    glm::vec3 force(0.0f, -params.gravity * particleMass, 0.0f);
+
+    // 鄰近 27 格
+    glm::ivec3 c = cells.cellCoord(pi.x, pi.y, pi.z);
+    glm::ivec3 lo = glm::max(c - 1, glm::ivec3(0));
+    glm::ivec3 hi = glm::min(c + 1, dims - 1);
+    for (int cz = lo.z; cz <= hi.z; ++cz) {
+      for (int cy = lo.y; cy <= hi.y; ++cy) {
+        int rowBegin = cells.getCellBegin(cells.cellIndex(glm::ivec3(lo.x, cy, cz)));
+        int rowEnd = cells.getCellEnd(cells.cellIndex(glm::ivec3(hi.x, cy, cz)));
+        // 同一列 x 相鄰的格子在排序後是連續的
+        for (int j = rowBegin; j < rowEnd; ++j) {
+          if (j == i) continue;
+          glm::vec3 d(pi.x - px[j], pi.y - py[j], pi.z - pz[j]);
+          float dist2 = glm::dot(d, d);
+          if (dist2 >= diameter2 || dist2 < 1e-12f) continue;
+          float dist = std::sqrt(dist2);
+          glm::vec3 relVel(vi.x - vx[j], vi.y - vy[j], vi.z - vz[j]);
+          force += contactForce(diameter - dist, d / dist, relVel, normalDamping);
+        }
+      }
+    }
+
+    // 地板與四面牆
+    float r = params.particleRadius;
+    if (pi.y - r < boundsMin.y) force += contactForce(boundsMin.y - (pi.y - r), {0, 1, 0}, vi, wallDamping);
+    if (pi.x - r < boundsMin.x) force += contactForce(boundsMin.x - (pi.x - r), {1, 0, 0}, vi, wallDamping);
+    if (pi.x + r > boundsMax.x) force += contactForce(pi.x + r - boundsMax.x, {-1, 0, 0}, vi, wallDamping);
+    if (pi.z - r < boundsMin.z) force += contactForce(boundsMin.z - (pi.z - r), {0, 0, 1}, vi, wallDamping);
+    if (pi.z + r > boundsMax.z) force += contactForce(pi.z + r - boundsMax.z, {0, 0, -1}, vi, wallDamping);
+
+    fx[i] = force.x;
+    fy[i] = force.y;
+    fz[i] = force.z;
+  }
+}
+
+void GranularBed::computeBodyForces(const std::vector<glm::vec3>& bodyPos, const std::vector<glm::vec3>& bodyVel,
+                                    float bodyRadius, std::vector<glm::vec3>& bodyForce) {
+  const float reach = bodyRadius + params.particleRadius;
+  for (size_t b = 0; b < bodyPos.size(); ++b) {
+    bodyForce[b] = glm::vec3(0.0f);
+    glm::ivec3 lo = cells.cellCoord(bodyPos[b].x - reach, bodyPos[b].y - reach, bodyPos[b].z - reach);
+    glm::ivec3 hi = cells.cellCoord(bodyPos[b].x + reach, bodyPos[b].y + reach, bodyPos[b].z + reach);
+    for (int cz = lo.z; cz <= hi.z; ++cz) {
+      for (int cy = lo.y; cy <= hi.y; ++cy) {
+        int rowBegin = cells.getCellBegin(cells.cellIndex(glm::ivec3(lo.x, cy, cz)));
+        int rowEnd = cells.getCellEnd(cells.cellIndex(glm::ivec3(hi.x, cy, cz)));
+        for (int j = rowBegin; j < rowEnd; ++j) {
+          glm::vec3 d(px[j] - bodyPos[b].x, py[j] - bodyPos[b].y, pz[j] - bodyPos[b].z);
+          float dist2 = glm::dot(d, d);
+          if (dist2 >= reach * reach || dist2 < 1e-12f) continue;
+          float dist = std::sqrt(dist2);
+          glm::vec3 relVel(vx[j] - bodyVel[b].x, vy[j] - bodyVel[b].y, vz[j] - bodyVel[b].z);
+          glm::vec3 f = contactForce(reach - dist, d / dist, relVel, wallDamping);
+          fx[j] += f.x;
+          fy[j] += f.y;
+          fz[j] += f.z;
+          bodyForce[b] -= f;
+        }
+      }
+    }
+  }
+}
+
+void GranularBed::integrate(int begin, int end, float dt) {
+  const float invMass = 1.0f / particleMass;
+  for (int i = begin; i < end; ++i) {
+    vx[i] += fx[i] * invMass * dt;
+    vy[i] += fy[i] * invMass * dt;
+    vz[i] += fz[i] * invMass * dt;
+    px[i] += vx[i] * dt;
+    py[i] += vy[i] * dt;
+    pz[i] += vz[i] * dt;
+  }
+}
@@ -0,0 +1,375 @@
+#include "JobSystem.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+// 目前執行緒屬於哪個系統的幾號執行緒
+struct ThreadSlot {
+  const JobSystem* owner = nullptr;
+  int slot = -1;
+};
+thread_local ThreadSlot currentThreadSlot;
+
+#ifndef _WIN32
+// 解析 "0-3,8-11" 這種 CPU 清單
+std::vector<int> parseCpuList(const std::string& text) {
+  std::vector<int> cpus;
+  std::stringstream ss(text);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    if (range.empty() || range[0] == '\n') continue;
+    int first = 0, last = 0;
+    size_t dash = range.find('-');
+    try {
+      first = std::stoi(range.substr(0, dash));
+      last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+    } catch (...) {
+      continue;
+    }
+    for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+  }
+  return cpus;
+}
+#endif
+
+void pinCurrentThread(int cpu) {
+#ifdef _WIN32
+  if (cpu < 64) SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpu);
+#else
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+}
+
+JobSystem::Topology singleNode() {
+  JobSystem::Topology topology;
+  topology.nodeCpus.resize(1);
+  return topology;
+}
+
+// 閒置這麼多輪之後才去拿送給其他節點的工作，讓該節點自己的執行緒先拿
+const int REMOTE_QUEUE_IDLE_ROUNDS = 16;
+}  // namespace
+
+// ========== NUMA 拓撲 ==========
+
+JobSystem::Topology JobSystem::Topology::detect() {
+  Topology topology;
+#ifdef _WIN32
+  ULONG highestNode = 0;
+  if (GetNumaHighestNodeNumber(&highestNode)) {
+    for (ULONG node = 0; node <= highestNode; ++node) {
+      GROUP_AFFINITY affinity = {};
+      if (!GetNumaNodeProcessorMaskEx((USHORT)node, &affinity) || affinity.Group != 0) continue;
+      std::vector<int> cpus;
+      for (int cpu = 0; cpu < 64; ++cpu) {
+        if (affinity.Mask & (KAFFINITY(1) << cpu)) cpus.push_back(cpu);
+      }
+      if (!cpus.empty()) topology.nodeCpus.push_back(cpus);
+    }
+  }
+#else
+  // 只保留這個行程可以用的 CPU（taskset、cgroup 限制）
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  bool haveAllowed = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+  for (int node = 0;; ++node) {
+    std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    if (!file) break;
+    std::string text;
+    std::getline(file, text);
+    std::vector<int> cpus;
+    for (int cpu : parseCpuList(text)) {
+      if (!haveAllowed || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))) cpus.push_back(cpu);
+    }
+    if (!cpus.empty()) topology.nodeCpus.push_back(cpus);
+  }
+#endif
+  if (topology.nodeCpus.empty()) topology.nodeCpus.push_back({});
+  return topology;
+}
+
+int JobSystem::Topology::getNumCpus() const {
+  int count = 0;
+  for (const auto& cpus : nodeCpus) count += (int)cpus.size();
+  return count;
+}
+
+// ========== Chase-Lev 雙端佇列 ==========
+
+bool JobSystem::WorkStealingDeque::push(const Job& job) {
+  int64_t b = bottom.load(std::memory_order_relaxed);
+  int64_t t = top.load(std::memory_order_acquire);
+  if (b - t >= JOBS_PER_THREAD) return false;
+  jobs[b & (JOBS_PER_THREAD - 1)] = job;
+  std::atomic_thread_fence(std::memory_order_release);
+  bottom.store(b + 1, std::memory_order_relaxed);
+  return true;
+}
+
+bool JobSystem::WorkStealingDeque::pop(Job& out) {
+  int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+  bottom.store(b, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t t = top.load(std::memory_order_relaxed);
+
+  if (t > b) {
+    // 空的
+    bottom.store(b + 1, std::memory_order_relaxed);
+    return false;
+  }
+
+  out = jobs[b & (JOBS_PER_THREAD - 1)];
+  if (t == b) {
+    // 最後一個，和小偷搶
+    bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    bottom.store(b + 1, std::memory_order_relaxed);
+    return won;
+  }
+  return true;
+}
+
+bool JobSystem::WorkStealingDeque::steal(Job& out) {
+  int64_t t = top.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t b = bottom.load(std::memory_order_acquire);
+  if (t >= b) return false;
+
+  // 先複製再搶：擁有者要等 top 超過 t 才會覆寫這個位置，那時 CAS 一定失敗，複製到的內容就丟掉
+  out = jobs[t & (JOBS_PER_THREAD - 1)];
+  return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+}
+
+// ========== 工作系統 ==========
+
+JobSystem::JobSystem(int numThreads) : JobSystem(numThreads, singleNode(), false) {}
+
+JobSystem::JobSystem(int numThreads, const Topology& topology, bool pinThreads) {
+  if (numThreads <= 0) numThreads = (int)std::max(1u, std::thread::hardware_concurrency());
+
+  // 依各節點的 CPU 數比例分配執行緒，分不到執行緒的節點不建立
+  int numNodes = std::max(1, topology.getNumNodes());
+  int totalCpus = topology.getNumCpus();
+  std::vector<int> perNode(numNodes, 0);
+  int assigned = 0;
+  for (int k = 0; k < numNodes; ++k) {
+    int cpus = totalCpus > 0 ? (int)topology.nodeCpus[k].size() : 1;
+    perNode[k] = (int)((long long)numThreads * cpus / std::max(1, totalCpus > 0 ? totalCpus : numNodes));
+    assigned += perNode[k];
+  }
+  perNode[0] += numThreads - assigned;  // 除不盡的給 0 號執行緒所在的節點
+
+  for (int k = 0; k < numNodes; ++k) {
+    if (perNode[k] == 0) continue;
+    auto node = std::make_unique<Node>();
+    node->firstSlot = (int)slots.size();
+    node->numSlots = perNode[k];
+    for (int j = 0; j < perNode[k]; ++j) {
+      int i = (int)slots.size();
+      slots.push_back(std::make_unique<Slot>());
+      Slot& slot = *slots.back();
+      slot.rngState = 0x9e3779b9u * (i + 1);
+      slot.node = (int)nodes.size();
+      const auto* cpus = totalCpus > 0 ? &topology.nodeCpus[k] : nullptr;
+      if (pinThreads && i > 0 && cpus && !cpus->empty()) slot.cpu = (*cpus)[j % cpus->size()];
+    }
+    node->jobs.reserve(JOBS_PER_THREAD);
+    nodes.push_back(std::move(node));
+  }
+  foreignJobs.reserve(JOBS_PER_THREAD);
+
+  previousOwner = currentThreadSlot.owner;
+  previousSlot = currentThreadSlot.slot;
+  currentThreadSlot = {this, 0};
+  for (int i = 1; i < numThreads; ++i) {
+    threads.emplace_back(&JobSystem::workerLoop, this, i);
+  }
+}
+
+JobSystem::~JobSystem() {
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    stopping.store(true);
+  }
+  wakeCondition.notify_all();
+  for (auto& thread : threads) thread.join();
+  if (currentThreadSlot.owner == this) currentThreadSlot = {previousOwner, previousSlot};
+}
+
+JobSystem& JobSystem::shared() {
+  static JobSystem instance;
+  return instance;
+}
+
+int JobSystem::currentSlot() const { return currentThreadSlot.owner == this ? currentThreadSlot.slot : -1; }
+
+int JobSystem::currentNode() const {
+  int slot = currentSlot();
+  return slot >= 0 ? slots[slot]->node : -1;
+}
+
+void JobSystem::run(JobFunction fn, void* context, int begin, int end, int grain, Counter* counter) {
+  if (counter) counter->pending.fetch_add(1, std::memory_order_relaxed);
+  submit(currentSlot(), {fn, context, begin, end, grain, counter});
+}
+
+void JobSystem::runOnNode(int node, JobFunction fn, void* context, int begin, int end, int grain, Counter* counter) {
+  int slot = currentSlot();
+  if (slot >= 0 && slots[slot]->node == node) {
+    run(fn, context, begin, end, grain, counter);
+    return;
+  }
+
+  if (counter) counter->pending.fetch_add(1, std::memory_order_relaxed);
+  queuedJobs.fetch_add(1);
+  {
+    std::lock_guard<std::mutex> lock(nodes[node]->mutex);
+    nodes[node]->jobs.push_back({fn, context, begin, end, grain, counter});
+  }
+  // 不知道誰醒來，全部叫醒，該節點的執行緒才拿得到
+  if (sleepers.load() > 0) {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    wakeCondition.notify_all();
+  }
+}
+
+void JobSystem::submit(int slot, const Job& job) {
+  queuedJobs.fetch_add(1);
+  if (slot >= 0) {
+    if (!slots[slot]->deque.push(job)) {
+      // 佇列滿了就直接在這裡做，佇列裡的工作都不動
+      queuedJobs.fetch_sub(1);
+      execute(slot, job);
+      return;
+    }
+  } else {
+    std::lock_guard<std::mutex> lock(foreignMutex);
+    foreignJobs.push_back(job);
+  }
+
+  if (sleepers.load() > 0) {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    wakeCondition.notify_one();
+  }
+}
+
+bool JobSystem::takeQueued(std::mutex& mutex, std::vector<Job>& queue, Job& out) {
+  std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+  if (!lock.owns_lock() || queue.empty()) return false;
+  out = queue.back();
+  queue.pop_back();
+  return true;
+}
+
+// 從 [firstVictim, firstVictim + numVictims) 裡隨機的一個開始輪流偷
+bool JobSystem::stealFrom(int slot, int firstVictim, int numVictims, uint32_t r, Job& out) {
+  for (int k = 0; k < numVictims; ++k) {
+    int victim = firstVictim + (int)((r + k) % numVictims);
+    if (victim == slot) continue;
+    if (slots[victim]->deque.steal(out)) return true;
+  }
+  return false;
+}
+
+// 找工作的順序：自己的佇列 -> 送給自己節點的 -> 外部執行緒送來的 -> 偷同節點的
+//               -> 偷其他節點的 -> 送給其他節點、但還沒人拿的
+bool JobSystem::findJob(int slot, Job& out, bool takeRemote) {
+  bool found = slot >= 0 && slots[slot]->deque.pop(out);
+
+  int home = slot >= 0 ? slots[slot]->node : -1;
+  bool queued = queuedJobs.load(std::memory_order_relaxed) > 0;
+  if (!found && queued && home >= 0) found = takeQueued(nodes[home]->mutex, nodes[home]->jobs, out);
+  if (!found && queued) found = takeQueued(foreignMutex, foreignJobs, out);
+
+  if (!found) {
+    uint32_t r;
+    if (slot >= 0) {
+      uint32_t& state = slots[slot]->rngState;
+      state ^= state << 13;
+      state ^= state >> 17;
+      state ^= state << 5;
+      r = state;
+    } else {
+      r = (uint32_t)std::hash<std::thread::id>()(std::this_thread::get_id());
+    }
+    if (home >= 0) found = stealFrom(slot, nodes[home]->firstSlot, nodes[home]->numSlots, r, out);
+    for (int k = 0; k < (int)nodes.size() && !found; ++k) {
+      int node = (int)((r + k) % nodes.size());
+      if (node != home) found = stealFrom(slot, nodes[node]->firstSlot, nodes[node]->numSlots, r, out);
+    }
+    for (int k = 0; k < (int)nodes.size() && !found && queued && takeRemote; ++k) {
+      if (k != home) found = takeQueued(nodes[k]->mutex, nodes[k]->jobs, out);
+    }
+  }
+
+  if (found) queuedJobs.fetch_sub(1);
+  return found;
+}
+
+void JobSystem::execute(int slot, Job job) {
+  // 範圍太大就把右半邊丟出去給別人偷，自己繼續做左半邊
+  while (job.grain > 0 && job.end - job.begin > job.grain) {
+    int mid = job.begin + (job.end - job.begin) / 2;
+    Job right = job;
+    right.begin = mid;
+    if (job.counter) job.counter->pending.fetch_add(1, std::memory_order_relaxed);
+    submit(slot, right);
+    job.end = mid;
+  }
+
+  job.function(job.context, job.begin, job.end);
+  if (job.counter) job.counter->pending.fetch_sub(1, std::memory_order_release);
+}
+
+void JobSystem::wait(Counter& counter) {
+  int slot = currentSlot();
+  int idleRounds = 0;
+  while (!counter.isDone()) {
+    Job job;
+    if (findJob(slot, job, idleRounds >= REMOTE_QUEUE_IDLE_ROUNDS)) {
+      execute(slot, job);
+      idleRounds = 0;
+    } else {
+      ++idleRounds;
+      std::this_thread::yield();
+    }
+  }
+}
+
+void JobSystem::workerLoop(int slot) {
+  currentThreadSlot = {this, slot};
+  if (slots[slot]->cpu >= 0) pinCurrentThread(slots[slot]->cpu);
+  int idleRounds = 0;
+  while (!stopping.load(std::memory_order_relaxed)) {
+    Job job;
+    if (findJob(slot, job, idleRounds >= REMOTE_QUEUE_IDLE_ROUNDS)) {
+      execute(slot, job);
+      idleRounds = 0;
+      continue;
+    }
+
+    // 先空轉一下，還是沒工作才去睡
+    if (++idleRounds < 64) {
+      std::this_thread::yield();
+      continue;
+    }
+    idleRounds = 0;
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    sleepers.fetch_add(1);
+    wakeCondition.wait(lock, [this] { return stopping.load() || queuedJobs.load() > 0; });
+    sleepers.fetch_sub(1);
+  }
+}
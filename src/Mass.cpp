@@ -1,31 +1,50 @@
 ﻿#include "Mass.h"
 
 
-Mass::Mass(float mass, const glm::vec3& position)
+template <typename T, typename Acc>
+BasicMass<T, Acc>::BasicMass(T mass, const Vec3& position)
     : mass(mass),
       position(position),
-      velocity(0.0f, 0.0f, 0.0f),  
-      force(0.0f, 0.0f, 0.0f) {  
+      velocity(0, 0, 0),  
+      force(0, 0, 0) {  
 }
 
 //施加力,力是累加的
-void Mass::applyForce(const glm::vec3& f) {
+template <typename T, typename Acc>
+void BasicMass<T, Acc>::applyForce(const AccVec3& f) {
   force += f; 
 }
 
 //重置
-void Mass::resetForce() { force = glm::vec3(0.0f, 0.0f, 0.0f); }
+template <typename T, typename Acc>
+void BasicMass<T, Acc>::resetForce() { force = AccVec3(0, 0, 0); }
 
 
-void Mass::update(float dt) {
+template <typename T, typename Acc>
+void BasicMass<T, Acc>::update(T dt) {
   
   // F = ma 
-  glm::vec3 acceleration = force / mass;
+  AccVec3 acceleration = force / Acc(mass);
 
   // v(t+dt) = v(t) + a*dt
-  velocity += acceleration * dt;
+  velocity += Vec3(acceleration * Acc(dt));
 
   // x(t+dt) = x(t) + v*dt
   position += velocity * dt;
 
-}
\ No newline at end of file
+}
+
+template <typename T, typename Acc>
+void BasicMass<T, Acc>::integrateVelocity(T dt) {
+  velocity += Vec3(force / Acc(mass) * Acc(dt));
+}
+
+template <typename T, typename Acc>
+void BasicMass<T, Acc>::integratePosition(T dt) {
+  position += velocity * dt;
+}
+
+// 支援的精度組合
+template class BasicMass<float>;
+template class BasicMass<double>;
+template class BasicMass<float, double>;
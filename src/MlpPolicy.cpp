@@ -0,0 +1,254 @@
+#include "MlpPolicy.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+namespace {
+
+const int NR = 16;          // 面板寬度（輸出）
+const int MR = 8;           // 核心一次算的列數：8 列 x 16 行剛好是 8 個 AVX-512 暫存器
+const int ROW_BLOCK = 64;   // 同一批列跑完所有面板，讓這些列留在 L1
+const uint32_t MAX_WIDTH = 1 << 16;
+const char MAGIC[4] = {'M', 'L', 'P', '1'};
+
+int padded(int n) { return (n + NR - 1) / NR * NR; }
+
+// tanh 的 [13/6] 有理近似（與 Eigen 相同的係數），誤差小於 1e-6，
+// 只有乘加、除法與 clamp，可以向量化；std::tanh 會讓整個核心卡在逐一呼叫函式庫
+inline float fastTanh(float x) {
+  x = std::clamp(x, -7.90531110f, 7.90531110f);
+  float x2 = x * x;
+  float p = -2.76076847742355e-16f;
+  p = p * x2 + 2.00018790482477e-13f;
+  p = p * x2 - 8.60467152213735e-11f;
+  p = p * x2 + 5.12229709037114e-08f;
+  p = p * x2 + 1.48572235717979e-05f;
+  p = p * x2 + 6.37261928875436e-04f;
+  p = p * x2 + 4.89352455891786e-03f;
+  float q = 1.19825839466702e-06f;
+  q = q * x2 + 1.18534705686654e-04f;
+  q = q * x2 + 2.26843463243900e-03f;
+  q = q * x2 + 4.89352518554385e-03f;
+  return x * p / q;
+}
+
+// c[ROWS][cols] = act(a[ROWS][k] * panel[k][NR] + bias)
+template <int ROWS>
+void kernel(const float* a, int lda, const float* panel, int k, const float* bias, MlpPolicy::Activation activation,
+            float* c, int ldc, int cols) {
+  float acc[ROWS][NR];
+  for (int r = 0; r < ROWS; ++r) {
+    for (int j = 0; j < NR; ++j) acc[r][j] = bias[j];
+  }
+  for (int p = 0; p < k; ++p) {
+    const float* w = panel + p * NR;
+    float x[ROWS];
+    for (int r = 0; r < ROWS; ++r) x[r] = a[r * lda + p];
+    // j 在外、列在內：列的迴圈展開後 j 就是向量；反過來寫編譯器會沿著列向量化，變成一堆 shuffle
+    for (int j = 0; j < NR; ++j) {
+      for (int r = 0; r < ROWS; ++r) acc[r][j] += x[r] * w[j];
+    }
+  }
+
+  if (activation == MlpPolicy::Activation::RELU) {
+    for (int r = 0; r < ROWS; ++r) {
+      for (int j = 0; j < NR; ++j) acc[r][j] = std::max(acc[r][j], 0.0f);
+    }
+  } else if (activation == MlpPolicy::Activation::TANH) {
+    for (int r = 0; r < ROWS; ++r) {
+      for (int j = 0; j < NR; ++j) acc[r][j] = fastTanh(acc[r][j]);
+    }
+  }
+  for (int r = 0; r < ROWS; ++r) {
+    for (int j = 0; j < cols; ++j) c[r * ldc + j] = acc[r][j];
+  }
+}
+
+float activate(float x, MlpPolicy::Activation activation) {
+  if (activation == MlpPolicy::Activation::RELU) return std::max(x, 0.0f);
+  if (activation == MlpPolicy::Activation::TANH) return std::tanh(x);
+  return x;
+}
+
+}  // namespace
+
+// ========== 建立與存檔 ==========
+
+bool MlpPolicy::addLayer(int inputs, int outputs, Activation activation, const float* weights, const float* bias) {
+  if (inputs <= 0 || outputs <= 0 || (uint32_t)inputs > MAX_WIDTH || (uint32_t)outputs > MAX_WIDTH) {
+    std::cout << "[ERROR] Bad layer size " << inputs << " x " << outputs << std::endl;
+    return false;
+  }
+  if (!layers.empty() && layers.back().outputs != inputs) {
+    std::cout << "[ERROR] Layer expects " << inputs << " inputs but the previous layer has "
+              << layers.back().outputs << " outputs" << std::endl;
+    return false;
+  }
+
+  Layer layer;
+  layer.inputs = inputs;
+  layer.outputs = outputs;
+  layer.activation = activation;
+  layer.weights.assign(weights, weights + (size_t)inputs * outputs);
+  layer.bias.assign(padded(outputs), 0.0f);
+  std::copy(bias, bias + outputs, layer.bias.begin());
+
+  int numPanels = padded(outputs) / NR;
+  layer.panels.assign((size_t)numPanels * inputs * NR, 0.0f);
+  for (int o = 0; o < outputs; ++o) {
+    float* panel = &layer.panels[(size_t)(o / NR) * inputs * NR];
+    for (int i = 0; i < inputs; ++i) panel[i * NR + o % NR] = weights[(size_t)o * inputs + i];
+  }
+
+  maxWidth = std::max(maxWidth, padded(outputs));
+  layers.push_back(std::move(layer));
+  return true;
+}
+
+MlpPolicy MlpPolicy::createRandom(const std::vector<int>& sizes, Activation hidden, Activation output,
+                                  unsigned int seed) {
+  MlpPolicy policy;
+  std::mt19937 rng(seed);
+  for (size_t l = 0; l + 1 < sizes.size(); ++l) {
+    int inputs = sizes[l], outputs = sizes[l + 1];
+    float limit = std::sqrt(6.0f / (inputs + outputs));
+    std::uniform_real_distribution<float> dist(-limit, limit);
+    std::vector<float> weights((size_t)inputs * outputs);
+    for (float& w : weights) w = dist(rng);
+    std::vector<float> bias(outputs, 0.0f);
+    policy.addLayer(inputs, outputs, l + 2 == sizes.size() ? output : hidden, weights.data(), bias.data());
+  }
+  return policy;
+}
+
+MlpPolicy* MlpPolicy::fromFile(const char* filename) {
+  std::ifstream file(filename, std::ios::binary);
+  if (!file.is_open()) {
+    std::cout << "[ERROR] Can't open policy: " << filename << std::endl;
+    return NULL;
+  }
+
+  char magic[4];
+  uint32_t numLayers = 0;
+  if (!file.read(magic, 4) || std::memcmp(magic, MAGIC, 4) != 0 ||
+      !file.read(reinterpret_cast<char*>(&numLayers), sizeof(numLayers)) || numLayers == 0) {
+    std::cout << "[ERROR] " << filename << " is not an MLP1 policy file" << std::endl;
+    return NULL;
+  }
+
+  MlpPolicy* policy = new MlpPolicy();
+  std::vector<float> weights, bias;
+  for (uint32_t l = 0; l < numLayers; ++l) {
+    uint32_t header[3];
+    bool ok = static_cast<bool>(file.read(reinterpret_cast<char*>(header), sizeof(header)));
+    ok = ok && header[0] > 0 && header[0] <= MAX_WIDTH && header[1] > 0 && header[1] <= MAX_WIDTH && header[2] <= 2;
+    if (ok) {
+      weights.resize((size_t)header[0] * header[1]);
+      bias.resize(header[1]);
+      ok = file.read(reinterpret_cast<char*>(weights.data()), sizeof(float) * weights.size()) &&
+           file.read(reinterpret_cast<char*>(bias.data()), sizeof(float) * bias.size());
+    }
+    if (!ok || !policy->addLayer((int)header[0], (int)header[1], (Activation)header[2], weights.data(), bias.data())) {
+      std::cout << "[ERROR] Bad layer " << l << " in policy file: " << filename << std::endl;
+      delete policy;
+      return NULL;
+    }
+  }
+  return policy;
+}
+
+bool MlpPolicy::save(const char* filename) const {
+  std::ofstream file(filename, std::ios::binary);
+  if (!file.is_open()) {
+    std::cout << "[ERROR] Can't write policy: " << filename << std::endl;
+    return false;
+  }
+  uint32_t numLayers = (uint32_t)layers.size();
+  file.write(MAGIC, 4);
+  file.write(reinterpret_cast<const char*>(&numLayers), sizeof(numLayers));
+  for (const Layer& layer : layers) {
+    uint32_t header[3] = {(uint32_t)layer.inputs, (uint32_t)layer.outputs, (uint32_t)layer.activation};
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(layer.weights.data()), sizeof(float) * layer.weights.size());
+    file.write(reinterpret_cast<const char*>(layer.bias.data()), sizeof(float) * layer.outputs);
+  }
+  return static_cast<bool>(file);
+}
+
+long long MlpPolicy::getFlopsPerSample() const {
+  long long flops = 0;
+  for (const Layer& layer : layers) flops += 2LL * layer.inputs * layer.outputs;
+  return flops;
+}
+
+// ========== 推論 ==========
+
+void MlpPolicy::multiply(const Layer& layer, const float* input, int lda, int batch, float* output, int ldc) {
+  const int numPanels = padded(layer.outputs) / NR;
+  for (int r0 = 0; r0 < batch; r0 += ROW_BLOCK) {
+    int r1 = std::min(batch, r0 + ROW_BLOCK);
+    for (int p = 0; p < numPanels; ++p) {
+      const float* panel = &layer.panels[(size_t)p * layer.inputs * NR];
+      const float* bias = &layer.bias[p * NR];
+      int cols = std::min(NR, layer.outputs - p * NR);
+      int r = r0;
+      for (; r + MR <= r1; r += MR) {
+        kernel<MR>(input + (size_t)r * lda, lda, panel, layer.inputs, bias, layer.activation,
+                   output + (size_t)r * ldc + p * NR, ldc, cols);
+      }
+      for (; r < r1; ++r) {
+        kernel<1>(input + (size_t)r * lda, lda, panel, layer.inputs, bias, layer.activation,
+                  output + (size_t)r * ldc + p * NR, ldc, cols);
+      }
+    }
+  }
+}
+
+void MlpPolicy::forward(const float* input, int batch, float* output) const {
+  if (layers.empty() || batch <= 0) return;
+
+  // 兩塊輪流當輸入與輸出，列距補齊到 16 的倍數
+  thread_local std::vector<float> scratch;
+  size_t half = (size_t)batch * maxWidth;
+  if (scratch.size() < 2 * half) scratch.resize(2 * half);
+
+  const float* in = input;
+  int lda = layers.front().inputs;
+  for (size_t l = 0; l < layers.size(); ++l) {
+    const Layer& layer = layers[l];
+    bool last = l + 1 == layers.size();
+    float* out = last ? output : scratch.data() + (l % 2) * half;
+    int ldc = last ? layer.outputs : padded(layer.outputs);
+    multiply(layer, in, lda, batch, out, ldc);
+    in = out;
+    lda = ldc;
+  }
+}
+
+void MlpPolicy::forward(const float* input, int batch, float* output, JobSystem& jobs, int rowsPerJob) const {
+  const int inputs = getInputSize();
+  const int outputs = getOutputSize();
+  jobs.parallelFor(batch, std::max(1, rowsPerJob), [this, input, output, inputs, outputs](int begin, int end) {
+    forward(input + (size_t)begin * inputs, end - begin, output + (size_t)begin * outputs);
+  });
+}
+
+void MlpPolicy::forwardReference(const float* input, int batch, float* output) const {
+  std::vector<float> current, next;
+  for (int b = 0; b < batch; ++b) {
+    current.assign(input + (size_t)b * getInputSize(), input + (size_t)(b + 1) * getInputSize());
+    for (const Layer& layer : layers) {
+      next.assign(layer.outputs, 0.0f);
+      for (int o = 0; o < layer.outputs; ++o) {
+        float sum = layer.bias[o];
+        for (int i = 0; i < layer.inputs; ++i) sum += layer.weights[(size_t)o * layer.inputs + i] * current[i];
+        next[o] = activate(sum, layer.activation);
+      }
+      current.swap(next);
+    }
+    std::copy(current.begin(), current.end(), output + (size_t)b * getOutputSize());
+  }
+}
@@ -0,0 +1,451 @@
+#include "NetGame.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace net {
+
+namespace {
+
+const size_t MESSAGE_HEADER = 5;            // uint32 長度 + uint8 種類
+const uint32_t MAX_MESSAGE = 4 * 1024 * 1024;
+
+#ifdef MSG_NOSIGNAL
+const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+const int SEND_FLAGS = 0;
+#endif
+
+// ========== socket ==========
+
+#ifndef _WIN32
+bool fillAddress(const std::string& path, sockaddr_un& address) {
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+    std::cout << "[ERROR] Bad socket path: " << path << std::endl;
+    return false;
+  }
+  std::memcpy(address.sun_path, path.c_str(), path.size());
+  return true;
+}
+
+void setNonBlocking(int fd) {
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+}
+#endif
+
+void closeSocket(int fd) {
+#ifndef _WIN32
+  if (fd >= 0) close(fd);
+#else
+  (void)fd;
+#endif
+}
+
+// 回傳讀到的位元組數；0 表示對方關閉，-1 表示錯誤，沒有資料時回傳 -2
+long receiveSome(int fd, uint8_t* buffer, size_t size) {
+#ifndef _WIN32
+  ssize_t n = recv(fd, buffer, size, 0);
+  if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ? -2 : -1;
+  return (long)n;
+#else
+  (void)fd;
+  (void)buffer;
+  (void)size;
+  return -1;
+#endif
+}
+
+// 回傳送出的位元組數，送不出去時回傳 0，錯誤回傳 -1
+long sendSome(int fd, const uint8_t* data, size_t size) {
+#ifndef _WIN32
+  ssize_t n = send(fd, data, size, SEND_FLAGS);
+  if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ? 0 : -1;
+  return (long)n;
+#else
+  (void)fd;
+  (void)data;
+  (void)size;
+  return -1;
+#endif
+}
+
+// ========== 訊息 ==========
+
+void put32(std::vector<uint8_t>& out, uint32_t value) {
+  uint8_t bytes[4];
+  std::memcpy(bytes, &value, 4);
+  out.insert(out.end(), bytes, bytes + 4);
+}
+
+void putFloat(std::vector<uint8_t>& out, float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, 4);
+  put32(out, bits);
+}
+
+uint32_t get32(const uint8_t* data) {
+  uint32_t value;
+  std::memcpy(&value, data, 4);
+  return value;
+}
+
+float getFloat(const uint8_t* data) {
+  float value;
+  std::memcpy(&value, data, 4);
+  return value;
+}
+
+// 在 out 後面開始一個訊息，回傳長度欄位的位置，寫完內容後交給 endMessage
+size_t beginMessage(std::vector<uint8_t>& out, MessageType type) {
+  size_t start = out.size();
+  put32(out, 0);
+  out.push_back(type);
+  return start;
+}
+
+void endMessage(std::vector<uint8_t>& out, size_t start) {
+  uint32_t length = (uint32_t)(out.size() - start - 4);
+  std::memcpy(&out[start], &length, 4);
+}
+
+// 從 buffer 開頭取出完整的訊息交給 handler，剩下不完整的留著；訊息長度不合理時回傳 false
+template <typename Handler>
+bool consumeMessages(std::vector<uint8_t>& buffer, Handler handler) {
+  size_t pos = 0;
+  while (buffer.size() - pos >= MESSAGE_HEADER) {
+    uint32_t length = get32(&buffer[pos]);
+    if (length < 1 || length > MAX_MESSAGE) return false;
+    if (buffer.size() - pos < 4 + (size_t)length) break;
+    handler(buffer[pos + 4], &buffer[pos + MESSAGE_HEADER], (size_t)length - 1);
+    pos += 4 + length;
+  }
+  buffer.erase(buffer.begin(), buffer.begin() + pos);
+  return true;
+}
+
+// 讀到沒有資料為止，回傳 false 表示連線已經關閉
+bool receiveAll(int fd, std::vector<uint8_t>& buffer, long long& bytes) {
+  uint8_t chunk[16384];
+  while (true) {
+    long n = receiveSome(fd, chunk, sizeof(chunk));
+    if (n == -2) return true;
+    if (n <= 0) return false;
+    buffer.insert(buffer.end(), chunk, chunk + n);
+    bytes += n;
+  }
+}
+
+}  // namespace
+
+// ========== 伺服器 ==========
+
+GameServer::GameServer(const Config& config, JobSystem* jobs)
+    : config(config), world(config.rules, jobs), history(HISTORY_SIZE) {
+  // 起點排成格子，蛇身往 +x 延伸，右邊多留一個蛇身的長度
+  const SnakeWorld::Rules& rules = config.rules;
+  const int n = std::max(1, config.numSnakes);
+  float length = config.snake.segmentLength * (config.snake.numSegments - 1);
+  float x0 = 1.5f, x1 = std::max(x0, rules.arenaWidth - 1.5f - length);
+  float z0 = 1.0f, z1 = std::max(z0, rules.arenaDepth - 1.0f);
+  int columns = std::max(1, (int)std::ceil(std::sqrt(n * (x1 - x0 + 1.0f) / (z1 - z0 + 1.0f))));
+  int rows = (n + columns - 1) / columns;
+  world.reserve(n);
+  for (int i = 0; i < n; ++i) {
+    float x = columns > 1 ? x0 + (x1 - x0) * (i % columns) / (columns - 1) : 0.5f * (x0 + x1);
+    float z = rows > 1 ? z0 + (z1 - z0) * (i / columns) / (rows - 1) : 0.5f * (z0 + z1);
+    world.addSnake(config.snake, glm::vec3(x, 0.5f, z), config.seed + (unsigned int)i);
+    world.setAutopilot(i, true);
+  }
+  world.startAll();
+  taken.assign(n, false);
+}
+
+GameServer::~GameServer() {
+  for (Client& client : clients) closeSocket(client.fd);
+  if (listenFd >= 0) {
+    closeSocket(listenFd);
+#ifndef _WIN32
+    unlink(config.socketPath.c_str());
+#endif
+  }
+}
+
+bool GameServer::start() {
+#ifndef _WIN32
+  sockaddr_un address;
+  if (!fillAddress(config.socketPath, address)) return false;
+  unlink(config.socketPath.c_str());
+  listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listenFd < 0 || bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+      listen(listenFd, 16) != 0) {
+    std::cout << "[ERROR] Cannot listen on " << config.socketPath << ": " << std::strerror(errno) << std::endl;
+    closeSocket(listenFd);
+    listenFd = -1;
+    return false;
+  }
+  setNonBlocking(listenFd);
+  return true;
+#else
+  std::cout << "[ERROR] The multiplayer server needs UNIX domain sockets" << std::endl;
+  return false;
+#endif
+}
+
+void GameServer::acceptClients() {
+#ifndef _WIN32
+  if (listenFd < 0) return;
+  while (true) {
+    int fd = accept(listenFd, nullptr, nullptr);
+    if (fd < 0) return;
+    setNonBlocking(fd);
+    Client client;
+    client.fd = fd;
+    auto free = std::find(taken.begin(), taken.end(), false);
+    if (free != taken.end()) {
+      client.snake = (int)(free - taken.begin());
+      taken[client.snake] = true;
+      world.setAutopilot(client.snake, false);
+      world.setInput(client.snake, false, false, false);
+    }
+    clients.push_back(std::move(client));
+  }
+#endif
+}
+
+void GameServer::readClient(Client& client) {
+  if (!receiveAll(client.fd, client.in, stats.bytesReceived)) client.closed = true;
+  bool ok = consumeMessages(client.in, [this, &client](uint8_t type, const uint8_t* body, size_t size) {
+    handleMessage(client, type, body, size);
+  });
+  if (!ok) client.closed = true;
+}
+
+void GameServer::handleMessage(Client& client, uint8_t type, const uint8_t* body, size_t size) {
+  if (type == HELLO && size >= 4) {
+    if (get32(body) != PROTOCOL_VERSION) {
+      std::cout << "[ERROR] Client speaks protocol " << get32(body) << ", server " << PROTOCOL_VERSION << std::endl;
+      client.closed = true;
+      return;
+    }
+    size_t start = beginMessage(client.out, WELCOME);
+    put32(client.out, PROTOCOL_VERSION);
+    put32(client.out, (uint32_t)client.snake);
+    putFloat(client.out, config.tickRate);
+    putFloat(client.out, config.rules.arenaWidth);
+    putFloat(client.out, config.rules.arenaDepth);
+    putFloat(client.out, config.rules.appleHeight);
+    endMessage(client.out, start);
+  } else if (type == INPUT && size >= 5) {
+    // ack 只往前走，比目前還新的 tick 不合理，忽略
+    uint32_t ack = get32(body);
+    if (ack > client.ackTick && ack <= currentTick) client.ackTick = ack;
+    if (client.snake >= 0) world.setInput(client.snake, body[4] & 1, (body[4] & 2) != 0, (body[4] & 4) != 0);
+  }
+}
+
+void GameServer::tick() {
+  // 先收掉斷線的 client，空出來的蛇可以馬上給新連線
+  for (Client& client : clients) readClient(client);
+  dropClosed();
+  acceptClients();
+
+  auto stepStart = std::chrono::steady_clock::now();
+  world.step(1.0f / config.tickRate);
+  for (int i = 0; i < world.getNumSnakes(); ++i) {
+    if (world.getAgent(i).state != SnakeWorld::GameState::RUNNING) world.start(i);
+  }
+  ++currentTick;
+  ++stats.ticks;
+  stats.stepMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - stepStart).count();
+
+  sendSnapshots();
+  dropClosed();
+}
+
+const QuantizedFrame* GameServer::findFrame(uint32_t tick) const {
+  if (tick == 0 || tick > currentTick || currentTick - tick >= (uint32_t)HISTORY_SIZE) return nullptr;
+  const QuantizedFrame& frame = history[tick % HISTORY_SIZE];
+  return frame.tick == tick ? &frame : nullptr;
+}
+
+void GameServer::sendSnapshots() {
+  // 新連線第一份一定是完整快照，沒有 client 時不需要留歷史
+  if (clients.empty()) return;
+  auto encodeStart = std::chrono::steady_clock::now();
+  QuantizedFrame& frame = history[currentTick % HISTORY_SIZE];
+  quantize(world, currentTick, frame);
+  baseTicks.clear();
+
+  for (Client& client : clients) {
+    flush(client);
+    if (client.outPos < client.out.size()) {
+      ++stats.snapshotsDropped;
+      continue;
+    }
+    const QuantizedFrame* base = findFrame(client.ackTick);
+    uint32_t baseTick = base ? base->tick : 0;
+    size_t slot = std::find(baseTicks.begin(), baseTicks.end(), baseTick) - baseTicks.begin();
+    if (slot == baseTicks.size()) {
+      baseTicks.push_back(baseTick);
+      if (encoded.size() < baseTicks.size()) encoded.resize(baseTicks.size());
+      encoded[slot].clear();
+      encodeDelta(base, frame, encoded[slot]);
+      ++stats.encodes;
+    }
+
+    size_t start = beginMessage(client.out, SNAPSHOT);
+    put32(client.out, currentTick);
+    put32(client.out, baseTick);
+    client.out.insert(client.out.end(), encoded[slot].begin(), encoded[slot].end());
+    endMessage(client.out, start);
+    ++stats.snapshotsSent;
+    if (baseTick == 0) ++stats.fullSnapshots;
+    flush(client);
+  }
+  stats.encodeMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - encodeStart).count();
+}
+
+void GameServer::flush(Client& client) {
+  while (client.outPos < client.out.size()) {
+    long n = sendSome(client.fd, &client.out[client.outPos], client.out.size() - client.outPos);
+    if (n < 0) {
+      client.closed = true;
+      return;
+    }
+    if (n == 0) return;
+    client.outPos += n;
+    stats.bytesSent += n;
+  }
+  client.out.clear();
+  client.outPos = 0;
+}
+
+void GameServer::dropClosed() {
+  for (Client& client : clients) {
+    if (!client.closed) continue;
+    closeSocket(client.fd);
+    if (client.snake >= 0) {
+      taken[client.snake] = false;
+      world.setAutopilot(client.snake, true);
+    }
+  }
+  clients.erase(std::remove_if(clients.begin(), clients.end(), [](const Client& c) { return c.closed; }),
+                clients.end());
+}
+
+// ========== 用戶端 ==========
+
+GameClient::~GameClient() { closeSocket(fd); }
+
+bool GameClient::connect(const std::string& socketPath) {
+#ifndef _WIN32
+  sockaddr_un address;
+  if (!fillAddress(socketPath, address)) return false;
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+    std::cout << "[ERROR] Cannot connect to " << socketPath << ": " << std::strerror(errno) << std::endl;
+    closeSocket(fd);
+    fd = -1;
+    return false;
+  }
+  setNonBlocking(fd);
+  out.clear();
+  outPos = 0;
+  size_t start = beginMessage(out, HELLO);
+  put32(out, PROTOCOL_VERSION);
+  endMessage(out, start);
+  if (!flush()) {
+    std::cout << "[ERROR] Cannot send to " << socketPath << ": " << std::strerror(errno) << std::endl;
+    return false;
+  }
+  return true;
+#else
+  (void)socketPath;
+  std::cout << "[ERROR] The multiplayer client needs UNIX domain sockets" << std::endl;
+  return false;
+#endif
+}
+
+bool GameClient::poll() {
+  if (fd < 0) return false;
+  bool open = receiveAll(fd, in, stats.bytesReceived) && flush();
+  bool ok = consumeMessages(in, [this](uint8_t type, const uint8_t* body, size_t size) {
+    handleMessage(type, body, size);
+  });
+  return open && ok;
+}
+
+void GameClient::handleMessage(uint8_t type, const uint8_t* body, size_t size) {
+  if (type == WELCOME && size >= 24) {
+    snakeIndex = (int32_t)get32(body + 4);
+    tickRate = getFloat(body + 8);
+    appleHeight = getFloat(body + 20);
+    welcomed = true;
+  } else if (type == SNAPSHOT && size >= 8) {
+    auto decodeStart = std::chrono::steady_clock::now();
+    uint32_t tick = get32(body), baseTick = get32(body + 4);
+    const QuantizedFrame* base = nullptr;
+    if (baseTick != 0) {
+      const QuantizedFrame& candidate = history[baseTick % HISTORY_SIZE];
+      if (candidate.tick != baseTick) {
+        ++stats.undecodable;
+        return;
+      }
+      base = &candidate;
+    }
+    // 基準可能就在同一個格子（差了 HISTORY_SIZE），先解到暫存再搬進去
+    QuantizedFrame decoded;
+    if (tick <= latestTick || !decodeDelta(base, body + 8, size - 8, decoded)) {
+      ++stats.undecodable;
+      return;
+    }
+    decoded.tick = tick;
+    history[tick % HISTORY_SIZE] = std::move(decoded);
+    latestTick = tick;
+    dequantize(history[tick % HISTORY_SIZE], appleHeight, views);
+    ++stats.snapshots;
+    if (baseTick == 0) ++stats.fullSnapshots;
+    stats.decodeMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - decodeStart).count();
+  }
+}
+
+void GameClient::sendInput(bool forward, bool left, bool right) {
+  // 伺服器塞住、上一個訊息還沒送完時整個丟掉這一個，下一次會帶新的 ack；
+  // 送出一半的訊息一定要送完，否則伺服器之後讀到的長度就錯了
+  if (fd < 0 || !flush() || outPos < out.size()) return;
+  size_t start = beginMessage(out, INPUT);
+  put32(out, latestTick);
+  out.push_back((uint8_t)((forward ? 1 : 0) | (left ? 2 : 0) | (right ? 4 : 0)));
+  endMessage(out, start);
+  flush();
+}
+
+bool GameClient::flush() {
+  while (outPos < out.size()) {
+    long n = sendSome(fd, &out[outPos], out.size() - outPos);
+    if (n < 0) return false;
+    if (n == 0) return true;
+    outPos += n;
+  }
+  out.clear();
+  outPos = 0;
+  return true;
+}
+
+}  // namespace net
@@ -0,0 +1,147 @@
+#include "NetSnapshot.h"
+#include <algorithm>
+#include <cmath>
+
+namespace net {
+
+namespace {
+
+const int HEADER_FIELDS = 6;
+const int MAX_FIELDS = HEADER_FIELDS + 3 * 4096;
+
+int16_t quantizeLength(float value) {
+  float q = std::round(value / POSITION_QUANTUM);
+  return (int16_t)std::clamp(q, -32767.0f, 32767.0f);
+}
+
+void writeVarint(uint32_t value, std::vector<uint8_t>& out) {
+  while (value >= 0x80) {
+    out.push_back((uint8_t)(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back((uint8_t)value);
+}
+
+bool readVarint(const uint8_t* data, size_t size, size_t& pos, uint32_t& value) {
+  value = 0;
+  for (int shift = 0; shift < 35; shift += 7) {
+    if (pos >= size) return false;
+    uint8_t byte = data[pos++];
+    value |= (uint32_t)(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) return true;
+  }
+  return false;
+}
+
+uint32_t zigzag(int32_t value) { return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31); }
+int32_t unzigzag(uint32_t value) { return (int32_t)(value >> 1) ^ -(int32_t)(value & 1); }
+
+}  // namespace
+
+// ========== 量化 ==========
+
+void quantize(const SnakeWorld& world, uint32_t tick, QuantizedFrame& out) {
+  out.tick = tick;
+  out.snakes.resize(world.getNumSnakes());
+  for (int i = 0; i < world.getNumSnakes(); ++i) {
+    const SnakeWorld::Agent& agent = world.getAgent(i);
+    const std::vector<Mass*>& masses = agent.snake->getMasses();
+    const int count = std::min((int)masses.size(), (MAX_FIELDS - HEADER_FIELDS) / 3);
+    std::vector<int16_t>& fields = out.snakes[i];
+    fields.resize(HEADER_FIELDS + 3 * count);
+    fields[0] = (int16_t)((int)agent.state | (int)agent.result << 2 | (agent.hitWall ? 1 << 4 : 0));
+    fields[1] = (int16_t)std::min(agent.score, 32767);
+    fields[2] = (int16_t)std::clamp((int)std::round(agent.timer * 100.0f), 0, 32767);
+    fields[3] = quantizeLength(agent.applePosition.x);
+    fields[4] = quantizeLength(agent.applePosition.z);
+    fields[5] = (int16_t)count;
+    for (int m = 0; m < count; ++m) {
+      glm::vec3 p = masses[m]->getPosition();
+      fields[HEADER_FIELDS + 3 * m] = quantizeLength(p.x);
+      fields[HEADER_FIELDS + 3 * m + 1] = quantizeLength(p.y);
+      fields[HEADER_FIELDS + 3 * m + 2] = quantizeLength(p.z);
+    }
+  }
+}
+
+void dequantize(const QuantizedFrame& frame, float appleHeight, std::vector<SnakeView>& out) {
+  out.resize(frame.snakes.size());
+  for (size_t i = 0; i < frame.snakes.size(); ++i) {
+    const std::vector<int16_t>& fields = frame.snakes[i];
+    SnakeView& view = out[i];
+    if (fields.size() < (size_t)HEADER_FIELDS) {
+      view = SnakeView();
+      continue;
+    }
+    view.state = (SnakeWorld::GameState)(fields[0] & 3);
+    view.result = (SnakeWorld::GameResult)(fields[0] >> 2 & 3);
+    view.hitWall = (fields[0] >> 4 & 1) != 0;
+    view.score = fields[1];
+    view.timer = fields[2] / 100.0f;
+    view.applePosition = glm::vec3(fields[3] * POSITION_QUANTUM, appleHeight, fields[4] * POSITION_QUANTUM);
+    int count = std::min((int)fields[5], (int)(fields.size() - HEADER_FIELDS) / 3);
+    view.masses.resize(std::max(0, count));
+    for (int m = 0; m < count; ++m) {
+      const int16_t* p = &fields[HEADER_FIELDS + 3 * m];
+      view.masses[m] = glm::vec3(p[0], p[1], p[2]) * POSITION_QUANTUM;
+    }
+  }
+}
+
+// ========== 差分編碼 ==========
+
+void encodeDelta(const QuantizedFrame* base, const QuantizedFrame& frame, std::vector<uint8_t>& out) {
+  writeVarint((uint32_t)frame.snakes.size(), out);
+  for (size_t i = 0; i < frame.snakes.size(); ++i) {
+    const std::vector<int16_t>& fields = frame.snakes[i];
+    const std::vector<int16_t>* reference = nullptr;
+    if (base && i < base->snakes.size() && base->snakes[i].size() == fields.size()) reference = &base->snakes[i];
+
+    writeVarint((uint32_t)fields.size(), out);
+    uint32_t zeros = 0;
+    for (size_t f = 0; f < fields.size(); ++f) {
+      int32_t diff = (int32_t)fields[f] - (reference ? (int32_t)(*reference)[f] : 0);
+      if (diff == 0) {
+        ++zeros;
+        continue;
+      }
+      if (zeros > 0) writeVarint(zeros << 1, out);
+      zeros = 0;
+      writeVarint(zigzag(diff) << 1 | 1, out);
+    }
+    if (zeros > 0) writeVarint(zeros << 1, out);
+  }
+}
+
+bool decodeDelta(const QuantizedFrame* base, const uint8_t* data, size_t size, QuantizedFrame& out) {
+  size_t pos = 0;
+  uint32_t numSnakes = 0;
+  if (!readVarint(data, size, pos, numSnakes) || numSnakes > size) return false;
+  out.snakes.resize(numSnakes);
+  for (uint32_t i = 0; i < numSnakes; ++i) {
+    uint32_t numFields = 0;
+    if (!readVarint(data, size, pos, numFields) || numFields > (uint32_t)MAX_FIELDS) return false;
+    const std::vector<int16_t>* reference = nullptr;
+    if (base && i < base->snakes.size() && base->snakes[i].size() == numFields) reference = &base->snakes[i];
+
+    std::vector<int16_t>& fields = out.snakes[i];
+    fields.resize(numFields);
+    uint32_t f = 0;
+    while (f < numFields) {
+      uint32_t token = 0;
+      if (!readVarint(data, size, pos, token)) return false;
+      if (token & 1) {
+        int32_t value = unzigzag(token >> 1) + (reference ? (int32_t)(*reference)[f] : 0);
+        if (value < -32768 || value > 32767) return false;
+        fields[f++] = (int16_t)value;
+      } else {
+        uint32_t zeros = token >> 1;
+        if (zeros == 0 || zeros > numFields - f) return false;
+        for (uint32_t end = f + zeros; f < end; ++f) fields[f] = reference ? (*reference)[f] : 0;
+      }
+    }
+  }
+  return pos == size;
+}
+
+}  // namespace net
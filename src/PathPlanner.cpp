@@ -0,0 +1,292 @@
+#include "PathPlanner.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "Snake.h"
+
+namespace {
+
+const float INF = std::numeric_limits<float>::infinity();
+const float SQRT2 = 1.41421356f;
+
+}  // namespace
+
+// 前四個是上下左右，後四個是斜的
+const int PathPlanner::OFFSET_X[8] = {1, -1, 0, 0, 1, 1, -1, -1};
+const int PathPlanner::OFFSET_Z[8] = {0, 0, 1, -1, 1, -1, 1, -1};
+
+PathPlanner::PathPlanner(const Config& config, float arenaWidth, float arenaDepth, float wallMargin)
+    : config(config) {
+  width = std::max(1, (int)std::ceil(arenaWidth / config.cellSize));
+  depth = std::max(1, (int)std::ceil(arenaDepth / config.cellSize));
+  const size_t numCells = (size_t)width * depth;
+  wall.assign(numCells, 0);
+  body.assign(numCells, 0);
+  bodyStamp.assign(numCells, 0);
+  g.assign(numCells, INF);
+  rhs.assign(numCells, INF);
+  stamp.assign(numCells, 0);
+
+  float reach = wallMargin + config.clearance;
+  for (int cz = 0; cz < depth; ++cz) {
+    for (int cx = 0; cx < width; ++cx) {
+      glm::vec3 c = centerOf(cx + cz * width, 0.0f);
+      float distance = std::min(std::min(c.x, arenaWidth - c.x), std::min(c.z, arenaDepth - c.z));
+      wall[cx + cz * width] = distance < reach;
+    }
+  }
+}
+
+// ========== 格子 ==========
+
+int PathPlanner::cellOf(float x, float z) const {
+  int cx = std::clamp((int)std::floor(x / config.cellSize), 0, width - 1);
+  int cz = std::clamp((int)std::floor(z / config.cellSize), 0, depth - 1);
+  return cx + cz * width;
+}
+
+glm::vec3 PathPlanner::centerOf(int cell, float y) const {
+  return glm::vec3((cell % width + 0.5f) * config.cellSize, y, (cell / width + 0.5f) * config.cellSize);
+}
+
+// 8 連通的 octile 距離
+float PathPlanner::heuristic(int a, int b) const {
+  int dx = std::abs(a % width - b % width);
+  int dz = std::abs(a / width - b / width);
+  return (std::max(dx, dz) + (SQRT2 - 1.0f) * std::min(dx, dz)) * config.cellSize;
+}
+
+int PathPlanner::neighbor(int cell, int k) const {
+  int cx = cell % width + OFFSET_X[k];
+  int cz = cell / width + OFFSET_Z[k];
+  if (cx < 0 || cx >= width || cz < 0 || cz >= depth) return -1;
+  return cx + cz * width;
+}
+
+float PathPlanner::cost(int from, int k) const {
+  int to = neighbor(from, k);
+  if (to < 0 || !isFree(from) || !isFree(to)) return INF;
+  if (k < 4) return config.cellSize;
+  // 斜走時兩個相鄰的直格都要是空的，不能切過角
+  if (!isFree(from + OFFSET_X[k]) || !isFree(from + OFFSET_Z[k] * width)) return INF;
+  return SQRT2 * config.cellSize;
+}
+
+// ========== D* Lite ==========
+
+// 堆積頂端是最小的 key
+bool PathPlanner::greater(const Entry& a, const Entry& b) { return b.key < a.key; }
+
+void PathPlanner::touch(int cell) {
+  if (stamp[cell] == search) return;
+  stamp[cell] = search;
+  g[cell] = INF;
+  rhs[cell] = INF;
+}
+
+PathPlanner::Key PathPlanner::calculateKey(int cell) const {
+  float m = std::min(gOf(cell), rhsOf(cell));
+  return {m + heuristic(start, cell) + km, m};
+}
+
+void PathPlanner::push(int cell) {
+  heap.push_back({calculateKey(cell), cell});
+  std::push_heap(heap.begin(), heap.end(), greater);
+}
+
+void PathPlanner::updateVertex(int cell) {
+  if (cell != goal) {
+    float best = INF;
+    for (int k = 0; k < 8; ++k) {
+      float c = cost(cell, k);
+      if (c < INF) best = std::min(best, c + gOf(neighbor(cell, k)));
+    }
+    touch(cell);
+    rhs[cell] = best;
+  }
+  if (gOf(cell) != rhsOf(cell)) push(cell);
+}
+
+// 一個格子的狀態變了，它和鄰居之間的邊（以及鄰居之間繞過它的斜邊）都會變
+void PathPlanner::updateAround(int cell) {
+  updateVertex(cell);
+  for (int k = 0; k < 8; ++k) {
+    int s = neighbor(cell, k);
+    if (s >= 0) updateVertex(s);
+  }
+}
+
+void PathPlanner::rebuildHeap() {
+  heap.clear();
+  for (int cell = 0; cell < (int)g.size(); ++cell) {
+    if (gOf(cell) != rhsOf(cell)) heap.push_back({calculateKey(cell), cell});
+  }
+  std::make_heap(heap.begin(), heap.end(), greater);
+  heapStale = false;
+}
+
+// 下一步假設和上一步一樣久；每一步的時間差很多，之後還要沿路徑找路點，所以留四步的時間
+bool PathPlanner::outOfTime(std::chrono::steady_clock::time_point began,
+                            std::chrono::steady_clock::time_point& last) const {
+  if (config.budgetMicros <= 0.0f) return false;
+  auto now = std::chrono::steady_clock::now();
+  auto step = now - last;
+  last = now;
+  return now - began + 4 * step > std::chrono::duration<double, std::micro>(config.budgetMicros);
+}
+
+bool PathPlanner::computeShortestPath(std::chrono::steady_clock::time_point began) {
+  if (heapStale) rebuildHeap();
+  auto last = std::chrono::steady_clock::now();
+
+  // 上一次沒做完的和這一次新的佔用變化
+  while (!changed.empty()) {
+    if (outOfTime(began, last)) return false;
+    int cell = changed.back();
+    changed.pop_back();
+    updateAround(cell);
+  }
+
+  int expansions = 0;
+  while (true) {
+    // 已經一致的格子不在佇列裡，它們的舊項目直接丟掉
+    while (!heap.empty() && gOf(heap.front().cell) == rhsOf(heap.front().cell)) {
+      std::pop_heap(heap.begin(), heap.end(), greater);
+      heap.pop_back();
+    }
+    if (heap.empty() || !(heap.front().key < calculateKey(start) || rhsOf(start) > gOf(start))) break;
+    if (config.maxExpansions > 0 && expansions >= config.maxExpansions) return false;
+    if (outOfTime(began, last)) return false;
+
+    Entry top = heap.front();
+    std::pop_heap(heap.begin(), heap.end(), greater);
+    heap.pop_back();
+    int u = top.cell;
+    Key keyNew = calculateKey(u);
+    ++expansions;
+    ++stats.expansions;
+    if (top.key < keyNew) {
+      push(u);
+    } else if (gOf(u) > rhsOf(u)) {
+      g[u] = rhs[u];
+      for (int k = 0; k < 8; ++k) {
+        int s = neighbor(u, k);
+        if (s >= 0) updateVertex(s);
+      }
+    } else {
+      g[u] = INF;
+      updateAround(u);
+    }
+  }
+
+  // 過時的項目太多時，下一次 plan 預算還沒開始用的時候重建佇列
+  heapStale = heap.size() > 4 * g.size();
+  return true;
+}
+
+// ========== 規劃 ==========
+
+void PathPlanner::reset() {
+  goal = -1;
+  start = -1;
+}
+
+// 把這一次的蛇身格子和上一次比較，有變的加進 changed。
+// 終點和它的 8 個鄰居不擋：蘋果常常落在尾巴旁邊，擋住的話整條路都找不到
+void PathPlanner::markBody(const Snake& snake, int goalCell) {
+  ++tick;
+  const std::vector<Mass*>& masses = snake.getMasses();
+  const float radius = snake.getRadius();
+  std::vector<int>& cells = markedCells;
+  cells.clear();
+  for (size_t m = (size_t)std::max(0, config.skipSegments); m < masses.size(); ++m) {
+    glm::vec3 p = masses[m]->getPosition();
+    int lo = cellOf(p.x - radius, p.z - radius), hi = cellOf(p.x + radius, p.z + radius);
+    for (int cz = lo / width; cz <= hi / width; ++cz) {
+      for (int cx = lo % width; cx <= hi % width; ++cx) {
+        int cell = cx + cz * width;
+        glm::vec3 c = centerOf(cell, p.y);
+        if (bodyStamp[cell] == tick || glm::length(glm::vec2(c.x - p.x, c.z - p.z)) > radius) continue;
+        if (std::abs(cx - goalCell % width) <= 1 && std::abs(cz - goalCell / width) <= 1) continue;
+        bodyStamp[cell] = tick;
+        cells.push_back(cell);
+      }
+    }
+  }
+
+  for (int cell : bodyCells) {
+    if (bodyStamp[cell] != tick) {
+      body[cell] = 0;
+      changed.push_back(cell);
+    }
+  }
+  for (int cell : cells) {
+    if (!body[cell]) {
+      body[cell] = 1;
+      changed.push_back(cell);
+    }
+  }
+  bodyCells.swap(cells);
+}
+
+bool PathPlanner::plan(const Snake& snake, const glm::vec3& goalPosition, glm::vec3& waypoint) {
+  auto began = std::chrono::steady_clock::now();
+  glm::vec3 head = snake.getHeadPosition();
+  int newGoal = cellOf(goalPosition.x, goalPosition.z);
+  int newStart = cellOf(head.x, head.z);
+  markBody(snake, newGoal);
+
+  if (newGoal != goal || start < 0) {
+    // 終點變了：整個重來
+    goal = newGoal;
+    start = newStart;
+    km = 0.0f;
+    ++search;
+    heap.clear();
+    heapStale = false;
+    changed.clear();
+    touch(goal);
+    rhs[goal] = 0.0f;
+    push(goal);
+    ++stats.searches;
+  } else {
+    if (newStart != start) {
+      // 起點換格：舊起點回到原本的佔用狀態，新起點強制是空的
+      km += heuristic(start, newStart);
+      int oldStart = start;
+      start = newStart;
+      changed.push_back(oldStart);
+      changed.push_back(newStart);
+    }
+  }
+
+  bool complete = computeShortestPath(began);
+  if (!complete) ++stats.incomplete;
+
+  // 沿著 c + g 最小的鄰居往下走 lookaheadCells 格；搜尋停下時起點本身可能還沒展開（g 是無限大），看 rhs
+  bool found = rhsOf(start) < INF;
+  int cell = start;
+  for (int step = 0; found && step < std::max(1, config.lookaheadCells) && cell != goal; ++step) {
+    int next = -1;
+    float best = INF;
+    for (int k = 0; k < 8; ++k) {
+      float c = cost(cell, k);
+      if (c < INF && c + gOf(neighbor(cell, k)) < best) {
+        best = c + gOf(neighbor(cell, k));
+        next = neighbor(cell, k);
+      }
+    }
+    if (next < 0) break;
+    cell = next;
+  }
+  if (found) waypoint = cell == goal ? goalPosition : centerOf(cell, goalPosition.y);
+  if (!found) ++stats.noPath;
+
+  double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - began).count();
+  ++stats.plans;
+  if (config.budgetMicros > 0.0f && micros > config.budgetMicros) ++stats.overBudget;
+  stats.totalMicros += micros;
+  stats.maxMicros = std::max(stats.maxMicros, micros);
+  return found;
+}
@@ -0,0 +1,394 @@
+#include "PhysicsBench.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <memory>
+#include <random>
+
+#include "Mass.h"
+#include "Snake.h"
+#include "SnakeWorld.h"
+#include "Spring.h"
+
+namespace bench {
+
+namespace {
+
+struct ChainRun {
+  std::vector<glm::dvec3> positions;
+  double initialEnergy = 0.0;
+  double finalEnergy = 0.0;
+  double seconds = 0.0;
+};
+
+template <typename T, typename Acc>
+double chainEnergy(const std::vector<BasicMass<T, Acc>>& masses, const ChainScenario& s) {
+  double energy = 0.0;
+  for (const auto& m : masses) {
+    glm::dvec3 v(m.getVelocity());
+    energy += 0.5 * (double)m.getMass() * glm::dot(v, v);
+  }
+  for (size_t i = 0; i + 1 < masses.size(); ++i) {
+    double stretch = glm::length(glm::dvec3(masses[i].getPosition()) - glm::dvec3(masses[i + 1].getPosition())) -
+                     (double)s.restLength;
+    energy += 0.5 * (double)s.springK * stretch * stretch;
+  }
+  return energy;
+}
+
+template <typename T, typename Acc>
+ChainRun runChain(const ChainScenario& s) {
+  using Vec3 = glm::vec<3, T>;
+  std::vector<BasicMass<T, Acc>> masses;
+  masses.reserve(s.numMasses);
+  for (int i = 0; i < s.numMasses; ++i) {
+    // 初始位置先用 double 算好再轉型，三種精度的起點相同
+    double x = s.offset + i * (double)s.restLength + 0.2 * s.restLength * std::sin(i * 0.7);
+    masses.emplace_back(T(s.mass), Vec3(glm::dvec3(x, 0.0, 0.0)));
+  }
+  std::vector<BasicSpring<T, Acc>> springs;
+  springs.reserve(s.numMasses);
+  for (int i = 0; i + 1 < s.numMasses; ++i) {
+    springs.emplace_back(&masses[i], &masses[i + 1], T(s.springK), T(s.restLength), T(s.damping));
+  }
+
+  ChainRun run;
+  run.initialEnergy = chainEnergy(masses, s);
+
+  auto start = std::chrono::steady_clock::now();
+  for (int step = 0; step < s.steps; ++step) {
+    for (auto& m : masses) m.resetForce();
+    for (auto& spring : springs) spring.applyForce();
+    for (auto& m : masses) m.update(T(s.dt));
+  }
+  run.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  run.finalEnergy = chainEnergy(masses, s);
+  for (const auto& m : masses) run.positions.push_back(glm::dvec3(m.getPosition()));
+  return run;
+}
+
+PrecisionResult summarize(const std::string& name, const ChainRun& run, const ChainRun& reference,
+                          const ChainScenario& s) {
+  PrecisionResult r;
+  r.name = name;
+  r.nsPerMassStep = run.seconds * 1e9 / ((double)s.steps * s.numMasses);
+  double sum = 0.0;
+  for (size_t i = 0; i < run.positions.size(); ++i) {
+    glm::dvec3 d = run.positions[i] - reference.positions[i];
+    sum += glm::dot(d, d);
+  }
+  r.rmsPositionError = std::sqrt(sum / run.positions.size());
+  r.energyDrift = run.initialEnergy > 0.0 ? std::abs(run.finalEnergy - run.initialEnergy) / run.initialEnergy : 0.0;
+  return r;
+}
+
+struct SnakeRun {
+  glm::vec3 head;
+  double seconds = 0.0;
+};
+
+SnakeRun runSnake(const IntegratorScenario& s, Snake::SpringIntegrator integrator, float dt) {
+  // 與遊戲相同的蛇參數
+  Snake snake(s.numSegments, 0.02f, 0.178f, 1.0f, 3.5f, glm::vec3(4.0f, 0.5f, 2.5f), 0.2f);
+  snake.setSpringIntegrator(integrator);
+  snake.setSnakeMoveDirection(0, true);
+
+  int steps = (int)std::lround(s.simSeconds / dt);
+  SnakeRun run;
+  auto start = std::chrono::steady_clock::now();
+  for (int step = 0; step < steps; ++step) snake.update(dt);
+  run.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  run.head = snake.getHeadPosition();
+  return run;
+}
+
+IntegratorResult summarize(const std::string& name, float dt, const SnakeRun& run, const SnakeRun& reference,
+                           const IntegratorScenario& s) {
+  IntegratorResult r;
+  r.name = name;
+  r.dt = dt;
+  r.msPerSimSecond = run.seconds * 1e3 / s.simSeconds;
+  r.headError = glm::length(run.head - reference.head);
+  r.stable = !std::isnan(r.headError) && r.headError < 10.0;
+  return r;
+}
+
+struct LodRun {
+  glm::vec3 start;
+  glm::vec3 head;
+  double seconds = 0.0;
+  int steps = 0;
+};
+
+LodRun runLod(const LodScenario& s, Snake::PhysicsLod lod) {
+  Snake snake(s.numSegments, 0.02f, 0.178f, 1.0f, 3.5f, glm::vec3(4.0f, 0.5f, 2.5f), 0.2f);
+  snake.setLod(lod);
+  snake.setSnakeMoveDirection(0, true);
+
+  LodRun run;
+  run.start = snake.getHeadPosition();
+  run.steps = (int)std::lround(s.simSeconds / s.dt);
+  auto start = std::chrono::steady_clock::now();
+  for (int step = 0; step < run.steps; ++step) snake.update(s.dt);
+  run.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  run.head = snake.getHeadPosition();
+  return run;
+}
+
+LodResult summarize(const std::string& name, const LodRun& run, const LodRun& full) {
+  glm::vec3 moved = run.head - run.start;
+  glm::vec3 error = run.head - full.head;
+  moved.y = error.y = 0.0f;
+  LodResult r;
+  r.name = name;
+  r.usPerStep = run.seconds * 1e6 / std::max(1, run.steps);
+  r.travelled = glm::length(moved);
+  r.headError = glm::length(error);
+  return r;
+}
+
+}  // namespace
+
+std::vector<PrecisionResult> runPrecisionComparison(const ChainScenario& scenario) {
+  ChainRun reference = runChain<double, double>(scenario);
+  ChainRun single = runChain<float, float>(scenario);
+  ChainRun mixed = runChain<float, double>(scenario);
+
+  return {summarize("float", single, reference, scenario), summarize("mixed", mixed, reference, scenario),
+          summarize("double", reference, reference, scenario)};
+}
+
+void printPrecisionReport(std::ostream& out, const ChainScenario& scenario,
+                          const std::vector<PrecisionResult>& results) {
+  out << "[BENCH] chain of " << scenario.numMasses << " masses, " << scenario.steps << " steps of " << scenario.dt
+      << " s, k = " << scenario.springK << ", offset = " << scenario.offset << " m" << std::endl;
+  out << std::left << std::setw(8) << "mode" << std::setw(16) << "ns/mass-step" << std::setw(20) << "rms error (m)"
+      << "energy drift" << std::endl;
+  for (const auto& r : results) {
+    out << std::left << std::setw(8) << r.name << std::setw(16) << std::setprecision(4) << r.nsPerMassStep
+        << std::setw(20) << std::setprecision(4) << r.rmsPositionError << std::setprecision(4) << r.energyDrift
+        << std::endl;
+  }
+}
+
+std::vector<IntegratorResult> runIntegratorComparison(const IntegratorScenario& scenario) {
+  SnakeRun reference = runSnake(scenario, Snake::SpringIntegrator::EXPLICIT, scenario.referenceDt);
+
+  std::vector<IntegratorResult> results;
+  const float explicitDt = 0.002f;  // 遊戲原本用的步長
+  results.push_back(summarize("explicit", explicitDt, runSnake(scenario, Snake::SpringIntegrator::EXPLICIT, explicitDt),
+                              reference, scenario));
+  for (float dt : scenario.analyticDts) {
+    results.push_back(
+        summarize("analytic", dt, runSnake(scenario, Snake::SpringIntegrator::ANALYTIC, dt), reference, scenario));
+  }
+  return results;
+}
+
+void printIntegratorReport(std::ostream& out, const IntegratorScenario& scenario,
+                           const std::vector<IntegratorResult>& results) {
+  out << "[BENCH] snake of " << scenario.numSegments << " segments crawling for " << scenario.simSeconds
+      << " s, reference = explicit @ " << scenario.referenceDt << " s" << std::endl;
+  out << std::left << std::setw(10) << "mode" << std::setw(10) << "dt (s)" << std::setw(16) << "ms/sim-second"
+      << "head error (m)" << std::endl;
+  for (const auto& r : results) {
+    out << std::left << std::setw(10) << r.name << std::setw(10) << r.dt << std::setw(16) << std::setprecision(4)
+        << r.msPerSimSecond;
+    if (r.stable) {
+      out << std::setprecision(4) << r.headError << std::endl;
+    } else {
+      out << "unstable" << std::endl;
+    }
+  }
+}
+
+std::vector<LodResult> runLodComparison(const LodScenario& scenario) {
+  LodRun full = runLod(scenario, Snake::PhysicsLod::FULL);
+  LodRun kinematic = runLod(scenario, Snake::PhysicsLod::KINEMATIC);
+  return {summarize("full", full, full), summarize("kinematic", kinematic, full)};
+}
+
+void printLodReport(std::ostream& out, const LodScenario& scenario, const std::vector<LodResult>& results) {
+  out << "[BENCH] snake of " << scenario.numSegments << " segments crawling for " << scenario.simSeconds
+      << " s at dt = " << scenario.dt << " s" << std::endl;
+  out << std::left << std::setw(12) << "lod" << std::setw(12) << "us/step" << std::setw(16) << "travelled (m)"
+      << "head vs full (m)" << std::endl;
+  for (const auto& r : results) {
+    out << std::left << std::setw(12) << r.name << std::setw(12) << std::setprecision(3) << r.usPerStep
+        << std::setw(16) << std::setprecision(4) << r.travelled << std::setprecision(4) << r.headError << std::endl;
+  }
+}
+
+bool checkLodSwitching(std::ostream& out) {
+  SnakeWorld::Rules rules;
+  SnakeWorld world(rules);
+  // 蛇頭朝 +x，停在離 (0, 0) 最遠的角落附近
+  glm::vec3 head(rules.arenaWidth - 1.0f, 0.5f, rules.arenaDepth - 1.0f);
+  world.addSnake(SnakeWorld::SnakeParams(), head, 0);
+  world.start(0);
+  const Snake* snake = world.getSnake(0);
+  const float dt = 1.0f / 60.0f;
+
+  bool ok = true;
+  auto check = [&](const char* name, Snake::PhysicsLod expected) {
+    bool pass = snake->getLod() == expected;
+    out << "[CHECK] " << name << ": " << (pass ? "ok" : "FAILED") << std::endl;
+    ok = ok && pass;
+  };
+
+  world.step(dt);
+  check("no viewer -> full", Snake::PhysicsLod::FULL);
+  world.setViewer(glm::vec3(0.0f, 1.0f, 0.0f));
+  world.step(dt);
+  check("viewer at the far corner -> kinematic", Snake::PhysicsLod::KINEMATIC);
+  world.setViewer(head + glm::vec3(-1.0f, 0.5f, 0.0f));
+  world.step(dt);
+  check("viewer next to the snake -> full", Snake::PhysicsLod::FULL);
+  world.getSnake(0)->setObserved(true);
+  world.setViewer(glm::vec3(0.0f, 1.0f, 0.0f));
+  world.step(dt);
+  check("observed snake with a far viewer -> full", Snake::PhysicsLod::FULL);
+  return ok;
+}
+
+std::vector<WorldResult> runWorldScaling(const WorldScenario& scenario, int* threadsUsed) {
+  std::vector<WorldResult> results;
+  std::unique_ptr<JobSystem> ownJobs;
+  if (scenario.numThreads > 0 && scenario.numaAware) {
+    ownJobs = std::make_unique<JobSystem>(scenario.numThreads, JobSystem::Topology::detect(), true);
+  } else if (scenario.numThreads > 0) {
+    ownJobs = std::make_unique<JobSystem>(scenario.numThreads);
+  }
+  for (int count : scenario.snakeCounts) {
+    SnakeWorld world(SnakeWorld::Rules(), ownJobs.get());
+    if (threadsUsed) *threadsUsed = world.getNumThreads();
+    world.reserve(count);
+
+    SnakeWorld::SnakeParams params;
+    params.integrator = scenario.integrator;
+    for (int i = 0; i < count; ++i) {
+      world.addSnake(params, glm::vec3(4.0f, 0.5f, 2.5f), (unsigned int)i);
+    }
+    if (scenario.numaAware) world.shardByNode();
+    for (int i = 0; i < count; ++i) world.setAutopilot(i, true);
+    world.startAll();
+
+    WorldResult r;
+    r.snakes = count;
+    r.frames = (int)std::max<long long>(scenario.minFrames, scenario.snakeFrameBudget / count);
+    for (int f = 0; f < r.frames; ++f) {
+      world.step(scenario.frameDt);
+      // 撞牆或時間到的蛇重新開始，讓每一幀的工作量固定
+      for (int i = 0; i < count; ++i) {
+        if (world.getAgent(i).state != SnakeWorld::GameState::RUNNING) world.start(i);
+      }
+    }
+
+    const SnakeWorld::Stats& stats = world.getStats();
+    r.stepsPerSecond = stats.stepsPerSecond();
+    r.msPerFrame = stats.elapsedMs / r.frames;
+    r.simSecondsPerSecond = stats.elapsedMs > 0.0 ? count * (double)scenario.frameDt * r.frames * 1000.0 / stats.elapsedMs : 0.0;
+    r.nodes = stats.nodes;
+    for (int n = 0; n < (int)stats.nodes.size(); ++n) r.nodeStepsPerSecond.push_back(stats.nodeStepsPerSecond(n));
+    results.push_back(r);
+  }
+  return results;
+}
+
+void printWorldReport(std::ostream& out, const WorldScenario& scenario, int threadsUsed,
+                      const std::vector<WorldResult>& results) {
+  out << "[BENCH] SnakeWorld with " << threadsUsed << " thread(s), frame dt = " << scenario.frameDt << " s"
+      << std::endl;
+  out << std::left << std::setw(10) << "snakes" << std::setw(10) << "frames" << std::setw(16) << "steps/s"
+      << std::setw(14) << "ms/frame"
+      << "sim-s/s" << std::endl;
+  for (const auto& r : results) {
+    out << std::left << std::setw(10) << r.snakes << std::setw(10) << r.frames << std::setw(16) << std::setprecision(4)
+        << r.stepsPerSecond << std::setw(14) << std::setprecision(4) << r.msPerFrame << std::setprecision(4)
+        << r.simSecondsPerSecond << std::endl;
+    for (size_t n = 0; n < r.nodes.size(); ++n) {
+      const SnakeWorld::NodeStats& node = r.nodes[n];
+      double remote = node.snakeSteps > 0 ? 100.0 * node.remoteSteps / node.snakeSteps : 0.0;
+      out << "    node " << n << ": " << node.snakes << " snakes, " << std::setprecision(4) << r.nodeStepsPerSecond[n]
+          << " steps/s, " << std::setprecision(3) << remote << "% stolen by other nodes" << std::endl;
+    }
+  }
+}
+
+namespace {
+
+// 重複呼叫 run 直到超過 seconds，回傳每次的平均秒數
+template <typename Function>
+double timeRepeated(double seconds, Function run) {
+  run();  // 暖身：thread_local 暫存在第一次配置
+  int repeats = 0;
+  auto start = std::chrono::steady_clock::now();
+  double elapsed = 0.0;
+  do {
+    run();
+    ++repeats;
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  } while (elapsed < seconds);
+  return elapsed / repeats;
+}
+
+}  // namespace
+
+std::vector<InferenceResult> runInferenceBenchmark(const InferenceScenario& scenario, int* threadsUsed) {
+  std::unique_ptr<JobSystem> ownJobs;
+  if (scenario.numThreads > 0) ownJobs = std::make_unique<JobSystem>(scenario.numThreads);
+  JobSystem& jobs = ownJobs ? *ownJobs : JobSystem::shared();
+  if (threadsUsed) *threadsUsed = jobs.getNumThreads();
+
+  MlpPolicy policy =
+      MlpPolicy::createRandom(scenario.layerSizes, MlpPolicy::Activation::TANH, MlpPolicy::Activation::LINEAR, 1);
+  std::vector<InferenceResult> results;
+  std::mt19937 rng(2);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  for (int batch : scenario.batchSizes) {
+    std::vector<float> input((size_t)batch * policy.getInputSize());
+    for (float& x : input) x = dist(rng);
+    std::vector<float> output((size_t)batch * policy.getOutputSize());
+    std::vector<float> reference(output.size());
+
+    InferenceResult r;
+    r.batch = batch;
+    double seconds =
+        timeRepeated(scenario.secondsPerBatchSize, [&] { policy.forward(input.data(), batch, output.data()); });
+    r.usPerBatch = seconds * 1e6;
+    r.samplesPerSecond = batch / seconds;
+    r.gflops = r.samplesPerSecond * policy.getFlopsPerSample() * 1e-9;
+
+    double referenceSeconds = timeRepeated(scenario.secondsPerBatchSize,
+                                           [&] { policy.forwardReference(input.data(), batch, reference.data()); });
+    r.referenceSamplesPerSecond = batch / referenceSeconds;
+    for (size_t i = 0; i < output.size(); ++i) {
+      r.maxError = std::max(r.maxError, (double)std::abs(output[i] - reference[i]));
+    }
+
+    double parallelSeconds = timeRepeated(scenario.secondsPerBatchSize,
+                                          [&] { policy.forward(input.data(), batch, output.data(), jobs); });
+    r.parallelSamplesPerSecond = batch / parallelSeconds;
+    results.push_back(r);
+  }
+  return results;
+}
+
+void printInferenceReport(std::ostream& out, const InferenceScenario& scenario, int threadsUsed,
+                          const std::vector<InferenceResult>& results) {
+  out << "[BENCH] MLP inference, layers";
+  for (int size : scenario.layerSizes) out << " " << size;
+  out << ", " << threadsUsed << " thread(s) for the parallel column" << std::endl;
+  out << std::left << std::setw(8) << "batch" << std::setw(14) << "us/batch" << std::setw(16) << "samples/s/core"
+      << std::setw(10) << "GFLOP/s" << std::setw(16) << "reference/s" << std::setw(16) << "parallel/s"
+      << "max error" << std::endl;
+  for (const auto& r : results) {
+    out << std::left << std::setprecision(4) << std::setw(8) << r.batch << std::setw(14) << r.usPerBatch
+        << std::setw(16) << r.samplesPerSecond << std::setw(10) << r.gflops << std::setw(16)
+        << r.referenceSamplesPerSecond << std::setw(16) << r.parallelSamplesPerSecond << r.maxError << std::endl;
+  }
+}
+
+}  // namespace bench
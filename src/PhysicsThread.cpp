@@ -0,0 +1,158 @@
+#include "PhysicsThread.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+PhysicsThread::PhysicsThread(SnakeWorld* world, int snakeIndex, float tickDt, const FrictionMap* frictionMap)
+    : world(world),
+      snakeIndex(snakeIndex),
+      tickDt(tickDt),
+      frictionMap(frictionMap),
+      // 保留最近 10 秒，每格要放得下吃完所有蘋果後的節數
+      history((int)std::lround(10.0f / tickDt),
+              Snake::getSnapshotSize(world->getSnake(snakeIndex)->getNumSegments() + world->getRules().winScore)) {
+  publish();
+}
+
+PhysicsThread::~PhysicsThread() { stop(); }
+
+void PhysicsThread::start() {
+  if (running.exchange(true)) return;
+  thread = std::thread(&PhysicsThread::run, this);
+}
+
+void PhysicsThread::stop() {
+  running.store(false);
+  if (thread.joinable()) thread.join();
+}
+
+// ========== render 執行緒 ==========
+
+void PhysicsThread::send(const Command& command) {
+  // 前面還有沒送出的就排在後面，保持順序（按下/放開顛倒的話蛇會一直走）
+  flushPending();
+  if (!pending.empty() || !commands.push(command)) pending.push_back(command);
+}
+
+void PhysicsThread::flushPending() {
+  while (!pending.empty() && commands.push(pending.front())) pending.pop_front();
+}
+
+// ========== 物理執行緒 ==========
+
+void PhysicsThread::run() {
+  using Clock = std::chrono::steady_clock;
+  const auto realTickDuration = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(tickDt));
+  const int maxCatchUpTicks = 5;  // 落後太多就放棄追趕，避免越追越慢
+  const auto maxCatchUpTime = std::chrono::milliseconds(20);  // 加速時 tick 很短，改用牆鐘時間當上限
+
+  auto nextTick = Clock::now();
+  while (running.load(std::memory_order_relaxed)) {
+    Command command;
+    while (commands.pop(command)) applyCommand(command);
+
+    bool gameRunning = world->getAgent(snakeIndex).state == SnakeWorld::GameState::RUNNING;
+    if (!paused) {
+      Snake* snake = world->getSnake(snakeIndex);
+      world->step(tickDt);
+      if (gameRunning) simTime += tickDt;
+      if (world->getAgent(snakeIndex).state == SnakeWorld::GameState::RUNNING) {
+        history.record(*snake, tick++);
+      }
+    }
+    publish();
+
+    // 暫停或沒在玩的時候沒有東西要趕，照 1 倍速睡，不要空轉
+    bool fast = timeScale != 1.0f && gameRunning && !paused;
+    if (fast && timeScale <= 0.0f) {
+      nextTick = Clock::now();
+      continue;
+    }
+    auto tickDuration = fast ? std::chrono::duration_cast<Clock::duration>(realTickDuration / timeScale)
+                             : realTickDuration;
+    nextTick += tickDuration;
+    auto now = Clock::now();
+    if (now - nextTick > std::max<Clock::duration>(maxCatchUpTicks * tickDuration, maxCatchUpTime)) nextTick = now;
+    if (nextTick > now) std::this_thread::sleep_until(nextTick);
+  }
+}
+
+void PhysicsThread::applyCommand(const Command& command) {
+  SnakeWorld::Agent& agent = world->getAgent(snakeIndex);
+  Snake* snake = agent.snake.get();
+  bool gameRunning = agent.state == SnakeWorld::GameState::RUNNING;
+
+  switch (command.type) {
+    case Command::Type::START:
+      world->start(snakeIndex);
+      paused = false;
+      history.clear();
+      tick = 0;
+      break;
+    case Command::Type::PAUSE:
+      paused = true;
+      break;
+    case Command::Type::RESUME:
+      paused = false;
+      break;
+    case Command::Type::MOVE:
+      // 按下只在遊戲進行中有效，放開永遠有效
+      if (!command.pressed || (gameRunning && !paused)) {
+        snake->setSnakeMoveDirection(command.direction, command.pressed);
+      }
+      break;
+    case Command::Type::CYCLE_MOVEMENT_MODE:
+      if (snake->getMode() == Snake::MovementMode::LATERAL) {
+        snake->setMovementMode(Snake::MovementMode::RECTILINEAR);
+      } else if (snake->getMode() == Snake::MovementMode::RECTILINEAR) {
+        snake->setMovementMode(Snake::MovementMode::SIMPLE);
+      } else {
+        snake->setMovementMode(Snake::MovementMode::LATERAL);
+      }
+      break;
+    case Command::Type::TOGGLE_FRICTION_MAP:
+      if (frictionMap) snake->setFrictionMap(snake->getFrictionMap() ? nullptr : frictionMap);
+      break;
+    case Command::Type::TOGGLE_SPRING_INTEGRATOR:
+      snake->setSpringIntegrator(snake->getSpringIntegrator() == Snake::SpringIntegrator::ANALYTIC
+                                     ? Snake::SpringIntegrator::EXPLICIT
+                                     : Snake::SpringIntegrator::ANALYTIC);
+      break;
+    case Command::Type::REWIND:
+      // 只倒帶蛇的狀態，分數、計時與蘋果不變
+      if (gameRunning) {
+        long long restored = history.rewind(*snake, command.ticks);
+        if (restored >= 0) tick = restored + 1;
+      }
+      break;
+    case Command::Type::SET_TIME_SCALE:
+      timeScale = std::max(0.0f, command.timeScale);
+      break;
+  }
+}
+
+void PhysicsThread::publish() {
+  const SnakeWorld::Agent& agent = world->getAgent(snakeIndex);
+  const Snake* snake = agent.snake.get();
+  const auto& masses = snake->getMasses();
+
+  Frame& frame = frames.getWriteBuffer();
+  frame.tick = tick;
+  frame.simTime = simTime;
+  frame.timeScale = timeScale;
+  frame.positions.resize(masses.size());
+  for (size_t i = 0; i < masses.size(); ++i) frame.positions[i] = masses[i]->getPosition();
+  frame.radius = snake->getRadius();
+  frame.forwardDirection = snake->getForwardDirection();
+  frame.applePosition = agent.applePosition;
+  frame.score = agent.score;
+  frame.timer = agent.timer;
+  frame.state = agent.state;
+  frame.result = agent.result;
+  frame.hitWall = agent.hitWall;
+  frame.paused = paused;
+  frame.frictionMapOn = snake->getFrictionMap() != nullptr;
+  frame.springIntegrator = snake->getSpringIntegrator();
+  frame.movementMode = snake->getMode();
+  frames.publish();
+}
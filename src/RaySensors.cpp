@@ -0,0 +1,136 @@
+#include "RaySensors.h"
+#include <algorithm>
+#include <cmath>
+
+RaySensors::RaySensors(const Config& config, const SnakeWorld::Rules& rules)
+    : config(config),
+      rules(rules),
+      cells(glm::vec3(0.0f), glm::vec3(rules.arenaWidth, config.cellSize, rules.arenaDepth), config.cellSize) {
+  this->config.numRays = std::clamp(config.numRays, 0, MAX_RAYS);
+  const int k = this->config.numRays;
+  cosAngle.resize(k);
+  sinAngle.resize(k);
+  for (int r = 0; r < k; ++r) {
+    float angle = k > 1 ? config.fieldOfView * ((float)r / (k - 1) - 0.5f) : 0.0f;
+    cosAngle[r] = std::cos(angle);
+    sinAngle[r] = std::sin(angle);
+  }
+}
+
+// ========== 收集質點 ==========
+
+void RaySensors::update(SnakeWorld& world) {
+  if (!config.seeOtherSnakes || config.numRays == 0) return;
+
+  const int numSnakes = world.getNumSnakes();
+  std::vector<int> offsets(numSnakes + 1, 0);
+  for (int i = 0; i < numSnakes; ++i) offsets[i + 1] = offsets[i] + (int)world.getSnake(i)->getMasses().size();
+  const int count = offsets[numSnakes];
+  xs.resize(count);
+  ys.assign(count, 0.0f);  // 格子只有一層，高度不用
+  zs.resize(count);
+  owner.resize(count);
+  radii.resize(count);
+
+  world.getJobs().parallelFor(numSnakes, 64, [this, &world, &offsets](int begin, int end) {
+    for (int i = begin; i < end; ++i) {
+      const Snake& snake = *world.getSnake(i);
+      const std::vector<Mass*>& masses = snake.getMasses();
+      for (size_t m = 0; m < masses.size(); ++m) {
+        glm::vec3 p = masses[m]->getPosition();
+        int j = offsets[i] + (int)m;
+        xs[j] = p.x;
+        zs[j] = p.z;
+        owner[j] = i;
+        radii[j] = snake.getRadius();
+      }
+    }
+  });
+  cells.build(xs.data(), ys.data(), zs.data(), count);
+}
+
+// ========== 射線測試 ==========
+
+void RaySensors::hitCircle(float ox, float oz, float cx, float cz, float radius, float hitType, Rays& rays) const {
+  // |o + t d - c|^2 = radius^2，起點在圓外（c0 > 0）時最近的交點 t = -b - sqrt(b^2 - c0)，要 b < 0 才在前方
+  float mx = ox - cx, mz = oz - cz;
+  float c0 = mx * mx + mz * mz - radius * radius;
+  if (c0 <= 0.0f) return;
+  for (int r = 0; r < config.numRays; ++r) {
+    float b = mx * rays.dx[r] + mz * rays.dz[r];
+    float disc = b * b - c0;
+    float t = -b - std::sqrt(std::max(disc, 0.0f));
+    bool hit = disc >= 0.0f && b < 0.0f && t < rays.distance[r];
+    rays.distance[r] = hit ? t : rays.distance[r];
+    rays.type[r] = hit ? hitType : rays.type[r];
+  }
+}
+
+void RaySensors::cast(const SnakeWorld& world, int index, float* out) const {
+  const int k = config.numRays;
+  if (k == 0) return;
+  const SnakeWorld::Agent& agent = world.getAgent(index);
+  const Snake& snake = *agent.snake;
+  glm::vec3 head = snake.getHeadPosition();
+  glm::vec3 forward = snake.getForwardDirection();
+  glm::vec2 f = glm::vec2(forward.x, forward.z);
+  float length = glm::length(f);
+  f = length > 1e-6f ? f / length : glm::vec2(1.0f, 0.0f);
+  const float ox = head.x, oz = head.z;
+
+  // 射線方向與牆：四邊各算一次 t，方向分量為 0 的那邊不會比 maxRange 近
+  Rays rays;
+  const float width = rules.arenaWidth, depth = rules.arenaDepth, range = config.maxRange;
+  for (int r = 0; r < k; ++r) {
+    float dx = cosAngle[r] * f.x - sinAngle[r] * f.y;  // 往右轉是正角度（與 VecEnv 的 right 相同）
+    float dz = cosAngle[r] * f.y + sinAngle[r] * f.x;
+    rays.dx[r] = dx;
+    rays.dz[r] = dz;
+    float tx = dx > 0.0f ? (width - ox) / dx : dx < 0.0f ? -ox / dx : range;
+    float tz = dz > 0.0f ? (depth - oz) / dz : dz < 0.0f ? -oz / dz : range;
+    float t = std::max(std::min(tx, tz), 0.0f);
+    bool hit = t < range;
+    rays.distance[r] = hit ? t : range;
+    rays.type[r] = hit ? (float)WALL : (float)NONE;
+  }
+
+  hitCircle(ox, oz, agent.applePosition.x, agent.applePosition.z, rules.appleRadius, (float)APPLE, rays);
+
+  const std::vector<Mass*>& masses = snake.getMasses();
+  for (const Mass* mass : masses) {
+    glm::vec3 p = mass->getPosition();
+    hitCircle(ox, oz, p.x, p.z, snake.getRadius(), (float)BODY, rays);
+  }
+
+  if (config.seeOtherSnakes && !xs.empty()) {
+    float reach = range + snake.getRadius();
+    glm::ivec3 lo = cells.cellCoord(ox - reach, 0.0f, oz - reach);
+    glm::ivec3 hi = cells.cellCoord(ox + reach, 0.0f, oz + reach);
+    const std::vector<int>& order = cells.getOrder();
+    for (int cz = lo.z; cz <= hi.z; ++cz) {
+      // 同一列的格子在排序後是連續的
+      int rowBegin = cells.getCellBegin(cells.cellIndex(glm::ivec3(lo.x, 0, cz)));
+      int rowEnd = cells.getCellEnd(cells.cellIndex(glm::ivec3(hi.x, 0, cz)));
+      for (int s = rowBegin; s < rowEnd; ++s) {
+        int j = order[s];
+        if (owner[j] != index) hitCircle(ox, oz, xs[j], zs[j], radii[j], (float)BODY, rays);
+      }
+    }
+  }
+
+  const float invRange = 1.0f / range;
+  for (int r = 0; r < k; ++r) {
+    float* value = out + r * VALUES_PER_RAY;
+    value[0] = rays.distance[r] * invRange;
+    value[1] = rays.type[r] == (float)WALL ? 1.0f : 0.0f;
+    value[2] = rays.type[r] == (float)APPLE ? 1.0f : 0.0f;
+    value[3] = rays.type[r] == (float)BODY ? 1.0f : 0.0f;
+  }
+}
+
+void RaySensors::castAll(SnakeWorld& world, float* out, size_t stride) {
+  update(world);
+  world.getJobs().parallelFor(world.getNumSnakes(), 64, [this, &world, out, stride](int begin, int end) {
+    for (int i = begin; i < end; ++i) cast(world, i, out + (size_t)i * stride);
+  });
+}
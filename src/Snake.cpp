@@ -1,6 +1,8 @@
 ﻿#include "Snake.h"
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 
 #ifndef M_PI
@@ -16,22 +18,20 @@ Snake::Snake(int numSegments, float segmentMass, float segmentLength, float spri
       segmentLength(segmentLength),
       springK(springK),  // 中等硬度
       damping(damping),
+      radius(radius),
       /*  // 小阻尼 12302303 先將這個隱藏
       forwardDirection(1.0f, 0.0f, 0.0f),
       targetDirection(1.0f, 0.0f, 0.0f),
       waveSpeed(2.0f),*/
       isMoving(false),
       groundHeight(radius),
-      movementMode(MovementMode::RECTILINEAR),
-      radius(radius) {
-  std::cout << "Creating snake with " << numSegments << " segments..." << std::endl;
+      movementMode(MovementMode::RECTILINEAR) {
   createMassSpringSystem(startPos);
-  std::cout << "Snake created successfully!" << std::endl;
 }
 
 Snake::~Snake() {
-  for (auto* mass : masses) delete mass;
-  for (auto* spring : axialSprings) delete spring;
+  for (auto* mass : masses) massPool.destroy(mass);
+  for (auto* spring : axialSprings) springPool.destroy(spring);
   masses.clear();
   axialSprings.clear();
 }
@@ -42,28 +42,118 @@ void Snake::createMassSpringSystem(const glm::vec3& startPos) {
     glm::vec3 pos = startPos + glm::vec3(i * segmentLength, 0.0f, 0.0f);
     pos.y = groundHeight;
     float idealMass = segmentMass * (0.5f + std::min(0.5f, (float(i) / numSegments)) * 1.0f);
-    masses.push_back(new Mass(idealMass, pos));
+    masses.push_back(massPool.create(idealMass, pos));
     initialPositions.push_back(pos);  // 儲存初始位置
   }
 
   // 創建彈簧連接相鄰質點
   for (int i = 0; i < numSegments - 1; ++i) {
-    axialSprings.push_back(new Spring(masses[i], masses[i + 1], springK, segmentLength, damping));
+    axialSprings.push_back(springPool.create(masses[i], masses[i + 1], springK, segmentLength, damping));
   }
+  externalForces.assign(masses.size(), glm::vec3(0.0f));
+}
+
+// ========== 增減節數 ==========
+
+Mass* Snake::insertSegment(int index) {
+  int count = (int)masses.size();
+  if (index < 0 || index > count || count < 2) return nullptr;
+
+  // 新質點的位置：頭尾沿身體往外延伸一節，中間取兩邊的中點
+  glm::vec3 pos, vel;
+  float massValue;
+  if (index == 0 || index == count) {
+    int end = (index == 0) ? 0 : count - 1;
+    int inner = (index == 0) ? 1 : count - 2;
+    glm::vec3 outward = masses[end]->getPosition() - masses[inner]->getPosition();
+    float len = glm::length(outward);
+    outward = len > 0.001f ? outward / len : glm::vec3(index == 0 ? -1.0f : 1.0f, 0.0f, 0.0f);
+    pos = masses[end]->getPosition() + outward * segmentLength;
+    vel = masses[end]->getVelocity();
+    massValue = masses[end]->getMass();
+  } else {
+    pos = 0.5f * (masses[index - 1]->getPosition() + masses[index]->getPosition());
+    vel = 0.5f * (masses[index - 1]->getVelocity() + masses[index]->getVelocity());
+    massValue = 0.5f * (masses[index - 1]->getMass() + masses[index]->getMass());
+  }
+
+  Mass* mass = massPool.create(massValue, pos);
+  mass->setVelocity(vel);
+  masses.insert(masses.begin() + index, mass);
+  externalForces.insert(externalForces.begin() + index, glm::vec3(0.0f));
+
+  // 彈簧：中間插入時原本的彈簧改接新質點，再補一條；頭尾只需要補一條
+  if (index == 0) {
+    axialSprings.insert(axialSprings.begin(), springPool.create(masses[0], masses[1], springK, segmentLength, damping));
+  } else if (index == count) {
+    axialSprings.push_back(springPool.create(masses[count - 1], masses[count], springK, segmentLength, damping));
+  } else {
+    Spring* spring = axialSprings[index - 1];
+    spring->setMasses(masses[index - 1], masses[index]);
+    spring->setRestLength(0.5f * spring->getRestLength());
+    axialSprings.insert(axialSprings.begin() + index,
+                        springPool.create(masses[index], masses[index + 1], springK, spring->getRestLength(), damping));
+  }
+  return mass;
+}
+
+bool Snake::removeSegment(int index) {
+  int count = (int)masses.size();
+  if (index < 0 || index >= count || count <= 2) return false;
+
+  if (index == 0) {
+    springPool.destroy(axialSprings.front());
+    axialSprings.erase(axialSprings.begin());
+  } else if (index == count - 1) {
+    springPool.destroy(axialSprings.back());
+    axialSprings.pop_back();
+  } else {
+    // 前一條彈簧直接跨過被移除的質點
+    axialSprings[index - 1]->setMasses(masses[index - 1], masses[index + 1]);
+    springPool.destroy(axialSprings[index]);
+    axialSprings.erase(axialSprings.begin() + index);
+  }
+
+  massPool.destroy(masses[index]);
+  masses.erase(masses.begin() + index);
+  externalForces.erase(externalForces.begin() + index);
+  return true;
+}
+
+int Snake::indexOf(const Mass* mass) const {
+  auto it = std::find(masses.begin(), masses.end(), mass);
+  return it == masses.end() ? -1 : (int)(it - masses.begin());
+}
+
+void Snake::addExternalForce(int index, const glm::vec3& force) {
+  if (index < 0 || index >= (int)externalForces.size()) return;
+  externalForces[index] += force;
 }
 
 void Snake::setSnakeMoveDirection(int index, bool value) {
   snakeMoveDirection[index] = value;
-  if (snakeMoveDirection[0] || snakeMoveDirection[1] || snakeMoveDirection[2]) {
+  if (snakeMoveDirection[0] || snakeMoveDirection[1] || snakeMoveDirection[2] || steerForward > 0.0f ||
+      steerTurn != 0.0f) {
     startMoving();
   } else {
     stopMoving();
   }
 }
 
+void Snake::setSteering(float forward, float turn) {
+  steerForward = std::clamp(forward, 0.0f, 1.0f);
+  steerTurn = std::clamp(turn, -1.0f, 1.0f);
+  setSnakeMoveDirection(0, snakeMoveDirection[0]);  // 重新判斷是否在移動
+}
+
 // ========== 主更新 ==========
 
 void Snake::update(float dt) {
+  if (lod == PhysicsLod::KINEMATIC) {
+    updateKinematic(dt);
+    return;
+  }
+
   // 1. 清空上一幀的力
   for (auto* mass : masses) {
     mass->resetForce();
@@ -78,11 +168,17 @@ void Snake::update(float dt) {
     mass->applyForce(glm::vec3(0, -GRAVITY * mass->getMass(), 0));
   }
 
+  for (size_t i = 0; i < masses.size(); ++i) {
+    masses[i]->applyForce(externalForces[i]);
+    externalForces[i] = glm::vec3(0.0f);
+  }
+
   // 4. 運動力（根據模式選擇）
 
   if (isMoving) {
     if (movementMode == MovementMode::SIMPLE) {                    // && snakeMoveDirection[0] == true
       masses[0]->applyForce(forwardDirection * FRICTION_FORWARD);  // 頭部施加前進力
+      actuationWork += FRICTION_FORWARD * std::max(0.0f, glm::dot(forwardDirection, masses[0]->getVelocity())) * dt;
     } else if (movementMode == MovementMode::LATERAL) {
       // applyLateralUndulation();  // S形波動
     } else if (movementMode == MovementMode::RECTILINEAR) {
@@ -93,30 +189,40 @@ void Snake::update(float dt) {
       movementTimer -= 10.0f / waveFrequencyRectilinear;
     }
   } else {
-    for (int i = 0; i < axialSprings.size(); ++i) {
-      axialSprings[i]->setRestLength(segmentLength);
+    for (int i = 0; i < (int)axialSprings.size(); ++i) {
+      actuateSpring(i, segmentLength);
     }
   }
 
   // 5. 轉向力
-  updateTarget(dt);
+  updateTarget();
   applySteeringForce();
 
-  // 6. 彈簧力
-  for (auto* spring : axialSprings) {
-    spring->applyForce();
+  // 6. 彈簧力（解析解模式在第 8 步處理）
+  if (springIntegrator == SpringIntegrator::EXPLICIT) {
+    for (auto* spring : axialSprings) {
+      spring->applyForce();
+    }
   }
 
   // 7. 地面摩擦
-  applyDirectionalFriction();
+  if (frictionMap) {
+    applyMappedFriction();
+  } else {
+    applyDirectionalFriction();
 
-  for (size_t i = 0; i < masses.size(); ++i) {
-    applyGroundFriction(masses[i]);
+    for (size_t i = 0; i < masses.size(); ++i) {
+      applyGroundFriction(masses[i]);
+    }
   }
 
   // 8. 更新位置和速度
-  for (auto* mass : masses) {
-    mass->update(dt);
+  if (springIntegrator == SpringIntegrator::ANALYTIC) {
+    integrateAnalytic(dt);
+  } else {
+    for (auto* mass : masses) {
+      mass->update(dt);
+    }
   }
 
   // 9. 地面碰撞
@@ -127,6 +233,130 @@ void Snake::update(float dt) {
 
   // 10. 防止過度拉伸
   // enforceSoftDistanceConstraints();
+
+  // 11. 記錄爬行速度，給 KINEMATIC 模式使用
+  if (isMoving) {
+    float forwardSpeed = glm::dot(getHorizontalMomentumVelocity(), forwardDirection);
+    crawlSpeed += (forwardSpeed - crawlSpeed) * std::min(1.0f, dt / CRAWL_SPEED_TAU);
+  }
+}
+
+// ========== 細緻度 ==========
+
+void Snake::updateLod(const glm::vec3& viewerPos) {
+  if (observed) {
+    setLod(PhysicsLod::FULL);
+    return;
+  }
+  float distance = glm::length(getHeadPosition() - viewerPos);
+  if (lod == PhysicsLod::FULL && distance > lodFarDistance) {
+    setLod(PhysicsLod::KINEMATIC);
+  } else if (lod == PhysicsLod::KINEMATIC && distance < lodNearDistance) {
+    setLod(PhysicsLod::FULL);
+  }
+}
+
+void Snake::setLod(PhysicsLod level) {
+  if (level == lod || masses.size() < 2) return;
+
+  updateForwardDirection();
+  glm::vec3 momentumVelocity = getHorizontalMomentumVelocity();
+  if (level == PhysicsLod::KINEMATIC) {
+    // 只保留沿前進方向的速度，側向的晃動在中心線模型裡沒有對應
+    kinematicSpeed = std::max(0.0f, glm::dot(momentumVelocity, forwardDirection));
+  } else {
+    // 每個質點都給相同的速度，總動量等於中心線模型的動量
+    for (auto* mass : masses) {
+      mass->setVelocity(forwardDirection * kinematicSpeed);
+      mass->resetForce();
+    }
+    for (auto* spring : axialSprings) {
+      spring->setRestLength(segmentLength);
+    }
+  }
+  std::fill(externalForces.begin(), externalForces.end(), glm::vec3(0.0f));
+  lod = level;
+}
+
+// 質量加權的水平平均速度（總動量 / 總質量）
+glm::vec3 Snake::getHorizontalMomentumVelocity() const {
+  glm::vec3 momentum(0.0f);
+  float totalMass = 0.0f;
+  for (auto* mass : masses) {
+    momentum += mass->getMass() * mass->getVelocity();
+    totalMass += mass->getMass();
+  }
+  momentum.y = 0.0f;
+  return totalMass > 0.0f ? momentum / totalMass : glm::vec3(0.0f);
+}
+
+// 中心線跟隨：頭部依目標方向轉向並前進，後面每一節拉到與前一節相距 segmentLength 的位置
+void Snake::updateKinematic(float dt) {
+  if (masses.size() < 2 || dt <= 0.0f) return;  // 速度由位移 / dt 得到，dt 為 0 會變成 inf
+  std::fill(externalForces.begin(), externalForces.end(), glm::vec3(0.0f));
+
+  // 速度：移動時以有限加速度趨近爬行速度，停下時以地面摩擦減速
+  float targetSpeed = isMoving ? std::max(0.0f, crawlSpeed) : 0.0f;
+  if (kinematicSpeed < targetSpeed) {
+    kinematicSpeed = std::min(targetSpeed, kinematicSpeed + KINEMATIC_ACCEL * dt);
+  } else {
+    kinematicSpeed = std::max(targetSpeed, kinematicSpeed - groundFrictionCoeff * GRAVITY * dt);
+  }
+
+  // 轉向：每秒最多轉 KINEMATIC_TURN_RATE
+  updateTarget();
+  glm::vec3 up(0.0f, 1.0f, 0.0f);
+  float turn = glm::clamp(glm::cross(forwardDirection, targetDirection).y, -1.0f, 1.0f);
+  float angle = glm::clamp(std::asin(turn), -KINEMATIC_TURN_RATE * dt, KINEMATIC_TURN_RATE * dt);
+  glm::vec3 rightDir = glm::cross(forwardDirection, up);
+  forwardDirection = glm::normalize(forwardDirection * std::cos(angle) - rightDir * std::sin(angle));
+
+  if (isMoving) {
+    movementTimer += dt;
+    if (movementTimer > 10.0f / waveFrequencyRectilinear) {
+      movementTimer -= 10.0f / waveFrequencyRectilinear;
+    }
+  }
+
+  float invDt = 1.0f / dt;
+  glm::vec3 previous = masses[0]->getPosition();
+  glm::vec3 head = previous + forwardDirection * kinematicSpeed * dt;
+  head.y = groundHeight;
+  masses[0]->setPosition(head);
+  masses[0]->setVelocity((head - previous) * invDt);
+
+  for (size_t i = 1; i < masses.size(); ++i) {
+    previous = masses[i]->getPosition();
+    glm::vec3 leader = masses[i - 1]->getPosition();
+    glm::vec3 dir = previous - leader;
+    dir.y = 0.0f;
+    float len = glm::length(dir);
+    dir = len > 0.001f ? dir / len : -forwardDirection;
+    glm::vec3 pos = leader + dir * segmentLength;
+    pos.y = groundHeight;
+    masses[i]->setPosition(pos);
+    masses[i]->setVelocity((pos - previous) * invDt);
+  }
+}
+
+// 分離積分：慢的力先更新速度，彈簧軸向用封閉解給衝量，位置更新後再補上終點速度
+void Snake::integrateAnalytic(float dt) {
+  for (auto* mass : masses) {
+    mass->integrateVelocity(dt);
+  }
+
+  springCorrections.resize(axialSprings.size());
+  for (size_t i = 0; i < axialSprings.size(); ++i) {
+    springCorrections[i] = axialSprings[i]->beginAnalyticStep(dt);
+  }
+
+  for (auto* mass : masses) {
+    mass->integratePosition(dt);
+  }
+
+  for (size_t i = 0; i < axialSprings.size(); ++i) {
+    axialSprings[i]->applyAxialImpulse(springCorrections[i]);
+  }
 }
 
 // ========== 物理約束 ==========
@@ -215,7 +445,7 @@ void Snake::updateForwardDirection() {
   }
 }
 
-void Snake::updateTarget(float dt) {
+void Snake::updateTarget() {
   if (!isMoving || masses.size() < 2) {
     targetDirection = forwardDirection;
     return;
@@ -239,6 +469,7 @@ void Snake::updateTarget(float dt) {
   if (Snake::snakeMoveDirection[2]) {
     dir += rightdir;  // 右
   }
+  dir += currentdir * steerForward + rightdir * steerTurn;
   float dirlen = glm::length(dir);
   if (dirlen < 0.001f) {
     targetDirection = currentdir;
@@ -301,14 +532,14 @@ void Snake::applyRectilinearProgression() {
 
   float omega = waveFrequencyRectilinear * 2.0f * M_PI;
 
-  for (int i = 0; i < axialSprings.size(); ++i) {
+  for (int i = 0; i < (int)axialSprings.size(); ++i) {
     float spatialPhase = 2.0f * M_PI * (float)(i % waveLength) / waveLength;
     float temporalPhase = omega * movementTimer;
     float wave = sin(temporalPhase - spatialPhase);
 
     // 修改彈簧長度產生蠕動
     float lengthMod = 1.0f - waveAmplitudeRectilinear * wave;
-    axialSprings[i]->setRestLength(segmentLength * lengthMod);
+    actuateSpring(i, segmentLength * lengthMod);
 
     /*
     // 收縮時推進
@@ -331,6 +562,22 @@ void Snake::applyRectilinearProgression() {
   // masses[0]->applyForce(forwardDirection * 1.0f);
 }
 
+void Snake::setSpringConstants(float k, float dampingConstant) {
+  springK = k;
+  damping = dampingConstant;
+  for (auto* spring : axialSprings) spring->setConstants(k, dampingConstant);
+}
+
+// 肌肉改變靜止長度做的功：|張力 × 靜止長度的變化|
+void Snake::actuateSpring(int index, float restLength) {
+  Spring* spring = axialSprings[index];
+  float oldRestLength = spring->getRestLength();
+  if (restLength == oldRestLength) return;
+  float length = glm::length(spring->getMass2()->getPosition() - spring->getMass1()->getPosition());
+  actuationWork += std::abs(springK * (length - oldRestLength) * (restLength - oldRestLength));
+  spring->setRestLength(restLength);
+}
+
 // ========== 摩擦力 ==========
 
 void Snake::applyGroundFriction(Mass* mass) {  // 如果覺得摩擦力太大可以調小groundFrictionCoeff或質量
@@ -348,7 +595,7 @@ void Snake::applyGroundFriction(Mass* mass) {  // 如果覺得摩擦力太大可
 void Snake::applyDirectionalFriction() {
   if (movementMode == MovementMode::RECTILINEAR) {
     if (masses.size() < 2) return;
-    for (int i = 0; i < masses.size(); ++i) {
+    for (int i = 0; i < (int)masses.size(); ++i) {
       Mass* mass = masses[i];
       // 獲取質點的速度
       glm::vec3 velocity = mass->getVelocity();
@@ -357,19 +604,10 @@ void Snake::applyDirectionalFriction() {
       if (glm::length(velocity) < 0.001f) {
         continue;
       }
-      glm::vec3 dir;
-      if (i == 0) {
-        dir = masses[0]->getPosition() - masses[1]->getPosition();
-      } else if (i == masses.size() - 1) {
-        dir = masses[masses.size() - 2]->getPosition() - masses[masses.size() - 1]->getPosition();
-      } else {
-        dir = masses[i - 1]->getPosition() - masses[i + 1]->getPosition();
-      }
-      dir.y = 0.0f;
+      glm::vec3 dir = getBodyTangent(i);
       if (glm::length(dir) < 0.001f) {
         continue;
       }
-      dir = glm::normalize(dir);
 
       // 消去向後的分量
       if (glm::dot(velocity, dir) < 0.0f) {
@@ -381,9 +619,205 @@ void Snake::applyDirectionalFriction() {
   }
 }
 
+// 身體在第 i 個質點的水平切線（指向頭），長度太短時回傳零向量
+glm::vec3 Snake::getBodyTangent(int i) const {
+  int last = (int)masses.size() - 1;
+  glm::vec3 dir;
+  if (i == 0) {
+    dir = masses[0]->getPosition() - masses[1]->getPosition();
+  } else if (i == last) {
+    dir = masses[last - 1]->getPosition() - masses[last]->getPosition();
+  } else {
+    dir = masses[i - 1]->getPosition() - masses[i + 1]->getPosition();
+  }
+  dir.y = 0.0f;
+  float len = glm::length(dir);
+  if (len < 0.001f) return glm::vec3(0.0f);
+  return dir / len;
+}
+
+// 依摩擦貼圖施加非等向庫侖摩擦：
+//   沿身體往前 -> forward，往後 -> backward，側向 -> lateral
+// 取代 applyDirectionalFriction 的「直接消去向後速度」與等向的 applyGroundFriction
+void Snake::applyMappedFriction() {
+  if (masses.size() < 2) return;
+
+  // 一次取樣全部質點
+  const int n = (int)masses.size();
+  frictionScratch.resize(5 * n);
+  float* xs = frictionScratch.data();
+  float* zs = xs + n;
+  float* muForward = zs + n;
+  float* muBackward = muForward + n;
+  float* muLateral = muBackward + n;
+  for (int i = 0; i < n; ++i) {
+    glm::vec3 pos = masses[i]->getPosition();
+    xs[i] = pos.x;
+    zs[i] = pos.z;
+  }
+  frictionMap->sampleBatch(xs, zs, n, muForward, muBackward, muLateral);
+
+  glm::vec3 up(0.0f, 1.0f, 0.0f);
+  for (int i = 0; i < n; ++i) {
+    Mass* mass = masses[i];
+    glm::vec3 velocity = mass->getVelocity();
+    velocity.y = 0.0f;
+    float speed = glm::length(velocity);
+    if (speed < 0.001f) continue;
+
+    glm::vec3 tangent = getBodyTangent(i);
+    if (glm::length(tangent) < 0.001f) tangent = velocity / speed;
+    glm::vec3 side = glm::cross(tangent, up);
+
+    float vForward = glm::dot(velocity, tangent);
+    float vLateral = glm::dot(velocity, side);
+    float muAxial = vForward >= 0.0f ? muForward[i] : muBackward[i];
+
+    // 庫侖摩擦 mu * N 按速度分量分配，速度很小時退化成黏滯摩擦
+    float normalForce = mass->getMass() * GRAVITY;
+    float scale = normalForce / std::max(speed, FRICTION_SLIP_EPS);
+    glm::vec3 frictionForce = -(muAxial * vForward * tangent + muLateral[i] * vLateral * side) * scale;
+    mass->applyForce(frictionForce);
+  }
+}
+
+// ========== 狀態快照 ==========
+
+// 快照開頭的固定欄位，後面接著各質點的陣列：
+//   position[3n] velocity[3n] mass[n] externalForce[3n] restLength[n - 1]
+struct Snake::SnapshotHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t segmentCount;
+  float movementTimer;
+  float crawlSpeed;
+  float kinematicSpeed;
+  float forwardDirection[3];
+  float targetDirection[3];
+  uint8_t isMoving;
+  uint8_t moveDirection[3];
+  uint8_t movementMode;
+  uint8_t springIntegrator;
+  uint8_t lod;
+  uint8_t padding;
+  float steerForward;
+  float steerTurn;
+};
+
+namespace {
+constexpr uint32_t SNAPSHOT_MAGIC = 0x50414e53;  // "SNAP"
+constexpr uint16_t SNAPSHOT_VERSION = 2;
+
+void writeVec3(float* dst, const glm::vec3& v) { std::memcpy(dst, &v[0], sizeof(float) * 3); }
+glm::vec3 readVec3(const float* src) { return glm::vec3(src[0], src[1], src[2]); }
+}  // namespace
+
+size_t Snake::getSnapshotSize(int segmentCount) {
+  return sizeof(SnapshotHeader) + sizeof(float) * (size_t)(11 * segmentCount - 1);
+}
+
+size_t Snake::saveSnapshot(void* buffer, size_t capacity) const {
+  const int n = (int)masses.size();
+  size_t size = getSnapshotSize(n);
+  if (capacity < size) return 0;
+
+  SnapshotHeader header;
+  std::memset(&header, 0, sizeof(header));
+  header.magic = SNAPSHOT_MAGIC;
+  header.version = SNAPSHOT_VERSION;
+  header.segmentCount = (uint16_t)n;
+  header.movementTimer = movementTimer;
+  header.crawlSpeed = crawlSpeed;
+  header.kinematicSpeed = kinematicSpeed;
+  writeVec3(header.forwardDirection, forwardDirection);
+  writeVec3(header.targetDirection, targetDirection);
+  header.isMoving = isMoving;
+  for (int i = 0; i < 3; ++i) header.moveDirection[i] = snakeMoveDirection[i];
+  header.steerForward = steerForward;
+  header.steerTurn = steerTurn;
+  header.movementMode = (uint8_t)movementMode;
+  header.springIntegrator = (uint8_t)springIntegrator;
+  header.lod = (uint8_t)lod;
+
+  unsigned char* bytes = static_cast<unsigned char*>(buffer);
+  std::memcpy(bytes, &header, sizeof(header));
+  float* positions = reinterpret_cast<float*>(bytes + sizeof(header));
+  float* velocities = positions + 3 * n;
+  float* massValues = velocities + 3 * n;
+  float* forces = massValues + n;
+  float* restLengths = forces + 3 * n;
+  for (int i = 0; i < n; ++i) {
+    writeVec3(positions + 3 * i, masses[i]->getPosition());
+    writeVec3(velocities + 3 * i, masses[i]->getVelocity());
+    massValues[i] = masses[i]->getMass();
+    writeVec3(forces + 3 * i, externalForces[i]);
+  }
+  for (int i = 0; i < n - 1; ++i) {
+    restLengths[i] = axialSprings[i]->getRestLength();
+  }
+  return size;
+}
+
+bool Snake::restoreSnapshot(const void* buffer, size_t size) {
+  SnapshotHeader header;
+  if (size < sizeof(header)) return false;
+  const unsigned char* bytes = static_cast<const unsigned char*>(buffer);
+  std::memcpy(&header, bytes, sizeof(header));
+  const int n = header.segmentCount;
+  if (header.magic != SNAPSHOT_MAGIC || header.version != SNAPSHOT_VERSION || n < 2 || size < getSnapshotSize(n)) {
+    std::cout << "[ERROR] Invalid snake snapshot" << std::endl;
+    return false;
+  }
+  // 列舉值直接從位元組轉型，超出範圍的話 update 裡的 switch 會走到沒有處理的分支
+  if (header.movementMode > (uint8_t)MovementMode::RECTILINEAR ||
+      header.springIntegrator > (uint8_t)SpringIntegrator::ANALYTIC || header.lod > (uint8_t)PhysicsLod::KINEMATIC) {
+    std::cout << "[ERROR] Invalid snake snapshot: bad movement mode, integrator or LOD" << std::endl;
+    return false;
+  }
+
+  while ((int)masses.size() > n) removeSegment((int)masses.size() - 1);
+  while ((int)masses.size() < n) growTail();
+
+  const float* positions = reinterpret_cast<const float*>(bytes + sizeof(header));
+  const float* velocities = positions + 3 * n;
+  const float* massValues = velocities + 3 * n;
+  const float* forces = massValues + n;
+  const float* restLengths = forces + 3 * n;
+  for (int i = 0; i < n; ++i) {
+    masses[i]->setPosition(readVec3(positions + 3 * i));
+    masses[i]->setVelocity(readVec3(velocities + 3 * i));
+    masses[i]->setMass(massValues[i]);
+    masses[i]->resetForce();
+    externalForces[i] = readVec3(forces + 3 * i);
+  }
+  for (int i = 0; i < n - 1; ++i) {
+    axialSprings[i]->setRestLength(restLengths[i]);
+  }
+
+  movementTimer = header.movementTimer;
+  crawlSpeed = header.crawlSpeed;
+  kinematicSpeed = header.kinematicSpeed;
+  forwardDirection = readVec3(header.forwardDirection);
+  targetDirection = readVec3(header.targetDirection);
+  isMoving = header.isMoving != 0;
+  for (int i = 0; i < 3; ++i) snakeMoveDirection[i] = header.moveDirection[i] != 0;
+  steerForward = header.steerForward;
+  steerTurn = header.steerTurn;
+  movementMode = (MovementMode)header.movementMode;
+  springIntegrator = (SpringIntegrator)header.springIntegrator;
+  lod = (PhysicsLod)header.lod;
+  return true;
+}
+
 void Snake::reset() {
   isMoving = false;
   movementTimer = 0.0f;
+  kinematicSpeed = 0.0f;
+  actuationWork = 0.0;
+
+  // 回到建立時的節數
+  while ((int)masses.size() > numSegments) removeSegment((int)masses.size() - 1);
+  while ((int)masses.size() < numSegments) growTail();
 
   // 重置質點位置與速度
   for (size_t i = 0; i < masses.size(); ++i) {
@@ -391,6 +825,7 @@ void Snake::reset() {
     masses[i]->setVelocity(glm::vec3(0.0f));
     masses[i]->resetForce();
   }
+  std::fill(externalForces.begin(), externalForces.end(), glm::vec3(0.0f));
 
   // 重置彈簧長度
   for (auto* spring : axialSprings) {
@@ -403,6 +838,7 @@ void Snake::reset() {
 
   // 重置移動方向按鍵狀態
   snakeMoveDirection[0] = snakeMoveDirection[1] = snakeMoveDirection[2] = false;
+  steerForward = steerTurn = 0.0f;
 }
 
 /* 12211846 S型的應該還會需要參考這個
@@ -0,0 +1,260 @@
+#include "SnakeWorld.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+
+SnakeWorld::SnakeWorld(const Rules& rules, JobSystem* jobs)
+    : rules(rules), jobs(jobs ? jobs : &JobSystem::shared()) {}
+
+int SnakeWorld::addSnake(const SnakeParams& params, const glm::vec3& startPos, unsigned int seed) {
+  Agent agent;
+  agent.snake = std::make_unique<Snake>(params.numSegments, params.segmentMass, params.segmentLength, params.springK,
+                                        params.damping, startPos, params.radius);
+  agent.snake->setSpringIntegrator(params.integrator);
+  agent.snake->setFrictionMap(params.frictionMap);
+  applyLodDistances(*agent.snake);
+  agent.params = params;
+  agent.startPos = startPos;
+  agent.applePosition = rules.firstApple;
+  agent.timer = rules.timeLimit;
+  agent.rng.seed(seed);
+  agents.push_back(std::move(agent));
+  if (!shards.empty()) {
+    shards.clear();
+    stats.nodes.clear();
+  }
+  return (int)agents.size() - 1;
+}
+
+void SnakeWorld::shardByNode() {
+  shards.clear();
+  int numNodes = jobs->getNumNodes();
+  if (numNodes <= 1) return;
+
+  // 分片大小和節點的執行緒數成正比
+  int count = (int)agents.size();
+  int threadsBefore = 0;
+  for (int node = 0; node < numNodes; ++node) {
+    int begin = (int)((long long)count * threadsBefore / jobs->getNumThreads());
+    threadsBefore += jobs->getNodeThreadCount(node);
+    int end = (int)((long long)count * threadsBefore / jobs->getNumThreads());
+    shards.push_back({node, begin, end});
+  }
+
+  // 在所屬節點的執行緒上重新建立，質點與彈簧的記憶體就配置在那個節點
+  JobSystem::JobFunction rebuild = [](void* context, int begin, int end) {
+    auto* world = static_cast<SnakeWorld*>(context);
+    for (int i = begin; i < end; ++i) {
+      Agent& agent = world->agents[i];
+      const SnakeParams& p = agent.params;
+      agent.snake = std::make_unique<Snake>(p.numSegments, p.segmentMass, p.segmentLength, p.springK, p.damping,
+                                            agent.startPos, p.radius);
+      agent.snake->setSpringIntegrator(p.integrator);
+      agent.snake->setFrictionMap(p.frictionMap);
+      world->applyLodDistances(*agent.snake);
+    }
+  };
+  JobSystem::Counter counter;
+  for (const Shard& shard : shards) {
+    jobs->runOnNode(shard.node, rebuild, this, shard.begin, shard.end, 64, &counter);
+  }
+  jobs->wait(counter);
+  resetStats();
+}
+
+void SnakeWorld::applyLodDistances(Snake& snake) const {
+  float diagonal = std::hypot(rules.arenaWidth, rules.arenaDepth);
+  snake.setLodDistances(rules.lodNear * diagonal, rules.lodFar * diagonal);
+}
+
+int SnakeWorld::countLod(Snake::PhysicsLod lod) const {
+  int count = 0;
+  for (const Agent& agent : agents) count += agent.snake->getLod() == lod;
+  return count;
+}
+
+void SnakeWorld::resetStats() {
+  stats = Stats();
+  stats.nodes.resize(shards.size());
+  for (size_t i = 0; i < shards.size(); ++i) stats.nodes[i].snakes = shards[i].end - shards[i].begin;
+}
+
+void SnakeWorld::start(int index) {
+  Agent& agent = agents[index];
+  agent.snake->reset();
+  agent.applePosition = rules.firstApple;
+  agent.score = 0;
+  agent.timer = rules.timeLimit;
+  agent.elapsed = 0.0f;
+  agent.state = GameState::RUNNING;
+  agent.result = GameResult::NONE;
+  agent.hitWall = false;
+  if (agent.planner) agent.planner->reset();
+}
+
+void SnakeWorld::startAll() {
+  for (int i = 0; i < (int)agents.size(); ++i) start(i);
+}
+
+void SnakeWorld::setPlannedAutopilot(int index, const PathPlanner::Config& config) {
+  Agent& agent = agents[index];
+  agent.autopilot = true;
+  agent.planner = std::make_unique<PathPlanner>(config, rules.arenaWidth, rules.arenaDepth, rules.wallMargin);
+}
+
+void SnakeWorld::setInput(int index, bool forward, bool left, bool right) {
+  Snake* snake = agents[index].snake.get();
+  snake->setSnakeMoveDirection(0, forward);
+  snake->setSnakeMoveDirection(1, left);
+  snake->setSnakeMoveDirection(2, right);
+}
+
+// ========== 更新 ==========
+
+void SnakeWorld::step(float dt) {
+  auto start = std::chrono::steady_clock::now();
+
+  if (shards.empty()) {
+    std::atomic<long long> substeps{0};
+    jobs->parallelFor((int)agents.size(), 64, [this, dt, &substeps](int begin, int end) {
+      long long local = 0;
+      for (int i = begin; i < end; ++i) local += stepAgent(agents[i], dt);
+      substeps.fetch_add(local, std::memory_order_relaxed);
+    });
+    stats.snakeSteps += substeps.load();
+  } else {
+    stepShards(dt);
+  }
+
+  stats.lastStepMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  stats.elapsedMs += stats.lastStepMs;
+}
+
+// 每個分片整段交給自己的節點，節點內再由工作竊取切開
+void SnakeWorld::stepShards(float dt) {
+  struct ShardContext {
+    SnakeWorld* world;
+    int node;
+    float dt;
+    std::atomic<long long> substeps{0};
+    std::atomic<long long> remoteSubsteps{0};
+  };
+  std::vector<ShardContext> contexts(shards.size());
+
+  JobSystem::JobFunction stepRange = [](void* context, int begin, int end) {
+    auto* shard = static_cast<ShardContext*>(context);
+    long long local = 0;
+    for (int i = begin; i < end; ++i) local += shard->world->stepAgent(shard->world->agents[i], shard->dt);
+    shard->substeps.fetch_add(local, std::memory_order_relaxed);
+    if (shard->world->jobs->currentNode() != shard->node) {
+      shard->remoteSubsteps.fetch_add(local, std::memory_order_relaxed);
+    }
+  };
+  JobSystem::Counter counter;
+  for (size_t i = 0; i < shards.size(); ++i) {
+    contexts[i].world = this;
+    contexts[i].node = shards[i].node;
+    contexts[i].dt = dt;
+    jobs->runOnNode(shards[i].node, stepRange, &contexts[i], shards[i].begin, shards[i].end, 64, &counter);
+  }
+  jobs->wait(counter);
+
+  for (size_t i = 0; i < shards.size(); ++i) {
+    long long substeps = contexts[i].substeps.load();
+    stats.snakeSteps += substeps;
+    stats.nodes[i].snakeSteps += substeps;
+    stats.nodes[i].remoteSteps += contexts[i].remoteSubsteps.load();
+  }
+}
+
+// 與 main.cpp 的遊戲迴圈相同：計時 -> 物理 -> 蘋果 -> 撞牆
+long long SnakeWorld::stepAgent(Agent& agent, float dt) {
+  if (agent.state != GameState::RUNNING) return 0;
+
+  agent.timer -= dt;
+  agent.elapsed += dt;
+  if (agent.timer <= 0.0f) {
+    agent.timer = 0.0f;
+    agent.state = GameState::STOPPED;
+    agent.result = agent.score >= rules.winScore ? GameResult::WIN : GameResult::LOSE;
+  }
+
+  if (agent.autopilot) {
+    if (agent.planner) {
+      steerAlongPath(agent);
+    } else {
+      steerTowardApple(agent);
+    }
+  }
+
+  Snake* snake = agent.snake.get();
+  if (hasViewer) snake->updateLod(viewer);
+  int substeps = std::clamp((int)std::ceil(dt / snake->getMaxSubDt()), 1, 30);
+  float dtSub = dt / substeps;
+  for (int s = 0; s < substeps; ++s) {
+    snake->update(dtSub);
+  }
+
+  glm::vec3 head = snake->getHeadPosition();
+  if (glm::length(glm::vec2(head.x - agent.applePosition.x, head.z - agent.applePosition.z)) < rules.appleRadius) {
+    agent.score++;
+    agent.applePosition = randomApplePosition(agent);
+    snake->growTail();
+    if (agent.score >= rules.winScore) {
+      agent.state = GameState::STOPPED;
+      agent.result = GameResult::WIN;
+    }
+  }
+
+  if (agent.state == GameState::RUNNING && hitWall(agent)) {
+    agent.state = GameState::STOPPED;
+    agent.result = GameResult::LOSE;
+    agent.hitWall = true;
+  }
+  return substeps;
+}
+
+// 簡單的自動駕駛：蘋果在左邊就按左，在右邊就按右，一直往前
+void SnakeWorld::steerTowardApple(Agent& agent) {
+  Snake* snake = agent.snake.get();
+  glm::vec3 toApple = agent.applePosition - snake->getHeadPosition();
+  toApple.y = 0.0f;
+  float len = glm::length(toApple);
+  if (len < 0.001f) return;
+  float side = glm::cross(snake->getForwardDirection(), toApple / len).y;
+  snake->setSnakeMoveDirection(0, true);
+  snake->setSnakeMoveDirection(1, side > 0.1f);
+  snake->setSnakeMoveDirection(2, side < -0.1f);
+}
+
+// 規劃的自動駕駛：往路徑上的路點轉，轉向量和偏離的角度成正比；還沒有路時退回上面的簡單版本
+void SnakeWorld::steerAlongPath(Agent& agent) {
+  Snake* snake = agent.snake.get();
+  glm::vec3 waypoint;
+  if (!agent.planner->plan(*snake, agent.applePosition, waypoint)) {
+    snake->setSteering(0.0f, 0.0f);
+    steerTowardApple(agent);
+    return;
+  }
+  glm::vec3 toWaypoint = waypoint - snake->getHeadPosition();
+  toWaypoint.y = 0.0f;
+  float len = glm::length(toWaypoint);
+  if (len < 0.001f) return;
+  float side = glm::cross(snake->getForwardDirection(), toWaypoint / len).y;
+  snake->setSteering(1.0f, std::clamp(-2.0f * side, -1.0f, 1.0f));  // side < 0 表示路點在右邊
+  for (int i = 0; i < 3; ++i) snake->setSnakeMoveDirection(i, false);
+}
+
+glm::vec3 SnakeWorld::randomApplePosition(Agent& agent) {
+  std::uniform_real_distribution<float> distX(rules.appleMargin, rules.arenaWidth - rules.appleMargin);
+  std::uniform_real_distribution<float> distZ(rules.appleMargin, rules.arenaDepth - rules.appleMargin);
+  float x = distX(agent.rng);
+  return glm::vec3(x, rules.appleHeight, distZ(agent.rng));
+}
+
+bool SnakeWorld::hitWall(const Agent& agent) const {
+  glm::vec3 head = agent.snake->getHeadPosition();
+  return head.x < rules.wallMargin || head.x > rules.arenaWidth - rules.wallMargin || head.z < rules.wallMargin ||
+         head.z > rules.arenaDepth - rules.wallMargin;
+}
@@ -0,0 +1,144 @@
+#include "SnapshotRing.h"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+
+#include "Snake.h"
+
+namespace {
+constexpr uint32_t RING_FILE_MAGIC = 0x47524e53;  // "SNRG"
+}
+
+SnapshotRing::SnapshotRing(int capacity, size_t slotBytes)
+    : capacity(std::max(1, capacity)),
+      slotBytes(slotBytes),
+      storage((size_t)this->capacity * slotBytes),
+      ticks(this->capacity, -1),
+      sizes(this->capacity, 0) {}
+
+bool SnapshotRing::record(const Snake& snake, long long tick) {
+  // 同一個或更早的 tick 代表從那裡重新分支，先丟掉之後的紀錄
+  if (count > 0 && tick <= getNewestTick()) truncateAfter(tick - 1);
+
+  int slot = count < capacity ? slotOf(count) : first;
+  size_t written = snake.saveSnapshot(&storage[(size_t)slot * slotBytes], slotBytes);
+  if (written == 0) {
+    std::cout << "[ERROR] Snapshot (" << snake.getSnapshotSize() << " bytes) does not fit in ring slot (" << slotBytes
+              << " bytes)" << std::endl;
+    return false;
+  }
+
+  ticks[slot] = tick;
+  sizes[slot] = written;
+  if (count < capacity) {
+    ++count;
+  } else {
+    first = (first + 1) % capacity;
+  }
+  return true;
+}
+
+int SnapshotRing::find(long long tick) const {
+  // tick 遞增，用二分搜尋
+  int lo = 0, hi = count - 1;
+  while (lo <= hi) {
+    int mid = (lo + hi) / 2;
+    long long t = ticks[slotOf(mid)];
+    if (t == tick) return mid;
+    if (t < tick) {
+      lo = mid + 1;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  return -1;
+}
+
+bool SnapshotRing::restore(Snake& snake, long long tick) const {
+  int index = find(tick);
+  if (index < 0) return false;
+  int slot = slotOf(index);
+  return snake.restoreSnapshot(&storage[(size_t)slot * slotBytes], sizes[slot]);
+}
+
+long long SnapshotRing::rewind(Snake& snake, int ticksBack) {
+  if (count == 0) return -1;
+  int index = std::max(0, count - 1 - std::max(0, ticksBack));
+  int slot = slotOf(index);
+  if (!snake.restoreSnapshot(&storage[(size_t)slot * slotBytes], sizes[slot])) return -1;
+  count = index + 1;
+  return ticks[slot];
+}
+
+void SnapshotRing::truncateAfter(long long tick) {
+  while (count > 0 && getNewestTick() > tick) --count;
+}
+
+bool SnapshotRing::writeFile(const char* filename) const {
+  std::ofstream file(filename, std::ios::binary);
+  if (!file.is_open()) {
+    std::cout << "[ERROR] Can't open snapshot file: " << filename << std::endl;
+    return false;
+  }
+
+  uint32_t magic = RING_FILE_MAGIC;
+  int32_t fileCapacity = capacity, fileCount = count;
+  uint64_t fileSlotBytes = slotBytes;
+  file.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+  file.write(reinterpret_cast<const char*>(&fileCapacity), sizeof(fileCapacity));
+  file.write(reinterpret_cast<const char*>(&fileSlotBytes), sizeof(fileSlotBytes));
+  file.write(reinterpret_cast<const char*>(&fileCount), sizeof(fileCount));
+  for (int i = 0; i < count; ++i) {
+    int slot = slotOf(i);
+    int64_t tick = ticks[slot];
+    uint64_t size = sizes[slot];
+    file.write(reinterpret_cast<const char*>(&tick), sizeof(tick));
+    file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    file.write(reinterpret_cast<const char*>(&storage[(size_t)slot * slotBytes]), size);
+  }
+  return file.good();
+}
+
+SnapshotRing* SnapshotRing::fromFile(const char* filename) {
+  std::ifstream file(filename, std::ios::binary);
+  if (!file.is_open()) {
+    std::cout << "[ERROR] Can't open snapshot file: " << filename << std::endl;
+    return NULL;
+  }
+
+  uint32_t magic = 0;
+  int32_t fileCapacity = 0, fileCount = 0;
+  uint64_t fileSlotBytes = 0;
+  file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+  file.read(reinterpret_cast<char*>(&fileCapacity), sizeof(fileCapacity));
+  file.read(reinterpret_cast<char*>(&fileSlotBytes), sizeof(fileSlotBytes));
+  file.read(reinterpret_cast<char*>(&fileCount), sizeof(fileCount));
+  if (!file || magic != RING_FILE_MAGIC || fileCapacity <= 0 || fileCount < 0 || fileCount > fileCapacity) {
+    std::cout << "[ERROR] Bad snapshot file header: " << filename << std::endl;
+    return NULL;
+  }
+
+  SnapshotRing* ring = new SnapshotRing(fileCapacity, (size_t)fileSlotBytes);
+  for (int i = 0; i < fileCount; ++i) {
+    int64_t tick = 0;
+    uint64_t size = 0;
+    file.read(reinterpret_cast<char*>(&tick), sizeof(tick));
+    file.read(reinterpret_cast<char*>(&size), sizeof(size));
+    if (!file || size > fileSlotBytes) {
+      std::cout << "[ERROR] Truncated snapshot file: " << filename << std::endl;
+      delete ring;
+      return NULL;
+    }
+    file.read(reinterpret_cast<char*>(&ring->storage[(size_t)i * ring->slotBytes]), size);
+    ring->ticks[i] = tick;
+    ring->sizes[i] = size;
+  }
+  if (!file && fileCount > 0) {
+    std::cout << "[ERROR] Truncated snapshot file: " << filename << std::endl;
+    delete ring;
+    return NULL;
+  }
+  ring->count = fileCount;
+  return ring;
+}
@@ -1,10 +1,52 @@
 ﻿#include "Spring.h"
+#include <cmath>
 #include <glm/glm.hpp>
 
+namespace {
+
+/**
+ * 阻尼振盪的封閉解：x'' + 2 * gamma * x' + omega2 * x = 0
+ * 給定 x(0) = x0、x'(0) = v0，回傳 t 時刻的 x 與 x'
+ */
+template <typename Acc>
+void dampedOscillator(Acc x0, Acc v0, Acc omega2, Acc gamma, Acc t, Acc& x, Acc& v) {
+  Acc disc = gamma * gamma - omega2;
+  if (std::abs(disc) <= Acc(1e-6) * omega2) {
+    // 臨界阻尼
+    Acc e = std::exp(-gamma * t);
+    Acc b = v0 + gamma * x0;
+    x = e * (x0 + b * t);
+    v = e * (b - gamma * (x0 + b * t));
+  } else if (disc < 0) {
+    // 欠阻尼
+    Acc wd = std::sqrt(-disc);
+    Acc e = std::exp(-gamma * t);
+    Acc c = std::cos(wd * t);
+    Acc s = std::sin(wd * t);
+    Acc b = (v0 + gamma * x0) / wd;
+    x = e * (x0 * c + b * s);
+    v = e * ((wd * b - gamma * x0) * c - (gamma * b + wd * x0) * s);
+  } else {
+    // 過阻尼，r1 用另一種寫法避免 gamma >> omega 時相減失去精度
+    Acc root = std::sqrt(disc);
+    Acc r1 = -omega2 / (gamma + root);
+    Acc r2 = -gamma - root;
+    Acc a = (v0 - r2 * x0) / (r1 - r2);
+    Acc b = x0 - a;
+    Acc e1 = std::exp(r1 * t);
+    Acc e2 = std::exp(r2 * t);
+    x = a * e1 + b * e2;
+    v = a * r1 * e1 + b * r2 * e2;
+  }
+}
+
+}  // namespace
+
 /**
  * 構造函數
  */
-Spring::Spring(Mass* m1, Mass* m2, float springConstant, float restLength, float dampingConstant)
+template <typename T, typename Acc>
+BasicSpring<T, Acc>::BasicSpring(MassType* m1, MassType* m2, T springConstant, T restLength, T dampingConstant)
     : mass1(m1), mass2(m2), springConstant(springConstant), restLength(restLength), dampingConstant(dampingConstant) {}
 
 /**
@@ -19,38 +61,42 @@ Spring::Spring(Mass* m1, Mass* m2, float springConstant, float restLength, float
  * 3. 計算阻尼力（速度相關部分）
  * 4. 對兩個質點施加相反的力
  */
-void Spring::applyForce() {
+template <typename T, typename Acc>
+void BasicSpring<T, Acc>::applyForce() {
+  using AccVec3 = glm::vec<3, Acc>;
+
   // === 步驟 1：獲取兩個質點的位置和速度 ===
-  glm::vec3 pos1 = mass1->getPosition();
-  glm::vec3 pos2 = mass2->getPosition();
-  glm::vec3 vel1 = mass1->getVelocity();
-  glm::vec3 vel2 = mass2->getVelocity();
+  // 混合精度時先轉成 Acc 再相減
+  AccVec3 pos1 = AccVec3(mass1->getPosition());
+  AccVec3 pos2 = AccVec3(mass2->getPosition());
+  AccVec3 vel1 = AccVec3(mass1->getVelocity());
+  AccVec3 vel2 = AccVec3(mass2->getVelocity());
 
   // === 步驟 2：計算彈簧向量（從質點2指向質點1）===
 
-  glm::vec3 direction = pos1 - pos2;
-  float currentLength = glm::length(direction);
+  AccVec3 direction = pos1 - pos2;
+  Acc currentLength = glm::length(direction);
 
  
-  if (currentLength < 0.0001f) return;
+  if (currentLength < Acc(0.0001)) return;
 
   // === 步驟 3：計算單位方向向量 ===
-  glm::vec3 unitDir = direction / currentLength;
+  AccVec3 unitDir = direction / currentLength;
 
   // === 步驟 4：計算彈簧力（胡克定律）===
   // 公式：F_spring = -k(l - L)
   //
-  float springForceMag = -springConstant * (currentLength - restLength);
+  Acc springForceMag = -Acc(springConstant) * (currentLength - Acc(restLength));
 
   // === 步驟 5：計算阻尼力 ===
   //
   // 
-  glm::vec3 relativeVelocity = vel1 - vel2;
-  float dampingForceMag = -dampingConstant * glm::dot(relativeVelocity, unitDir);
+  AccVec3 relativeVelocity = vel1 - vel2;
+  Acc dampingForceMag = -Acc(dampingConstant) * glm::dot(relativeVelocity, unitDir);
 
   // === 步驟 6：合併彈簧力和阻尼力 ===
-  float totalForceMag = springForceMag + dampingForceMag;
-  glm::vec3 force = unitDir * totalForceMag;
+  Acc totalForceMag = springForceMag + dampingForceMag;
+  AccVec3 force = unitDir * totalForceMag;
 
   // === 步驟 7：對兩個質點施加相反的力 ===
   //
@@ -63,3 +109,49 @@ void Spring::applyForce() {
   mass2->applyForce(-force);
 }
 
+template <typename T, typename Acc>
+T BasicSpring<T, Acc>::beginAnalyticStep(T dt) {
+  using AccVec3 = glm::vec<3, Acc>;
+
+  AccVec3 direction = AccVec3(mass1->getPosition()) - AccVec3(mass2->getPosition());
+  Acc currentLength = glm::length(direction);
+  if (currentLength < Acc(0.0001) || dt <= T(0)) return T(0);
+  AccVec3 unitDir = direction / currentLength;
+
+  Acc m1 = Acc(mass1->getMass());
+  Acc m2 = Acc(mass2->getMass());
+  Acc reducedMass = m1 * m2 / (m1 + m2);
+
+  Acc x0 = currentLength - Acc(restLength);
+  Acc v0 = glm::dot(AccVec3(mass1->getVelocity()) - AccVec3(mass2->getVelocity()), unitDir);
+  Acc x, v;
+  dampedOscillator(x0, v0, Acc(springConstant) / reducedMass, Acc(dampingConstant) / (Acc(2) * reducedMass), Acc(dt),
+                   x, v);
+
+  // 位置積分用的是這一步的平均速度
+  Acc averageVelocity = (x - x0) / Acc(dt);
+  applyAxialImpulse(T(averageVelocity - v0));
+  return T(v - averageVelocity);
+}
+
+template <typename T, typename Acc>
+void BasicSpring<T, Acc>::applyAxialImpulse(T relativeVelocityChange) {
+  using Vec3 = glm::vec<3, T>;
+
+  Vec3 direction = mass1->getPosition() - mass2->getPosition();
+  T currentLength = glm::length(direction);
+  if (currentLength < T(0.0001)) return;
+  Vec3 unitDir = direction / currentLength;
+
+  // 衝量 J = mu * dv，質點 1 得到 J / m1，質點 2 得到 -J / m2
+  T m1 = mass1->getMass();
+  T m2 = mass2->getMass();
+  T total = m1 + m2;
+  mass1->setVelocity(mass1->getVelocity() + unitDir * (relativeVelocityChange * m2 / total));
+  mass2->setVelocity(mass2->getVelocity() - unitDir * (relativeVelocityChange * m1 / total));
+}
+
+// 支援的精度組合
+template class BasicSpring<float>;
+template class BasicSpring<double>;
+template class BasicSpring<float, double>;
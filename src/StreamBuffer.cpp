@@ -0,0 +1,80 @@
+#include "StreamBuffer.h"
+#include <cstring>
+#include <iostream>
+
+StreamBuffer::StreamBuffer(size_t regionSize) : regionSize((regionSize + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT) {
+  const GLsizeiptr total = (GLsizeiptr)(this->regionSize * NUM_REGIONS);
+  glGenBuffers(1, &buffer);
+  glBindBuffer(GL_ARRAY_BUFFER, buffer);
+  if (GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage) {
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(GL_ARRAY_BUFFER, total, nullptr, flags);
+    mapped = static_cast<unsigned char*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, total, flags));
+    if (!mapped) {
+      // buffer storage 之後大小不能再改，映射失敗就換一個普通的 buffer
+      glDeleteBuffers(1, &buffer);
+      glGenBuffers(1, &buffer);
+      glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    }
+  }
+  if (!mapped) glBufferData(GL_ARRAY_BUFFER, total, nullptr, GL_STREAM_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+StreamBuffer::~StreamBuffer() {
+  for (GLsync& fence : fences) {
+    if (fence) glDeleteSync(fence);
+  }
+  if (mapped) {
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+  glDeleteBuffers(1, &buffer);
+}
+
+void StreamBuffer::beginFrame() {
+  region = (region + 1) % NUM_REGIONS;
+  head = 0;
+  if (mapped) {
+    GLsync& fence = fences[region];
+    if (fence) {
+      // 第一次等待要把指令送出去，否則 fence 可能永遠不會到
+      GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+      while (glClientWaitSync(fence, flags, 1000000000) == GL_TIMEOUT_EXPIRED) flags = 0;
+      glDeleteSync(fence);
+      fence = nullptr;
+    }
+  } else if (region == 0) {
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(regionSize * NUM_REGIONS), nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+}
+
+void StreamBuffer::endFrame() {
+  if (!mapped) return;
+  if (fences[region]) glDeleteSync(fences[region]);
+  fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+GLintptr StreamBuffer::upload(const void* data, size_t size) {
+  if (head + size > regionSize) {
+    if (!overflowReported) {
+      std::cout << "[ERROR] StreamBuffer region of " << regionSize << " bytes cannot hold " << head + size
+                << " bytes in one frame" << std::endl;
+      overflowReported = true;
+    }
+    return -1;
+  }
+  const size_t offset = regionSize * region + head;
+  if (mapped) {
+    std::memcpy(mapped + offset, data, size);
+  } else {
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)offset, (GLsizeiptr)size, data);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+  head = (head + size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+  return (GLintptr)offset;
+}
@@ -0,0 +1,211 @@
+#include "VecEnv.h"
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+
+namespace {
+
+const size_t ALIGNMENT = 64;
+
+size_t alignUp(size_t offset) { return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT; }
+
+}  // namespace
+
+VecEnv::Layout VecEnv::getLayout(const Config& config) {
+  size_t n = (size_t)std::max(0, config.numEnvs);
+  size_t observationSize = (size_t)getObservationSize(config);
+  Layout layout;
+  size_t offset = 0;
+  layout.actions = offset;
+  offset = alignUp(offset + n * getActionSize(config.actionMode) * sizeof(float));
+  layout.observations = offset;
+  offset = alignUp(offset + n * observationSize * sizeof(float));
+  layout.rewards = offset;
+  offset = alignUp(offset + n * sizeof(float));
+  layout.terminated = offset;
+  offset = alignUp(offset + n);
+  layout.truncated = offset;
+  offset = alignUp(offset + n);
+  layout.finalObservations = offset;
+  offset = alignUp(offset + n * observationSize * sizeof(float));
+  layout.totalSize = offset;
+  return layout;
+}
+
+VecEnv::VecEnv(const Config& config, JobSystem* jobs)
+    : config(config), world(config.rules, jobs), sensors(config.rays, config.rules) {
+  world.reserve(config.numEnvs);
+  for (int i = 0; i < config.numEnvs; ++i) world.addSnake(config.snake, config.startPos, config.seed + (unsigned int)i);
+  envs.resize(config.numEnvs);
+  if (config.numEnvs > 0) {
+    baseWaveFrequency = world.getSnake(0)->getWaveFrequency();
+    baseWaveAmplitude = world.getSnake(0)->getWaveAmplitude();
+  }
+
+  Layout layout = getLayout(config);
+  ownBlock.resize(layout.totalSize);
+  bindBlock(ownBlock.data(), ownBlock.size());
+}
+
+bool VecEnv::bind(const Buffers& newBuffers) {
+  if (!newBuffers.actions || !newBuffers.observations || !newBuffers.rewards || !newBuffers.terminated ||
+      !newBuffers.truncated) {
+    std::cout << "[ERROR] VecEnv::bind needs actions, observations, rewards, terminated and truncated" << std::endl;
+    return false;
+  }
+  buffers = newBuffers;
+  return true;
+}
+
+bool VecEnv::bindBlock(void* memory, size_t size) {
+  Layout layout = getLayout(config);
+  if (!memory || size < layout.totalSize) {
+    std::cout << "[ERROR] VecEnv needs a block of " << layout.totalSize << " bytes, got " << size << std::endl;
+    return false;
+  }
+  unsigned char* base = static_cast<unsigned char*>(memory);
+  Buffers newBuffers;
+  newBuffers.actions = reinterpret_cast<float*>(base + layout.actions);
+  newBuffers.observations = reinterpret_cast<float*>(base + layout.observations);
+  newBuffers.rewards = reinterpret_cast<float*>(base + layout.rewards);
+  newBuffers.terminated = base + layout.terminated;
+  newBuffers.truncated = base + layout.truncated;
+  newBuffers.finalObservations = reinterpret_cast<float*>(base + layout.finalObservations);
+  return bind(newBuffers);
+}
+
+// ========== 重置與推進 ==========
+
+void VecEnv::reset(const uint8_t* mask) {
+  const int observationSize = getObservationSize();
+  sensors.update(world);
+  for (int i = 0; i < config.numEnvs; ++i) {
+    if (mask && !mask[i]) continue;
+    startEnv(i);
+    writeObservation(i, buffers.observations + (size_t)i * observationSize);
+    buffers.rewards[i] = 0.0f;
+    buffers.terminated[i] = 0;
+    buffers.truncated[i] = 0;
+  }
+}
+
+void VecEnv::step(const float* actions) {
+  if (!actions) actions = buffers.actions;
+  const int actionSize = getActionSize();
+  for (int i = 0; i < config.numEnvs; ++i) {
+    if (envs[i].running) applyAction(i, actions + (size_t)i * actionSize);
+  }
+
+  world.step(config.dt);
+  sensors.update(world);
+
+  // 獎勵、旗標與觀察，結束的環境在這裡直接重置（SnakeWorld::start 只碰自己那條蛇）
+  std::atomic<long long> finished{0};
+  const int observationSize = getObservationSize();
+  world.getJobs().parallelFor(config.numEnvs, 64, [this, &finished, observationSize](int begin, int end) {
+    long long local = 0;
+    for (int i = begin; i < end; ++i) {
+      const SnakeWorld::Agent& agent = world.getAgent(i);
+      EnvState& env = envs[i];
+      float* observation = buffers.observations + (size_t)i * observationSize;
+      if (!env.running) {
+        // 沒有自動重置、結束後還沒被 reset 的環境，旗標保持結束時的值
+        buffers.rewards[i] = 0.0f;
+        continue;
+      }
+
+      float distance = getAppleDistance(i);
+      float reward = 0.0f;
+      if (agent.score > env.score) {
+        reward += config.appleReward * (agent.score - env.score);  // 蘋果換了位置，這一步不算靠近
+      } else {
+        reward += config.approachReward * (env.appleDistance - distance);
+      }
+      if (agent.hitWall) reward -= config.wallPenalty;
+      env.score = agent.score;
+      env.appleDistance = distance;
+      buffers.rewards[i] = reward;
+
+      bool done = agent.state != SnakeWorld::GameState::RUNNING;
+      buffers.truncated[i] = done && !agent.hitWall && agent.timer <= 0.0f;
+      buffers.terminated[i] = done && !buffers.truncated[i];
+      if (!done) {
+        writeObservation(i, observation);
+        continue;
+      }
+
+      ++local;
+      if (buffers.finalObservations) writeObservation(i, buffers.finalObservations + (size_t)i * observationSize);
+      if (config.autoReset) {
+        startEnv(i);
+      } else {
+        env.running = false;
+      }
+      writeObservation(i, observation);
+    }
+    finished.fetch_add(local, std::memory_order_relaxed);
+  });
+  episodes += finished.load();
+}
+
+void VecEnv::startEnv(int index) {
+  world.start(index);
+  applyAction(index, nullptr);
+  envs[index].score = 0;
+  envs[index].appleDistance = getAppleDistance(index);
+  envs[index].running = true;
+}
+
+// ========== 動作與觀察 ==========
+
+// action 為 nullptr 時放開所有輸入
+void VecEnv::applyAction(int index, const float* action) {
+  if (config.actionMode == ActionMode::BUTTONS) {
+    if (action) {
+      world.setInput(index, action[0] > 0.5f, action[1] > 0.5f, action[2] > 0.5f);
+    } else {
+      world.setInput(index, false, false, false);
+    }
+  } else {
+    world.setSteering(index, action ? action[0] : 0.0f, action ? action[1] : 0.0f);
+  }
+  if (config.actionMode == ActionMode::CONTINUOUS_GAIT) {
+    Snake* snake = world.getSnake(index);
+    float frequencyScale = action ? std::clamp(action[2], -0.5f, 0.5f) : 0.0f;
+    float amplitudeScale = action ? std::clamp(action[3], -0.5f, 0.5f) : 0.0f;
+    snake->setWaveFrequency(baseWaveFrequency * (1.0f + frequencyScale));
+    snake->setWaveAmplitude(baseWaveAmplitude * (1.0f + amplitudeScale));
+  }
+}
+
+float VecEnv::getAppleDistance(int index) const {
+  const SnakeWorld::Agent& agent = world.getAgent(index);
+  glm::vec3 toApple = agent.applePosition - agent.snake->getHeadPosition();
+  return glm::length(glm::vec2(toApple.x, toApple.z));
+}
+
+void VecEnv::writeObservation(int index, float* out) const {
+  const SnakeWorld::Agent& agent = world.getAgent(index);
+  const SnakeWorld::Rules& rules = config.rules;
+  const Snake& snake = *agent.snake;
+
+  glm::vec3 head = snake.getHeadPosition();
+  glm::vec3 forward = snake.getForwardDirection();
+  glm::vec3 right = glm::normalize(glm::cross(forward, glm::vec3(0.0f, 1.0f, 0.0f)));
+  glm::vec3 toApple = agent.applePosition - head;
+  toApple.y = 0.0f;
+  float wall = std::min(std::min(head.x, rules.arenaWidth - head.x), std::min(head.z, rules.arenaDepth - head.z));
+
+  out[0] = head.x / rules.arenaWidth;
+  out[1] = head.z / rules.arenaDepth;
+  out[2] = forward.x;
+  out[3] = forward.z;
+  out[4] = glm::dot(toApple, forward);
+  out[5] = glm::dot(toApple, right);
+  out[6] = glm::length(toApple);
+  out[7] = glm::dot(snake.getMasses()[0]->getVelocity(), forward);
+  out[8] = wall;
+  out[9] = rules.winScore > 0 ? (float)agent.score / rules.winScore : 0.0f;
+  out[10] = rules.timeLimit > 0.0f ? agent.timer / rules.timeLimit : 0.0f;
+  sensors.cast(world, index, out + OBSERVATION_SIZE);
+}
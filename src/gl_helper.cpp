@@ -1,8 +1,12 @@
 #include "gl_helper.h"
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <string>
 
+#include "JobSystem.h"
+
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
@@ -88,13 +92,65 @@ GLuint createProgram(GLuint vert, GLuint frag) {
   return prog;
 }
 
+namespace {
+struct DecodedImage {
+  unsigned char* data = NULL;
+  int width = 0;
+  int height = 0;
+  int channels = 0;
+};
+std::map<std::string, DecodedImage> textureCache;
+}  // namespace
+
+void prefetchTextures(const std::vector<std::string>& filenames) {
+  std::vector<std::string> pending;
+  for (const auto& name : filenames) {
+    if (!textureCache.count(name) && std::find(pending.begin(), pending.end(), name) == pending.end()) {
+      pending.push_back(name);
+    }
+  }
+
+  // 每個工作只寫自己的那一格，解碼完再放進 cache
+  std::vector<DecodedImage> images(pending.size());
+  stbi_set_flip_vertically_on_load(true);
+  JobSystem::shared().parallelFor((int)pending.size(), 1, [&](int begin, int end) {
+    for (int i = begin; i < end; ++i) {
+      DecodedImage& img = images[i];
+      img.data = stbi_load(pending[i].c_str(), &img.width, &img.height, &img.channels, 0);
+    }
+  });
+
+  for (size_t i = 0; i < pending.size(); ++i) {
+    if (images[i].data == NULL) {
+      std::cout << "Failed to load texture " << pending[i] << std::endl;
+      continue;
+    }
+    textureCache[pending[i]] = images[i];
+  }
+}
+
+void clearTextureCache() {
+  for (auto& entry : textureCache) stbi_image_free(entry.second.data);
+  textureCache.clear();
+}
+
 GLuint createTexture(const char* filename) {
   GLuint texture;
   int width, height, nrChannels;
-  stbi_set_flip_vertically_on_load(true);
-  unsigned char* data = stbi_load(filename, &width, &height, &nrChannels, 0);
-  if (data == NULL) {
-    std::cout << "Failed to load texture " << filename << std::endl;
+  unsigned char* data;
+  auto cached = textureCache.find(filename);
+  bool fromCache = cached != textureCache.end();
+  if (fromCache) {
+    data = cached->second.data;
+    width = cached->second.width;
+    height = cached->second.height;
+    nrChannels = cached->second.channels;
+  } else {
+    stbi_set_flip_vertically_on_load(true);
+    data = stbi_load(filename, &width, &height, &nrChannels, 0);
+    if (data == NULL) {
+      std::cout << "Failed to load texture " << filename << std::endl;
+    }
   }
 
   glGenTextures(1, &texture);
@@ -107,7 +163,7 @@ GLuint createTexture(const char* filename) {
   glGenerateMipmap(GL_TEXTURE_2D);
   glBindTexture(GL_TEXTURE_2D, 0);
 
-  stbi_image_free(data);
+  if (!fromCache) stbi_image_free(data);
 
   return texture;
 }
@@ -1,4 +1,5 @@
 ﻿#include <algorithm>
+#include <cstddef>
 #include <iostream>
 #include <memory>
 #include <vector>
@@ -23,7 +24,11 @@
 #include "imgui_impl_opengl3.h"
 #include <random> 
 
+#include "JobSystem.h"
+#include "PhysicsThread.h"
 #include "Snake.h"
+#include "SnakeWorld.h"
+#include "StreamBuffer.h"
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -31,9 +36,7 @@
 
 using namespace std;
 int appleModelIndex = -1;
-glm::vec3 applePosition(4.0f, 0.5f, 2.5f);
-bool hitWall = false;
-int score = 0;
+glm::vec3 applePosition(4.0f, 0.5f, 2.5f);  // 目前畫在哪裡，由物理執行緒發佈的狀態更新
 
 const float FLOOR_WIDTH = 8.192f * 1.0f;
 const float FLOOR_DEPTH = 5.12f * 1.0f;
@@ -44,29 +47,31 @@ const float WALL_THICKNESS = 0.2f;
 
 int wallModelIndices[4] = {-1, -1, -1, -1};  // 牆壁 前、後、左、右
 
-bool pause = false;
 
-enum class GameState { STOPPED, RUNNING, PAUSED };
-GameState gameState = GameState::STOPPED;
-
-float gameTimer = 60.0f;  
-float elapsedTime = 0.0f;  
-const int WIN_SCORE = 5;  
-
-// 遊戲結果
-enum class GameResult { NONE, WIN, LOSE };
-GameResult gameResult = GameResult::NONE;
+// 遊戲規則（計時、分數、勝負）在 SnakeWorld 裡，由物理執行緒推進
+const float TIME_LIMIT = 60.0f;
+const int WIN_SCORE = 5;
 
 bool snakeViewMode = false;  //true是蛇視角
 
+// 加速模式：按 T 依序切換模擬速度，0 表示 CPU 能跑多快就多快
+const float TIME_SCALES[] = {1.0f, 10.0f, 100.0f, 1000.0f, 0.0f};
+const int NUM_TIME_SCALES = sizeof(TIME_SCALES) / sizeof(TIME_SCALES[0]);
+int timeScaleIndex = 0;
+const float TURBO_RENDER_HZ = 10.0f;  // 加速時畫面與 ImGui 只更新這麼多次，CPU 留給物理
 
-// 隨機數字生成器
+
+// 隨機數字生成器（蘋果序列的種子）
 std::random_device rd;
-std::mt19937 gen(rd());
 
 // ========== 全域變數 ==========
-Snake* snake = nullptr;
+SnakeWorld* world = nullptr;        // 只有一條蛇：玩家的蛇
+PhysicsThread* physics = nullptr;   // 啟動後只能透過 send() / acquireLatest() 存取 world
+const PhysicsThread::Frame* physicsFrame = nullptr;  // 這一幀要畫的狀態
 int snakeModelIndex = -1;
+FrictionMap* frictionMap = nullptr;  // 場地摩擦貼圖，按 G 切換
+const float PHYSICS_TICK = 1.0f / 120.0f;
+StreamBuffer* streamBuffer = nullptr;  // 每幀變動的頂點資料都從這裡上傳
     /* 12202116 標註為外加的部分，先將這個隱藏退回原本狀態 12211727 此處已無功用
 float simulationTime = 0.0f;
 
@@ -227,16 +232,6 @@ Model* createPlane() {
   return m;
 }
 
-glm::vec3 generateRandomApplePosition() {
-  // 在地板範圍內隨機生成位置
-  float margin = 1.0f;
-  std::uniform_real_distribution<float> distX(margin, FLOOR_WIDTH - margin);
-  std::uniform_real_distribution<float> distZ(margin, FLOOR_DEPTH - margin);
-
-  return glm::vec3(distX(gen), 0.4f, distZ(gen));
-}
-
-
 Model* createApple() {
   Model* m = Model::fromObjectFile("../assets/apple/Apple.obj");
 
@@ -263,76 +258,17 @@ Model* createApple() {
 }
 
 
-void respawnFirstApple() {  //新生一個蘋果
-  applePosition = glm::vec3(3.0f, 0.4f, 3.0f);
-
-  // 更新蘋果的 modelMatrix
-  if (appleModelIndex >= 0 && appleModelIndex < ctx.models.size()) {
+// 把蘋果模型移到 position
+void placeApple(const glm::vec3& position) {
+  applePosition = position;
+  if (appleModelIndex >= 0 && appleModelIndex < (int)ctx.models.size()) {
     Model* apple = ctx.models[appleModelIndex];
     apple->modelMatrix = glm::identity<glm::mat4>();
     apple->modelMatrix = glm::translate(apple->modelMatrix, applePosition);
     apple->modelMatrix = glm::scale(apple->modelMatrix, glm::vec3(0.008f));  // 蘋果大小
   }
-
-  std::cout << "[INFO] Apple respawned at: (" << applePosition.x << ", " << applePosition.z << ")" << std::endl;
 }
 
-
-void respawnApple() { //新生一個蘋果
-  applePosition = generateRandomApplePosition();
-
-  // 更新蘋果的 modelMatrix
-  if (appleModelIndex >= 0 && appleModelIndex < ctx.models.size()) {
-    Model* apple = ctx.models[appleModelIndex];
-    apple->modelMatrix = glm::identity<glm::mat4>();
-    apple->modelMatrix = glm::translate(apple->modelMatrix, applePosition);
-    apple->modelMatrix = glm::scale(apple->modelMatrix, glm::vec3(0.008f));   // 蘋果大小
-  }
-
-  std::cout << "[INFO] Apple respawned at: (" << applePosition.x << ", " << applePosition.z << ")" << std::endl;
-}
-
-void generateSphere(std::vector<float>& positions, std::vector<float>& normals, std::vector<float>& texcoords,
-                    const glm::vec3& center, float radius, int segments = 16, int rings = 12) {
-  // segments: 經度分段數 (水平)
-  // rings: 緯度分段數 (垂直)
-
-  for (int ring = 0; ring <= rings; ++ring) {
-    float theta = ring * M_PI / rings;  // 緯度角度 (0 到 π)
-    float sinTheta = sin(theta);
-    float cosTheta = cos(theta);
-
-    for (int seg = 0; seg <= segments; ++seg) {
-      float phi = seg * 2.0f * M_PI / segments;  // 經度角度 (0 到 2π)
-      float sinPhi = sin(phi);
-      float cosPhi = cos(phi);
-
-      // 計算球面上的點
-      float x = cosPhi * sinTheta;
-      float y = cosTheta;
-      float z = sinPhi * sinTheta;
-
-      // 頂點位置
-      glm::vec3 vertex = center + glm::vec3(x, y, z) * radius;
-      positions.push_back(vertex.x);
-      positions.push_back(vertex.y);
-      positions.push_back(vertex.z);
-
-      // 法線 從中心指向頂點（朝外）
-      normals.push_back(x);
-      normals.push_back(y);
-      normals.push_back(z);
-
-      // 紋理座標
-      float u = (float)seg / segments;
-      float v = (float)ring / rings;
-      texcoords.push_back(u);
-      texcoords.push_back(v);
-    }
-  }
-}
-
-
 Model* createTestBox() {  // 12202131 在隱藏掉外加snake的程式後，用來測試顯示是否有問題 更12202328 已不需要
   Model* m = new Model();
 
@@ -404,91 +340,172 @@ Model* createTestBox() {  // 12202131 在隱藏掉外加snake的程式後，用
 
 
 // ========== 蛇模型 ==========
-Model* createSnakeModelSimple(Snake* snake) {
-  if (!snake) return nullptr;
+// 蛇身是一條連續的管子，完全在 GPU 上產生：每一幀只往 streamBuffer 寫每個質點一個 vec4（位置、半徑），
+// light.vert / shadow.vert 在 tubeSkinned 時透過 texture buffer 讀這些點，沿著中心線擠出一圈一圈的頂點。
+// 網格只有一段（s 從 0 到 1、繞一圈），第 k 個實例畫 s = k - 1 到 k：頭尾兩個實例是半球蓋，中間每個實例一節。
+// 每一段的圈數與每圈的邊數各有幾種，全部事先放進同一組 buffer，每幀依蛇在畫面上的大小挑一組（chooseSnakeLod）
+// 細緻度在 CPU 上挑而不用 tessellation shader：整條蛇每個 pass 只有一次 draw，挑一次就夠，
+// light 與 shadow 兩組 program 也不用各多一對 TCS/TES。這和 GL 版本無關，shader 是 #version 430，
+// OpenGLContext 退回 3.3 時本來就畫不出來。
+const int TUBE_RINGS[] = {1, 2, 4, 8};
+const int TUBE_SIDES[] = {6, 8, 12, 16, 24, 32};
+const int NUM_TUBE_RINGS = sizeof(TUBE_RINGS) / sizeof(TUBE_RINGS[0]);
+const int NUM_TUBE_SIDES = sizeof(TUBE_SIDES) / sizeof(TUBE_SIDES[0]);
+const float TUBE_EDGE_PIXELS = 8.0f;  // 三角形的邊在畫面上大約這麼長
+const GLuint TUBE_TEXTURE_UNIT = 5;   // 0 到 4 給 LightProgram 的貼圖與陰影
+
+struct TubeLod {
+  int rings = 0;
+  int sides = 0;
+  int numIndex = 0;
+  size_t indexOffset = 0;  // 在 ebo 裡的位元組位移
+};
+
+struct SnakeTubeMesh {
+  GLuint vao = 0;
+  GLuint vbo = 0;  // (s, around)，都在 0 到 1
+  GLuint ebo = 0;
+  GLuint centerTexture = 0;  // 整個 streamBuffer 的 texture buffer
+  GLintptr centerOffset = -1;  // 這一幀的質點在 streamBuffer 裡的位置
+  std::vector<TubeLod> lods;   // lods[r * NUM_TUBE_SIDES + s] 是 TUBE_RINGS[r] 圈、TUBE_SIDES[s] 邊
+  int lod = 0;
+  int numCenter = 0;
+  std::vector<glm::vec4> centers;
+};
+
+SnakeTubeMesh snakeMesh;
+
+void createSnakeTubeMesh() {
+  std::vector<float> coords;
+  std::vector<GLushort> indices;
+  for (int r = 0; r < NUM_TUBE_RINGS; ++r) {
+    for (int s = 0; s < NUM_TUBE_SIDES; ++s) {
+      const int rings = TUBE_RINGS[r];
+      const int sides = TUBE_SIDES[s];
+      const int base = (int)coords.size() / 2;
+      for (int ring = 0; ring <= rings; ++ring) {
+        for (int side = 0; side <= sides; ++side) {
+          coords.push_back((float)ring / rings);
+          coords.push_back((float)side / sides);
+        }
+      }
 
-  Model* m = new Model();
-  const auto& masses = snake->getMasses();
-  float radius = snake->getRadius();
+      // s 往尾巴、around 繞 t x n 的方向增加，(i0, i2, i1) 從外面看是逆時針
+      TubeLod lod;
+      lod.rings = rings;
+      lod.sides = sides;
+      lod.indexOffset = indices.size() * sizeof(GLushort);
+      for (int ring = 0; ring < rings; ++ring) {
+        for (int side = 0; side < sides; ++side) {
+          GLushort i0 = (GLushort)(base + ring * (sides + 1) + side);
+          GLushort i1 = (GLushort)(i0 + sides + 1);
+          GLushort i2 = (GLushort)(i1 + 1);
+          GLushort i3 = (GLushort)(i0 + 1);
+          indices.insert(indices.end(), {i0, i2, i1, i0, i3, i2});
+        }
+      }
+      lod.numIndex = (int)(indices.size() - lod.indexOffset / sizeof(GLushort));
+      snakeMesh.lods.push_back(lod);
+    }
+  }
+  snakeMesh.lod = (int)snakeMesh.lods.size() - 1;
 
-  const int segments = 16;
-  const int rings = 12;
+  glGenVertexArrays(1, &snakeMesh.vao);
+  glGenBuffers(1, &snakeMesh.vbo);
+  glGenBuffers(1, &snakeMesh.ebo);
+  glBindVertexArray(snakeMesh.vao);
 
-  std::vector<float> spherePositions;
-  std::vector<float> sphereNormals;
-  std::vector<float> sphereTexcoords;
+  glBindBuffer(GL_ARRAY_BUFFER, snakeMesh.vbo);
+  glBufferData(GL_ARRAY_BUFFER, coords.size() * sizeof(float), coords.data(), GL_STATIC_DRAW);
+  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, 0);
+  glEnableVertexAttribArray(2);
 
-  for (int i = 0; i < (int)masses.size(); ++i) {
-    glm::vec3 pos = masses[i]->getPosition();
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, snakeMesh.ebo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), indices.data(), GL_STATIC_DRAW);
 
-    spherePositions.clear();
-    sphereNormals.clear();
-    sphereTexcoords.clear();
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-    generateSphere(spherePositions, sphereNormals, sphereTexcoords, pos, radius, segments, rings);
+  // StreamBuffer 每次上傳都對齊 16 位元組，剛好是一個 RGBA32F texel，著色器用 tubeBase 找到這一幀的起點
+  glGenTextures(1, &snakeMesh.centerTexture);
+  glBindTexture(GL_TEXTURE_BUFFER, snakeMesh.centerTexture);
+  glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, streamBuffer->getBuffer());
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
 
-    // 調整紋理座標
-    for (size_t j = 0; j < sphereTexcoords.size(); j += 2) {
-      if (i == 0) {
-        sphereTexcoords[j] = sphereTexcoords[j] * 0.5f;
-      } else {
-        sphereTexcoords[j] = 0.5f + sphereTexcoords[j] * 0.5f;
-      }
-    }
+// 由離相機最近的質點算出每公尺佔幾個像素，挑讓每一段、每一圈的邊長都不超過 TUBE_EDGE_PIXELS 的最少圈數與邊數
+void chooseSnakeLod(const Camera& camera) {
+  const std::vector<glm::vec4>& centers = snakeMesh.centers;
+  if (centers.empty()) return;
+  const glm::vec3 eye = glm::make_vec3(camera.getPosition());
+  float nearest = glm::length(glm::vec3(centers[0]) - eye);
+  float length = 0.0f;
+  for (size_t i = 1; i < centers.size(); ++i) {
+    nearest = std::min(nearest, glm::length(glm::vec3(centers[i]) - eye));
+    length += glm::length(glm::vec3(centers[i] - centers[i - 1]));
+  }
+  // 投影矩陣的 [1][1] 是 1 / tan(fovy / 2)
+  const float pixelsPerMeter =
+      0.5f * OpenGLContext::getHeight() * camera.getProjectionMatrix()[5] / std::max(nearest - centers[0].w, 0.01f);
+  const float segmentPixels = (centers.size() > 1 ? length / (centers.size() - 1) : centers[0].w) * pixelsPerMeter;
+  const float circumferencePixels = 2.0f * (float)M_PI * centers[0].w * pixelsPerMeter;
+
+  int r = 0, s = 0;
+  while (r + 1 < NUM_TUBE_RINGS && segmentPixels / TUBE_RINGS[r] > TUBE_EDGE_PIXELS) ++r;
+  while (s + 1 < NUM_TUBE_SIDES && circumferencePixels / TUBE_SIDES[s] > TUBE_EDGE_PIXELS) ++s;
+  snakeMesh.lod = r * NUM_TUBE_SIDES + s;
+}
 
-    // 生成三角形 - 修正繞序為逆時針（CCW）朝外
-    for (int ring = 0; ring < rings; ++ring) {
-      for (int seg = 0; seg < segments; ++seg) {
-        int i0 = ring * (segments + 1) + seg;
-        int i1 = i0 + segments + 1;
-        int i2 = i1 + 1;
-        int i3 = i0 + 1;
-
-        // 三角形 1: i0, i2, i1 (改變順序！)
-        // 從外面看是逆時針
-        for (int idx : {i0, i2, i1}) {
-          m->positions.push_back(spherePositions[idx * 3]);
-          m->positions.push_back(spherePositions[idx * 3 + 1]);
-          m->positions.push_back(spherePositions[idx * 3 + 2]);
-
-          m->normals.push_back(sphereNormals[idx * 3]);
-          m->normals.push_back(sphereNormals[idx * 3 + 1]);
-          m->normals.push_back(sphereNormals[idx * 3 + 2]);
-
-          m->texcoords.push_back(sphereTexcoords[idx * 2]);
-          m->texcoords.push_back(sphereTexcoords[idx * 2 + 1]);
-        }
+// 把物理執行緒發佈的質點位置上傳，畫面與陰影這一幀都用這一份
+void syncSnakeCenters(const PhysicsThread::Frame& frame, const Camera& camera) {
+  const auto& positions = frame.positions;
+  snakeMesh.centers.resize(positions.size());
+  for (size_t i = 0; i < positions.size(); ++i) snakeMesh.centers[i] = glm::vec4(positions[i], frame.radius);
+  snakeMesh.centerOffset =
+      streamBuffer->upload(snakeMesh.centers.data(), snakeMesh.centers.size() * sizeof(glm::vec4));
+  snakeMesh.numCenter = snakeMesh.centerOffset < 0 ? 0 : (int)positions.size();
+  chooseSnakeLod(camera);
+}
 
-        // 三角形 2: i0, i3, i2 (改變順序！)
-        // 從外面看是逆時針
-        for (int idx : {i0, i3, i2}) {
-          m->positions.push_back(spherePositions[idx * 3]);
-          m->positions.push_back(spherePositions[idx * 3 + 1]);
-          m->positions.push_back(spherePositions[idx * 3 + 2]);
+// program 要是 light.vert 或 shadow.vert，呼叫前先 glUseProgram
+void drawSnakeTube(GLuint program) {
+  if (snakeMesh.numCenter == 0) return;
+  glActiveTexture(GL_TEXTURE0 + TUBE_TEXTURE_UNIT);
+  glBindTexture(GL_TEXTURE_BUFFER, snakeMesh.centerTexture);
+  glUniform1i(glGetUniformLocation(program, "tubeCenters"), TUBE_TEXTURE_UNIT);
+  glUniform1i(glGetUniformLocation(program, "tubeBase"), (GLint)(snakeMesh.centerOffset / sizeof(glm::vec4)));
+  glUniform1i(glGetUniformLocation(program, "tubeCount"), snakeMesh.numCenter);
+  glUniform1i(glGetUniformLocation(program, "tubeSkinned"), 1);
+
+  const TubeLod& lod = snakeMesh.lods[snakeMesh.lod];
+  glBindVertexArray(snakeMesh.vao);
+  glDrawElementsInstanced(GL_TRIANGLES, lod.numIndex, GL_UNSIGNED_SHORT, (void*)lod.indexOffset,
+                          snakeMesh.numCenter + 1);
+  glBindVertexArray(0);
 
-          m->normals.push_back(sphereNormals[idx * 3]);
-          m->normals.push_back(sphereNormals[idx * 3 + 1]);
-          m->normals.push_back(sphereNormals[idx * 3 + 2]);
+  glUniform1i(glGetUniformLocation(program, "tubeSkinned"), 0);
+  glActiveTexture(GL_TEXTURE0);
+}
 
-          m->texcoords.push_back(sphereTexcoords[idx * 2]);
-          m->texcoords.push_back(sphereTexcoords[idx * 2 + 1]);
-        }
+// ========== 方向指示器 ==========
+struct DirectionBoxVertex {
+  glm::vec3 position;
+  glm::vec3 normal;
+  glm::vec2 texcoord;
+};
 
-        m->numVertex += 6;
-      }
-    }
-  }
+const int DIRECTION_BOX_VERTICES = 24;  // 6 個面，每面一個 quad
+GLuint directionBoxVao = 0;             // 頂點每幀寫進 streamBuffer，畫的時候才指定位置
 
-  m->textures.push_back(createTexture("../assets/models/snake/snake.jpg"));
-  m->drawMode = GL_TRIANGLES;
-  return m;
+void createDirectionBoxVao() {
+  glGenVertexArrays(1, &directionBoxVao);
+  glBindVertexArray(directionBoxVao);
+  for (int attribute = 0; attribute < 3; ++attribute) glEnableVertexAttribArray(attribute);
+  glBindVertexArray(0);
 }
 
-
-Model* createDirectionBox(const glm::vec3& startPos, const glm::vec3& direction, float length, float width,
-                          float height) {
-  Model* m = new Model();
-
+void fillDirectionBox(const glm::vec3& startPos, const glm::vec3& direction, float length, float width, float height,
+                      DirectionBoxVertex* out) {
   // 根據方向向量來確定長方體頂點
   glm::vec3 v[8];
   glm::vec3 right = glm::normalize(glm::cross(direction, glm::vec3(0, 1, 0)));
@@ -529,31 +546,21 @@ Model* createDirectionBox(const glm::vec3& startPos, const glm::vec3& direction,
   };
 
   // UV坐標
-  for (int f = 0; f < 24; ++f) {
-    glm::vec3 vertex = v[faces[f]];
-    glm::vec3 normal = normals[f / 4];
-
-    float u, vCoord;
-    u = (f % 4 < 2) ? 0.0f : 1.0f;
-    vCoord = (f % 4 == 1 || f % 4 == 2) ? 1.0f : 0.0f;
-
-    m->positions.push_back(vertex.x);
-    m->positions.push_back(vertex.y);
-    m->positions.push_back(vertex.z);
-
-    m->normals.push_back(normal.x);
-    m->normals.push_back(normal.y);
-    m->normals.push_back(normal.z);
-
-    m->texcoords.push_back(u);
-    m->texcoords.push_back(vCoord);
+  for (int f = 0; f < DIRECTION_BOX_VERTICES; ++f) {
+    float u = (f % 4 < 2) ? 0.0f : 1.0f;
+    float vCoord = (f % 4 == 1 || f % 4 == 2) ? 1.0f : 0.0f;
+    out[f] = {v[faces[f]], normals[f / 4], glm::vec2(u, vCoord)};
   }
+}
 
-  m->numVertex = 24;
-  m->drawMode = GL_QUADS;
-  
-  m->textures.push_back(createTexture("../assets/models/snake/snake.jpg"));
+// 模型本身只留貼圖，頂點都在著色器裡產生；蛇和方向指示器的 VAO 都在這裡建立，之後每幀只上傳資料
+Model* createSnakeModelSimple() {
+  Model* m = new Model();
+  createSnakeTubeMesh();
+  createDirectionBoxVao();
 
+  m->textures.push_back(createTexture("../assets/models/snake/snake.jpg"));
+  m->drawMode = GL_TRIANGLES;
   return m;
 }
 
@@ -632,10 +639,33 @@ Model* initializeSnake() {
   // 起始位置在地板中央
   glm::vec3 startPos(FLOOR_CENTER_X, 0.5f, FLOOR_CENTER_Z);
 
-  // 參數：節數, 質量, 每段長度, 彈簧常數, 阻尼, 起始位置, 半徑
-  snake = new Snake(7, 0.020f, 0.178f, 1.0f, 3.5f, startPos, 0.2f);  // 12210456 i change k to 1.0f from 0.5f
+  SnakeWorld::Rules rules;
+  rules.arenaWidth = FLOOR_WIDTH;
+  rules.arenaDepth = FLOOR_DEPTH;
+  rules.timeLimit = TIME_LIMIT;
+  rules.winScore = WIN_SCORE;
+  world = new SnakeWorld(rules);
 
-  Model* snakeModel = createSnakeModelSimple(snake);
+  // 參數：節數, 質量, 每段長度, 彈簧常數, 阻尼, 起始位置, 半徑
+  SnakeWorld::SnakeParams params;
+  params.numSegments = 7;
+  params.segmentMass = 0.020f;
+  params.segmentLength = 0.178f;
+  params.springK = 1.0f;  // 12210456 i change k to 1.0f from 0.5f
+  params.damping = 3.5f;
+  params.radius = 0.2f;
+  int index = world->addSnake(params, startPos, rd());
+  Snake* snake = world->getSnake(index);
+  std::cout << "Snake created with " << snake->getNumSegments() << " segments" << std::endl;
+  snake->setObserved(true);  // 玩家的蛇一直在畫面上，永遠用完整模擬
+
+  // 摩擦貼圖不需要重新編譯，改 assets/friction/arena.fmap 即可
+  frictionMap = FrictionMap::fromFile("../assets/friction/arena.fmap");
+
+  // 物理執行緒在所有東西都準備好後才 start()，在那之前可以直接讀第一份狀態
+  physics = new PhysicsThread(world, index, PHYSICS_TICK, frictionMap);
+  physicsFrame = &physics->acquireLatest();
+  Model* snakeModel = createSnakeModelSimple();
 
   // ctx.models.push_back(snakeModel); // 12202326 我想將他移到統一的地方，所以先試著註解掉
   // snakeModelIndex = ctx.models.size() - 1; // 12202326 我想將他移到統一的地方，所以先試著註解掉
@@ -646,124 +676,6 @@ Model* initializeSnake() {
 
 
 
-// ========== 蛇更新 ==========
-
-void updateSnake(float dtFrame) {
-  if (!snake || snakeModelIndex < 0 || snakeModelIndex >= ctx.models.size()) {
-    return;
-  }
-
-  const float maxSubDt = 0.002f;
-  int substeps = (int)std::ceil(dtFrame / maxSubDt);
-  if (substeps < 1) substeps = 1;
-  if (substeps > 30) {
-    std::cerr << "[WARNING] Too many substeps: " << substeps << std::endl;
-    substeps = 30;
-  }
-
-  float dtSub = dtFrame / substeps;
-
-  for (int s = 0; s < substeps; ++s) {
-    snake->update(dtSub);
-  }
-
-  Model* model = ctx.models[snakeModelIndex];
-
-  model->positions.clear();
-  model->normals.clear();
-  model->texcoords.clear();
-  model->numVertex = 0;
-
-  const auto& masses = snake->getMasses();
-  float radius = snake->getRadius();
-
-  const int segments = 16;
-  const int rings = 12;
-
-  std::vector<float> spherePositions;
-  std::vector<float> sphereNormals;
-  std::vector<float> sphereTexcoords;
-
-  for (int i = 0; i < (int)masses.size(); ++i) {
-    glm::vec3 pos = masses[i]->getPosition();
-
-    spherePositions.clear();
-    sphereNormals.clear();
-    sphereTexcoords.clear();
-
-    generateSphere(spherePositions, sphereNormals, sphereTexcoords, pos, radius, segments, rings);
-
-    for (size_t j = 0; j < sphereTexcoords.size(); j += 2) {
-      if (i == 0) {
-        sphereTexcoords[j] = sphereTexcoords[j] * 0.5f;
-      } else {
-        sphereTexcoords[j] = 0.5f + sphereTexcoords[j] * 0.5f;
-      }
-    }
-
-    // 生成三角形 - 使用修正後的繞序
-    for (int ring = 0; ring < rings; ++ring) {
-      for (int seg = 0; seg < segments; ++seg) {
-        int i0 = ring * (segments + 1) + seg;
-        int i1 = i0 + segments + 1;
-        int i2 = i1 + 1;
-        int i3 = i0 + 1;
-
-        // 三角形 1: i0, i2, i1 (逆時針朝外)
-        for (int idx : {i0, i2, i1}) {
-          model->positions.insert(model->positions.end(), {spherePositions[idx * 3], spherePositions[idx * 3 + 1],
-                                                           spherePositions[idx * 3 + 2]});
-
-          model->normals.insert(model->normals.end(),
-                                {sphereNormals[idx * 3], sphereNormals[idx * 3 + 1], sphereNormals[idx * 3 + 2]});
-
-          model->texcoords.insert(model->texcoords.end(), {sphereTexcoords[idx * 2], sphereTexcoords[idx * 2 + 1]});
-        }
-
-        // 三角形 2: i0, i3, i2 (逆時針朝外)
-        for (int idx : {i0, i3, i2}) {
-          model->positions.insert(model->positions.end(), {spherePositions[idx * 3], spherePositions[idx * 3 + 1],
-                                                           spherePositions[idx * 3 + 2]});
-
-          model->normals.insert(model->normals.end(),
-                                {sphereNormals[idx * 3], sphereNormals[idx * 3 + 1], sphereNormals[idx * 3 + 2]});
-
-          model->texcoords.insert(model->texcoords.end(), {sphereTexcoords[idx * 2], sphereTexcoords[idx * 2 + 1]});
-        }
-
-        model->numVertex += 6;
-      }
-    }
-  }
-}
-// 檢測蛇頭是否碰到蘋果
-bool checkAppleCollision() {
-  if (!snake || appleModelIndex < 0) return false;
-
-  glm::vec3 headPos = snake->getHeadPosition();
-  float distance = glm::length(glm::vec2(headPos.x - applePosition.x, headPos.z - applePosition.z));
-
-  float collisionRadius = 0.5f;  // 碰撞半徑待確認
-  return distance < collisionRadius;
-}
-
-// 檢測蛇頭是否撞牆
-bool checkWallCollision() {
-  if (!snake) return false;
-
-  glm::vec3 headPos = snake->getHeadPosition();
-  float margin = 0.3f;  // 碰撞半徑待確認
-
-  if (headPos.x < margin || headPos.x > FLOOR_WIDTH - margin || headPos.z < margin ||
-      headPos.z > FLOOR_DEPTH - margin) {
-    return true;
-  }
-  return false;
-}
-
-
-
-
 // ========== 載入模型 ==========
 void loadModels() {
   // 地板 (index 0)
@@ -844,7 +756,7 @@ void setupObjects() {
 
 // ========== 渲染蛇 ==========
 void renderSnake() {
-  if (!snake || snakeModelIndex < 0 || snakeModelIndex >= ctx.models.size()) {
+  if (!physicsFrame || snakeModelIndex < 0 || snakeModelIndex >= (int)ctx.models.size()) {
     return;
   }
 
@@ -853,6 +765,7 @@ void renderSnake() {
 
   glm::mat4 modelMatrix = glm::identity<glm::mat4>();
   glUniformMatrix4fv(glGetUniformLocation(program, "ModelMatrix"), 1, GL_FALSE, glm::value_ptr(modelMatrix));
+  glUniformMatrix4fv(glGetUniformLocation(program, "TIModelMatrix"), 1, GL_FALSE, glm::value_ptr(modelMatrix));
 
   glUniform3fv(glGetUniformLocation(program, "material.ambient"), 1, glm::value_ptr(mFlatwhite.ambient));
   glUniform3fv(glGetUniformLocation(program, "material.diffuse"), 1, glm::value_ptr(mFlatwhite.diffuse));
@@ -863,57 +776,20 @@ void renderSnake() {
   glBindTexture(GL_TEXTURE_2D, ctx.models[snakeModelIndex]->textures[0]);
   glUniform1i(glGetUniformLocation(program, "ourTexture"), 0);
 
-  std::vector<float> positions = ctx.models[snakeModelIndex]->positions;
-  std::vector<float> norms = ctx.models[snakeModelIndex]->normals;
-  std::vector<float> texcoords = ctx.models[snakeModelIndex]->texcoords;
-
-  GLuint vao, vbo[3];
-  glGenVertexArrays(1, &vao);
-  glGenBuffers(3, vbo);
-
-  glBindVertexArray(vao);
-
-  glBindBuffer(GL_ARRAY_BUFFER, vbo[0]);
-  glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(float), positions.data(), GL_DYNAMIC_DRAW);
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-  glEnableVertexAttribArray(0);
-
-  glBindBuffer(GL_ARRAY_BUFFER, vbo[1]);
-  glBufferData(GL_ARRAY_BUFFER, norms.size() * sizeof(float), norms.data(), GL_DYNAMIC_DRAW);
-  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
-  glEnableVertexAttribArray(1);
-
-  glBindBuffer(GL_ARRAY_BUFFER, vbo[2]);
-  glBufferData(GL_ARRAY_BUFFER, texcoords.size() * sizeof(float), texcoords.data(), GL_DYNAMIC_DRAW);
-  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, 0);
-  glEnableVertexAttribArray(2);
-
-  // 改用 GL_TRIANGLES 繪製！
-  glDrawArrays(GL_TRIANGLES, 0, ctx.models[snakeModelIndex]->numVertex);
-
-  glBindVertexArray(0);
+  drawSnakeTube(program);
   glBindTexture(GL_TEXTURE_2D, 0);
-  glDeleteVertexArrays(1, &vao);
-  glDeleteBuffers(3, vbo);
   
     // --- 渲染長方體 --- 12211730 debug用 還在修正
     // 假設你的長方體已經建立並加入至模型
   // --- 渲染方向指示器 ---
-  if (glm::length(snake->getForwardDirection()) >= 0.001f) {
-    // 從第二個質點（身體）出發，不穿過頭
-    const auto& masses = snake->getMasses();
-    glm::vec3 startPos;
-    if (masses.size() >= 2) {
-      startPos = masses[0]->getPosition();  // 從第二節身體出發
-    } else {
-      startPos = snake->getHeadPosition();
-    }
-
-    glm::vec3 direction = -snake->getForwardDirection();
+  if (glm::length(physicsFrame->forwardDirection) >= 0.001f && !physicsFrame->positions.empty()) {
+    glm::vec3 startPos = physicsFrame->positions[0];  // 從頭出發
 
     // 參數：起點, 方向, 長度, 寬度, 高度
     // 長度短一點 (0.15), 寬度是原本兩倍 (0.04)
-    Model* boxModel = createDirectionBox(startPos, snake->getForwardDirection(), 0.3f, 0.04f, 0.02f);
+    DirectionBoxVertex box[DIRECTION_BOX_VERTICES];
+    fillDirectionBox(startPos, physicsFrame->forwardDirection, 0.3f, 0.04f, 0.02f, box);
+    const GLintptr offset = streamBuffer->upload(box, sizeof(box));
 
     glUseProgram(program);
 
@@ -931,72 +807,35 @@ void renderSnake() {
     glUniform3fv(glGetUniformLocation(program, "material.specular"), 1, glm::value_ptr(redSpecular));
     glUniform1f(glGetUniformLocation(program, "material.shininess"), redShininess);
 
+    // 和蛇用同一張貼圖
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, boxModel->textures[0]);
+    glBindTexture(GL_TEXTURE_2D, ctx.models[snakeModelIndex]->textures[0]);
     glUniform1i(glGetUniformLocation(program, "ourTexture"), 0);
 
-    std::vector<float> boxPositions = boxModel->positions;
-    std::vector<float> boxNormals = boxModel->normals;
-    std::vector<float> boxTexcoords = boxModel->texcoords;
-
-    GLuint boxVAO, boxVBO[3];
-    glGenVertexArrays(1, &boxVAO);
-    glGenBuffers(3, boxVBO);
-
-    glBindVertexArray(boxVAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, boxVBO[0]);
-    glBufferData(GL_ARRAY_BUFFER, boxPositions.size() * sizeof(float), boxPositions.data(), GL_DYNAMIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(0);
-
-    glBindBuffer(GL_ARRAY_BUFFER, boxVBO[1]);
-    glBufferData(GL_ARRAY_BUFFER, boxNormals.size() * sizeof(float), boxNormals.data(), GL_DYNAMIC_DRAW);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(1);
-
-    glBindBuffer(GL_ARRAY_BUFFER, boxVBO[2]);
-    glBufferData(GL_ARRAY_BUFFER, boxTexcoords.size() * sizeof(float), boxTexcoords.data(), GL_DYNAMIC_DRAW);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(2);
-
-    glDrawArrays(GL_QUADS, 0, boxModel->numVertex);
-
-    glBindVertexArray(0);
+    if (offset >= 0) {
+      const GLsizei stride = sizeof(DirectionBoxVertex);
+      glBindVertexArray(directionBoxVao);
+      glBindBuffer(GL_ARRAY_BUFFER, streamBuffer->getBuffer());
+      glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)(offset + offsetof(DirectionBoxVertex, position)));
+      glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(offset + offsetof(DirectionBoxVertex, normal)));
+      glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(offset + offsetof(DirectionBoxVertex, texcoord)));
+      glDrawArrays(GL_QUADS, 0, DIRECTION_BOX_VERTICES);
+      glBindVertexArray(0);
+    }
     glBindTexture(GL_TEXTURE_2D, 0);
-    glDeleteVertexArrays(1, &boxVAO);
-    glDeleteBuffers(3, boxVBO);
-
-    delete boxModel;  // 記得釋放記憶體！
   }
   //glEnable(GL_CULL_FACE);
 }
 
 void renderSnakeShadow(GLuint shadowProgram) {
-  if (!snake || snakeModelIndex < 0 || snakeModelIndex >= ctx.models.size()) {
+  if (!physicsFrame || snakeModelIndex < 0 || snakeModelIndex >= (int)ctx.models.size()) {
     return;
   }
 
   glm::mat4 snakeModelMatrix = glm::identity<glm::mat4>();
   glUniformMatrix4fv(glGetUniformLocation(shadowProgram, "ModelMatrix"), 1, GL_FALSE, glm::value_ptr(snakeModelMatrix));
 
-  std::vector<float>& positions = ctx.models[snakeModelIndex]->positions;
-
-  GLuint snakeVAO, snakeVBO;
-  glGenVertexArrays(1, &snakeVAO);
-  glGenBuffers(1, &snakeVBO);
-
-  glBindVertexArray(snakeVAO);
-  glBindBuffer(GL_ARRAY_BUFFER, snakeVBO);
-  glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(float), positions.data(), GL_DYNAMIC_DRAW);
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-  glEnableVertexAttribArray(0);
-
-  glDrawArrays(GL_TRIANGLES, 0, ctx.models[snakeModelIndex]->numVertex);
-
-  glBindVertexArray(0);
-  glDeleteVertexArrays(1, &snakeVAO);
-  glDeleteBuffers(1, &snakeVBO);
+  drawSnakeTube(shadowProgram);
 }
 
 
@@ -1013,7 +852,14 @@ int main() {
   ctx.window = window;
 
   loadMaterial();
+  // 先平行解碼所有貼圖，loadModels 裡的 createTexture 只剩上傳
+  prefetchTextures({"../assets/models/Wood_maps/AT_Wood.jpg", "../assets/apple/Apple_BaseColor.png",
+                    "../assets/models/snake/snake.jpg"});
+  streamBuffer = new StreamBuffer();
+  std::cout << "[INFO] Stream buffer: " << (streamBuffer->isPersistent() ? "persistent mapped" : "glBufferSubData")
+            << std::endl;
   loadModels();
+  clearTextureCache();
   loadPrograms();
   // initializeSnake(); 12202116 標註為外加的部分，先將這個隱藏退回原本狀態 更12202336 已移到 loadModels 裡面
   setupObjects();
@@ -1030,16 +876,35 @@ int main() {
 
   int frameCount = 0;
   float fpsTimer = 0.0f;
+  float lastRenderTime = lastTime;
+  double lastSimTime = 0.0;
+  float measuredSimSpeed = 0.0f;  // 實際量到的模擬秒數 / 牆鐘秒數
+
+  physics->start();
 
 
   
   while (!glfwWindowShouldClose(window)) {
     glfwPollEvents();
+
+    // 加速模式下，還沒到下一次要畫的時間就只等事件
+    if (timeScaleIndex != 0) {
+      float wait = lastRenderTime + 1.0f / TURBO_RENDER_HZ - (float)glfwGetTime();
+      if (wait > 0.0f) {
+        glfwWaitEventsTimeout(wait);
+        continue;
+      }
+    }
+    lastRenderTime = (float)glfwGetTime();
    
-    if (snakeViewMode && snake) {
+    // 拿物理執行緒最新發佈的狀態，這一幀的相機、模型與介面都用這一份
+    const PhysicsThread::Frame& frame = physics->acquireLatest();
+    physicsFrame = &frame;
+
+    if (snakeViewMode && !frame.positions.empty()) {
       // 蛇視角模式
-      glm::vec3 headPos = snake->getHeadPosition();
-      glm::vec3 forwardDir = snake->getForwardDirection();
+      glm::vec3 headPos = frame.positions[0];
+      glm::vec3 forwardDir = frame.forwardDirection;
 
       if (glm::length(forwardDir) < 0.001f) {
         forwardDir = glm::vec3(0, 0, -1);
@@ -1071,17 +936,19 @@ int main() {
     fpsTimer += deltaTime;
     if (fpsTimer >= 1.0f) {
       float fps = frameCount / fpsTimer;
+      measuredSimSpeed = (float)((frame.simTime - lastSimTime) / fpsTimer);
+      lastSimTime = frame.simTime;
       std::cout << "[FPS] " << fps << std::endl;
-      if (fps < 30.0f) {
+      if (fps < 30.0f && timeScaleIndex == 0) {
         std::cerr << "[WARNING] Low FPS detected!" << std::endl;
       }
       frameCount = 0;
       fpsTimer = 0.0f;
     }
 
-    // **限制極端 deltaTime**
+    // **限制極端 deltaTime**（加速模式本來就很久才畫一次）
     if (deltaTime > 0.05f) {
-      std::cerr << "[WARNING] Large frame time: " << deltaTime << std::endl;
+      if (timeScaleIndex == 0) std::cerr << "[WARNING] Large frame time: " << deltaTime << std::endl;
       deltaTime = 0.05f;
     }
     // 蛇控制
@@ -1122,85 +989,27 @@ int main() {
     }
     */
     
-    if (gameState == GameState::RUNNING) {
-      // 更新計時器
-      gameTimer -= deltaTime;
-      elapsedTime += deltaTime;
-
-      // 時間到
-      if (gameTimer <= 0.0f) {
-        gameTimer = 0.0f;
-        gameState = GameState::STOPPED;
-        if (score >= WIN_SCORE) {
-          gameResult = GameResult::WIN;
-        } else {
-          gameResult = GameResult::LOSE;
-        }
-        std::cout << "[INFO] Time's up!" << std::endl;
-      }
-
-      // 更新蛇
-      updateSnake(deltaTime);
-
-      // 檢測蘋果碰撞
-      if (checkAppleCollision()) {
-        score++;
-        std::cout << "[SCORE] Ate an apple! Score: " << score << std::endl;
-        respawnApple();
-
-        for (auto& obj : ctx.objects) {
-          if (obj->modelIndex == appleModelIndex) {
-            obj->transformMatrix = glm::identity<glm::mat4>();
-          }
-        }
-
-        // 檢查是否贏了
-        if (score >= WIN_SCORE) {
-          gameState = GameState::STOPPED;
-          gameResult = GameResult::WIN;
-          std::cout << "[INFO] You Win!" << std::endl;
-        }
-      }
-
-      // 檢測牆壁碰撞
-      if (checkWallCollision()) {
-        if (!hitWall) {
-          hitWall = true;
-          gameState = GameState::STOPPED;
-          gameResult = GameResult::LOSE;
-          std::cout << "[WARNING] Hit the wall! Game Over!" << std::endl;
-        }
-      }
-    } else {
-      // 遊戲暫停或停止時，仍然渲染蛇（但不更新物理）
-      // 不呼叫 updateSnake
-    }
-
-
-
-    if (checkAppleCollision()) {
-      score++;
-      std::cout << "[SCORE] Ate an apple! Score: " << score << std::endl;
-      respawnApple();
-
-      // 更新蘋果的 Object transform
-      for (auto& obj : ctx.objects) {
-        if (obj->modelIndex == appleModelIndex) {
-          obj->transformMatrix = glm::identity<glm::mat4>();
-        }
-      }
+    // 遊戲邏輯都在物理執行緒，這裡只把結果同步到畫面
+    streamBuffer->beginFrame();
+    syncSnakeCenters(frame, camera);
+    if (frame.applePosition != applePosition) placeApple(frame.applePosition);
+
+    static int lastScore = 0;
+    static SnakeWorld::GameState lastState = SnakeWorld::GameState::STOPPED;
+    if (frame.score > lastScore) {
+      std::cout << "[SCORE] Ate an apple! Score: " << frame.score << std::endl;
     }
-
-    // 檢測牆壁碰撞
-    if (checkWallCollision()) {
-      if (!hitWall) {
-        hitWall = true;
-        std::cout << "[WARNING] Hit the wall!" << std::endl;
-        // 待加入遊戲結束邏輯
+    if (frame.state == SnakeWorld::GameState::STOPPED && lastState == SnakeWorld::GameState::RUNNING) {
+      if (frame.result == SnakeWorld::GameResult::WIN) {
+        std::cout << "[INFO] You Win!" << std::endl;
+      } else if (frame.hitWall) {
+        std::cout << "[WARNING] Hit the wall! Game Over!" << std::endl;
+      } else {
+        std::cout << "[INFO] Time's up!" << std::endl;
       }
-    } else {
-      hitWall = false;  // 離開牆壁後重置
     }
+    lastScore = frame.score;
+    lastState = frame.state;
 
     
     //glDisable(GL_CULL_FACE); // 12210216這個我不太懂，但我覺得應該沒差？
@@ -1222,8 +1031,8 @@ int main() {
       glUniformMatrix4fv(glGetUniformLocation(shadowProgram, "lightSpaceMatrix"), 1, GL_FALSE,
                          glm::value_ptr(ctx.lightSpaceMatrix));
 
+      renderSnakeShadow(shadowProgram);
       for (auto& obj : ctx.objects) {
-        renderSnakeShadow(shadowProgram);
         //if (obj->modelIndex == snakeModelIndex) continue; 12202116 標註為外加的部分，先將這個隱藏退回原本狀態
         Model* model = ctx.models[obj->modelIndex];
         glm::mat4 modelMatrix = obj->transformMatrix * model->modelMatrix;
@@ -1339,6 +1148,7 @@ int main() {
     }
     
     renderSnake();
+    streamBuffer->endFrame();
     /*
     // ImGui
     glDisable(GL_CULL_FACE);
@@ -1358,12 +1168,15 @@ int main() {
       ImGui::Separator();
 
       // 根據遊戲狀態顯示不同內容
-      if (gameState == GameState::STOPPED && gameResult == GameResult::NONE) {
+      const int score = frame.score;
+      const float gameTimer = frame.timer;
+      const bool running = frame.state == SnakeWorld::GameState::RUNNING;
+      if (frame.state == SnakeWorld::GameState::STOPPED && frame.result == SnakeWorld::GameResult::NONE) {
         // 遊戲尚未開始
         ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "Press P to Start!");
         ImGui::Text("Collect %d apples to win!", WIN_SCORE);
-        ImGui::Text("Time limit: 60 seconds");
-      } else if (gameState == GameState::RUNNING) {
+        ImGui::Text("Time limit: %d seconds", (int)TIME_LIMIT);
+      } else if (running && !frame.paused) {
         // 遊戲進行中
         ImGui::TextColored(ImVec4(0.0f, 1.0f, 0.0f, 1.0f), "GAME RUNNING");
 
@@ -1373,9 +1186,9 @@ int main() {
         ImGui::Text("Time: %d:%02d", minutes, seconds);
 
         // 進度條
-        float progress = gameTimer / 60.0f;
+        float progress = gameTimer / TIME_LIMIT;
         ImGui::ProgressBar(progress, ImVec2(-1, 0), "");
-      } else if (gameState == GameState::PAUSED) {
+      } else if (running) {
         // 遊戲暫停
         ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "PAUSED");
         ImGui::Text("Press P to Resume");
@@ -1395,14 +1208,14 @@ int main() {
       ImGui::ProgressBar(scoreProgress, ImVec2(-1, 0), "");
 
       // ===== 遊戲結果顯示 =====
-      if (gameResult == GameResult::WIN) {
+      if (frame.result == SnakeWorld::GameResult::WIN) {
         ImGui::Separator();
         ImGui::TextColored(ImVec4(0.0f, 1.0f, 0.0f, 1.0f), "*** YOU WIN! ***");
         ImGui::Text("Final Score: %d", score);
         ImGui::Text("Press P to Play Again");
-      } else if (gameResult == GameResult::LOSE) {
+      } else if (frame.result == SnakeWorld::GameResult::LOSE) {
         ImGui::Separator();
-        if (hitWall) {
+        if (frame.hitWall) {
           ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "*** YOU LOSE! ***");
           ImGui::TextColored(ImVec4(1.0f, 0.5f, 0.0f, 1.0f), "Hit the wall!");
         } else {
@@ -1417,6 +1230,16 @@ int main() {
 
       // ===== 蘋果位置（debug 用）=====
       ImGui::Text("Apple: (%.1f, %.1f)", applePosition.x, applePosition.z);
+      ImGui::Text("Friction map: %s", frame.frictionMapOn ? "ON" : "OFF");
+      const TubeLod& tubeLod = snakeMesh.lods[snakeMesh.lod];
+      ImGui::Text("Snake mesh: %d rings x %d sides per segment", tubeLod.rings, tubeLod.sides);
+      ImGui::Text("Spring integrator: %s",
+                  frame.springIntegrator == Snake::SpringIntegrator::ANALYTIC ? "ANALYTIC" : "EXPLICIT");
+      if (frame.timeScale > 0.0f) {
+        ImGui::Text("Speed: x%.0f (measured x%.1f)", frame.timeScale, measuredSimSpeed);
+      } else {
+        ImGui::Text("Speed: MAX (measured x%.1f)", measuredSimSpeed);
+      }
 
       // ===== 控制說明 =====
       ImGui::Separator();
@@ -1425,6 +1248,10 @@ int main() {
       ImGui::BulletText("I: Forward");
       ImGui::BulletText("J/L: Turn Left/Right");
       ImGui::BulletText("M: Switch Movement Mode");
+      ImGui::BulletText("G: Toggle Friction Map");
+      ImGui::BulletText("H: Toggle Spring Integrator");
+      ImGui::BulletText("R: Rewind 1 Second");
+      ImGui::BulletText("T: Cycle Simulation Speed");
       ImGui::BulletText("F1: Toggle Cursor");
 
       ImGui::End();
@@ -1441,6 +1268,12 @@ int main() {
   }
 
   // 清理
+  physics->stop();
+  physicsFrame = nullptr;
+  delete physics;
+  delete world;
+  delete frictionMap;  // 蛇還指著它，要在 world 之後
+  delete streamBuffer;
   ImGui_ImplOpenGL3_Shutdown();
   ImGui_ImplGlfw_Shutdown();
   ImGui::DestroyContext();
@@ -1458,31 +1291,15 @@ void keyCallback(GLFWwindow* window, int key, int, int action, int) {
     switch (key) {
       case GLFW_KEY_P: {
         // P 鍵：開始/暫停/重新開始
-        if (gameState == GameState::STOPPED) {
-          // 重置遊戲
-          gameState = GameState::RUNNING;
-          gameResult = GameResult::NONE;
-          gameTimer = 60.0f;
-          elapsedTime = 0.0f;
-          score = 0;
-          hitWall = false;
-
-          // 重置蛇位置
-          if (snake) {
-            snake->reset();
-          }
-
-          // 重置蘋果位置
-          respawnFirstApple();
-
+        const PhysicsThread::Frame& frame = *physicsFrame;
+        if (frame.state == SnakeWorld::GameState::STOPPED) {
+          physics->send({PhysicsThread::Command::Type::START});
           std::cout << "[INFO] Game Started!" << std::endl;
-        } else if (gameState == GameState::RUNNING) {
-          // 暫停
-          gameState = GameState::PAUSED;
+        } else if (!frame.paused) {
+          physics->send({PhysicsThread::Command::Type::PAUSE});
           std::cout << "[INFO] Game Paused" << std::endl;
-        } else if (gameState == GameState::PAUSED) {
-          // 繼續
-          gameState = GameState::RUNNING;
+        } else {
+          physics->send({PhysicsThread::Command::Type::RESUME});
           std::cout << "[INFO] Game Resumed" << std::endl;
         }
         break;
@@ -1514,36 +1331,61 @@ void keyCallback(GLFWwindow* window, int key, int, int action, int) {
       }
 
       case GLFW_KEY_M: {
-        if (snake) {
-          if (snake->getMode() == Snake::MovementMode::LATERAL) {
-            snake->setMovementMode(Snake::MovementMode::RECTILINEAR);
-            std::cout << "Switched to RECTILINEAR PROGRESSION" << std::endl;
-          } else if (snake->getMode() == Snake::MovementMode::RECTILINEAR) {
-            snake->setMovementMode(Snake::MovementMode::SIMPLE);
-            std::cout << "Switched to SIMPLE MOVEMENT" << std::endl;
-          } else if (snake->getMode() == Snake::MovementMode::SIMPLE) {
-            snake->setMovementMode(Snake::MovementMode::LATERAL);
-            std::cout << "Switched to LATERAL UNDULATION" << std::endl;
-          }
+        // 物理執行緒依 LATERAL -> RECTILINEAR -> SIMPLE 的順序切換
+        static const char* const nextModeNames[] = {"RECTILINEAR PROGRESSION", "SIMPLE MOVEMENT",
+                                                    "LATERAL UNDULATION"};
+        physics->send({PhysicsThread::Command::Type::CYCLE_MOVEMENT_MODE});
+        Snake::MovementMode mode = physicsFrame->movementMode;
+        int next = mode == Snake::MovementMode::LATERAL ? 0 : mode == Snake::MovementMode::RECTILINEAR ? 1 : 2;
+        std::cout << "Switched to " << nextModeNames[next] << std::endl;
+        break;
+      }
+
+      case GLFW_KEY_G: {
+        if (frictionMap) {
+          physics->send({PhysicsThread::Command::Type::TOGGLE_FRICTION_MAP});
+          std::cout << "Friction map " << (physicsFrame->frictionMapOn ? "OFF" : "ON") << std::endl;
         }
         break;
       }
 
-      // 蛇的控制只在遊戲進行中有效
-      case GLFW_KEY_I:
-        if (gameState == GameState::RUNNING && snake) {
-          snake->setSnakeMoveDirection(0, true);
+      case GLFW_KEY_H: {
+        bool analytic = physicsFrame->springIntegrator == Snake::SpringIntegrator::ANALYTIC;
+        physics->send({PhysicsThread::Command::Type::TOGGLE_SPRING_INTEGRATOR});
+        std::cout << "Spring integrator " << (analytic ? "EXPLICIT" : "ANALYTIC") << std::endl;
+        break;
+      }
+
+      case GLFW_KEY_T: {
+        timeScaleIndex = (timeScaleIndex + 1) % NUM_TIME_SCALES;
+        PhysicsThread::Command command{PhysicsThread::Command::Type::SET_TIME_SCALE};
+        command.timeScale = TIME_SCALES[timeScaleIndex];
+        physics->send(command);
+        if (command.timeScale > 0.0f) {
+          std::cout << "Simulation speed x" << command.timeScale << std::endl;
+        } else {
+          std::cout << "Simulation speed MAX" << std::endl;
         }
         break;
+      }
+
+      case GLFW_KEY_R: {
+        // 倒帶 1 秒，只倒帶蛇的狀態，分數、計時與蘋果不變
+        PhysicsThread::Command command{PhysicsThread::Command::Type::REWIND};
+        command.ticks = (int)std::lround(1.0f / physics->getTickDt());
+        physics->send(command);
+        break;
+      }
+
+      // 蛇的控制只在遊戲進行中有效（由物理執行緒判斷）
+      case GLFW_KEY_I:
+        physics->send({PhysicsThread::Command::Type::MOVE, 0, true});
+        break;
       case GLFW_KEY_J:
-        if (gameState == GameState::RUNNING && snake) {
-          snake->setSnakeMoveDirection(1, true);
-        }
+        physics->send({PhysicsThread::Command::Type::MOVE, 1, true});
         break;
       case GLFW_KEY_L:
-        if (gameState == GameState::RUNNING && snake) {
-          snake->setSnakeMoveDirection(2, true);
-        }
+        physics->send({PhysicsThread::Command::Type::MOVE, 2, true});
         break;
       case GLFW_KEY_Y: {
         snakeViewMode = !snakeViewMode;
@@ -1560,13 +1402,13 @@ void keyCallback(GLFWwindow* window, int key, int, int action, int) {
   } else if (action == GLFW_RELEASE) {
     switch (key) {
       case GLFW_KEY_I:
-        if (snake) snake->setSnakeMoveDirection(0, false);
+        physics->send({PhysicsThread::Command::Type::MOVE, 0, false});
         break;
       case GLFW_KEY_J:
-        if (snake) snake->setSnakeMoveDirection(1, false);
+        physics->send({PhysicsThread::Command::Type::MOVE, 1, false});
         break;
       case GLFW_KEY_L:
-        if (snake) snake->setSnakeMoveDirection(2, false);
+        physics->send({PhysicsThread::Command::Type::MOVE, 2, false});
         break;
       default:
         break;
@@ -0,0 +1,996 @@
+// 不開視窗的模擬工具：在伺服器上全速跑 SnakeWorld 與物理基準測試
+//
+//   snake_sim world [--snakes N] [--seconds S] [--dt DT] [--threads N] [--numa] [--analytic] [--seed N]
+//                   [--planner] [--budget US] [--lod]
+//   snake_sim granular [--particles N] [--seconds S] [--dt DT] [--threads N] [--analytic]
+//   snake_sim bench-world [--threads N] [--numa] [--analytic]
+//   snake_sim bench-integrators
+//   snake_sim bench-lod
+//   snake_sim bench-precision
+//   snake_sim sweep --out FILE [--grid NAME=V1,V2,...]... [--random NAME=MIN:MAX]... [--samples N] [--seed N]
+//                   [--seconds S] [--threads N] [--analytic]
+//   snake_sim optimize --bound NAME=MIN:MAX... [--objective distance|cot] [--generations N] [--population N]
+//                      [--seed N] [--seconds S] [--threads N] [--analytic]
+//   snake_sim gradient [--param NAME=V]... [--seconds S] [--checkpoint N] [--check]
+//   snake_sim env [--snakes N] [--seconds S] [--dt DT] [--threads N] [--continuous] [--shm NAME] [--rays N]
+//                 [--see-others]
+//   snake_sim policy [--weights FILE] [--out FILE] [--snakes N] [--seconds S] [--dt DT] [--threads N] [--rays N]
+//                    [--see-others]
+//   snake_sim bench-mlp [--threads N]
+//   snake_sim serve [--socket PATH] [--snakes N] [--seconds S] [--dt DT] [--seed N]
+//   snake_sim client [--socket PATH] [--seconds S]
+//   snake_sim bench-net [--socket PATH] [--snakes N] [--clients N] [--seconds S] [--dt DT]
+//
+// world、sweep、optimize、env、policy、serve、bench-net 都可以加 --friction-map FILE
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "DiffSnake.h"
+#include "GaitOptimizer.h"
+#include "GaitSweep.h"
+#include "GranularBed.h"
+#include "JobSystem.h"
+#include "NetGame.h"
+#include "PhysicsBench.h"
+#include "SnakeWorld.h"
+#include "VecEnv.h"
+
+namespace {
+
+struct Options {
+  std::string command;
+  int snakes = 1000;
+  float seconds = 0.0f;  // 0 表示用各指令的預設值
+  float dt = 1.0f / 60.0f;
+  int threads = 0;  // 0 表示 JobSystem::shared()
+  bool numa = false;
+  bool analytic = false;
+  unsigned int seed = 0;
+  std::string frictionMapFile;
+  const FrictionMap* frictionMap = nullptr;  // main 依 frictionMapFile 讀進來
+  // world
+  bool planner = false;
+  bool lod = false;
+  float budget = -1.0f;  // 負的表示用 PathPlanner::Config 的預設值
+  // granular
+  int particles = 20000;
+  // sweep
+  std::string out;
+  std::vector<gait::GridAxis> grid;
+  std::vector<gait::RandomRange> ranges;
+  int samples = 0;
+  // optimize
+  int generations = 30;
+  int population = 0;
+  gait::GaitOptimizer::Objective objective = gait::GaitOptimizer::Objective::DISTANCE;
+  // gradient
+  gait::GaitParams params;
+  int checkpoint = 0;
+  bool check = false;
+  // env
+  bool continuous = false;
+  std::string shm;
+  int rays = 0;
+  bool seeOthers = false;
+  // policy
+  std::string weights;
+  // serve / client
+  std::string socket = "/tmp/snake.sock";
+  int clients = 4;
+};
+
+void printUsage() {
+  std::cout << "Usage:\n"
+            << "  snake_sim world [--snakes N] [--seconds S] [--dt DT] [--threads N] [--numa] [--analytic] [--seed N]\n"
+            << "                  [--planner] [--budget US] [--lod]\n"
+            << "  snake_sim granular [--particles N] [--seconds S] [--dt DT] [--threads N] [--analytic]\n"
+            << "  snake_sim bench-world [--threads N] [--numa] [--analytic]\n"
+            << "  snake_sim bench-integrators\n"
+            << "  snake_sim bench-lod\n"
+            << "  snake_sim bench-precision\n"
+            << "  snake_sim sweep --out FILE [--grid NAME=V1,V2,...]... [--random NAME=MIN:MAX]... [--samples N]\n"
+            << "                  [--seed N] [--seconds S] [--threads N] [--analytic]\n"
+            << "  snake_sim optimize --bound NAME=MIN:MAX... [--objective distance|cot] [--generations N]\n"
+            << "                     [--population N] [--seed N] [--seconds S] [--threads N] [--analytic]\n"
+            << "  snake_sim gradient [--param NAME=V]... [--seconds S] [--checkpoint N] [--check]\n"
+            << "  snake_sim env [--snakes N] [--seconds S] [--dt DT] [--threads N] [--continuous] [--shm NAME]\n"
+            << "                [--rays N] [--see-others]\n"
+            << "  snake_sim policy [--weights FILE] [--out FILE] [--snakes N] [--seconds S] [--dt DT] [--threads N]\n"
+            << "                   [--rays N] [--see-others]\n"
+            << "  snake_sim bench-mlp [--threads N]\n"
+            << "  snake_sim serve [--socket PATH] [--snakes N] [--seconds S] [--dt DT] [--seed N]\n"
+            << "  snake_sim client [--socket PATH] [--seconds S]\n"
+            << "  snake_sim bench-net [--socket PATH] [--snakes N] [--clients N] [--seconds S] [--dt DT]\n"
+            << "\n"
+            << "  world             N autopilot snakes play for S simulated seconds; finished games restart\n"
+            << "  --planner         autopilot plans around walls and its own body with D* Lite,\n"
+            << "                    spending at most --budget microseconds per snake per step\n"
+            << "  --lod             a viewer stands at the arena corner (0, 0); snakes far from it switch to the\n"
+            << "                    kinematic physics LOD and back when they come near\n"
+            << "  granular          one snake crawls through a sand bed of about N particles, stepped in lockstep;\n"
+            << "                    DT is lowered to the bed's stable step\n"
+            << "  bench-lod         one snake crawls with the full and the kinematic physics LOD, then checks that\n"
+            << "                    SnakeWorld switches a snake to kinematic far from the viewer and back when near\n"
+            << "  --numa            pin threads per NUMA node and shard snakes by node (needs --threads)\n"
+            << "  --analytic        use the analytic spring integrator\n"
+            << "  --friction-map    FILE: world, sweep, optimize, env, policy, serve and bench-net sample ground\n"
+            << "                    friction from this map; gait snakes start at its center and ignore\n"
+            << "                    groundFriction, so give sweep a separate --out per map\n"
+            << "  sweep             crawl straight with every parameter combination, append results to FILE;\n"
+            << "                    rows already in FILE are skipped\n"
+            << "  optimize          CMA-ES over the bounded parameters; numSegments cannot be optimized\n"
+            << "  gradient          adjoint gradient of the crawl distance in the smoothed model;\n"
+            << "                    --checkpoint sets steps between saved states,\n"
+            << "                    --check compares against central finite differences here and on a grid of\n"
+            << "                    springK and damping values over 4 s and 10 s; exits with 1 above 1e-3\n"
+            << "  env               drive the batched RL environment with a scripted policy through its buffers;\n"
+            << "                    --shm places the buffers in POSIX shared memory /NAME for another process\n"
+            << "  policy            run an MLP policy (observations -> forward, turn, frequency, amplitude) on all\n"
+            << "                    snakes each step; random weights without --weights, --out saves them\n"
+            << "  --rays N          append N ray-cast sensors (distance, wall, apple, body) to each observation;\n"
+            << "                    --see-others lets the rays hit the other snakes as if they shared one arena\n"
+            << "  serve             host N snakes on a UNIX socket in real time (one tick per DT) and stream\n"
+            << "                    delta-compressed snapshots; snakes without a client use the autopilot\n"
+            << "  client            connect to a server and steer the assigned snake toward its apple\n"
+            << "  bench-net         a server and --clients clients in one process, as fast as possible\n"
+            << "\n"
+            << "NAME is one of:";
+  for (const auto& name : gait::GaitParams::getNames()) std::cout << " " << name;
+  std::cout << std::endl;
+}
+
+// "name=1,2,3"
+bool parseGridAxis(const std::string& text, gait::GridAxis& axis) {
+  size_t eq = text.find('=');
+  if (eq == std::string::npos) return false;
+  axis.name = text.substr(0, eq);
+  std::stringstream ss(text.substr(eq + 1));
+  std::string value;
+  while (std::getline(ss, value, ',')) axis.values.push_back((float)std::atof(value.c_str()));
+  return !axis.values.empty();
+}
+
+// "name=min:max"
+bool parseRandomRange(const std::string& text, gait::RandomRange& range) {
+  size_t eq = text.find('=');
+  size_t colon = text.find(':', eq);
+  if (eq == std::string::npos || colon == std::string::npos) return false;
+  range.name = text.substr(0, eq);
+  range.min = (float)std::atof(text.substr(eq + 1, colon - eq - 1).c_str());
+  range.max = (float)std::atof(text.substr(colon + 1).c_str());
+  return range.min <= range.max;
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+  if (argc < 2) return false;
+  options.command = argv[1];
+  for (int i = 2; i < argc; ++i) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--snakes" && hasValue) {
+      options.snakes = std::atoi(argv[++i]);
+    } else if (arg == "--seconds" && hasValue) {
+      options.seconds = (float)std::atof(argv[++i]);
+    } else if (arg == "--dt" && hasValue) {
+      options.dt = (float)std::atof(argv[++i]);
+    } else if (arg == "--threads" && hasValue) {
+      options.threads = std::atoi(argv[++i]);
+    } else if (arg == "--seed" && hasValue) {
+      options.seed = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--out" && hasValue) {
+      options.out = argv[++i];
+    } else if (arg == "--samples" && hasValue) {
+      options.samples = std::atoi(argv[++i]);
+    } else if (arg == "--grid" && hasValue) {
+      gait::GridAxis axis;
+      if (!parseGridAxis(argv[++i], axis)) {
+        std::cout << "[ERROR] Bad --grid " << argv[i] << ", expected NAME=V1,V2,..." << std::endl;
+        return false;
+      }
+      options.grid.push_back(axis);
+    } else if ((arg == "--random" || arg == "--bound") && hasValue) {
+      gait::RandomRange range;
+      if (!parseRandomRange(argv[++i], range)) {
+        std::cout << "[ERROR] Bad " << arg << " " << argv[i] << ", expected NAME=MIN:MAX" << std::endl;
+        return false;
+      }
+      options.ranges.push_back(range);
+    } else if (arg == "--param" && hasValue) {
+      gait::GridAxis axis;
+      if (!parseGridAxis(argv[++i], axis) || axis.values.size() != 1 ||
+          !options.params.set(axis.name, axis.values[0])) {
+        std::cout << "[ERROR] Bad --param " << argv[i] << ", expected NAME=V" << std::endl;
+        return false;
+      }
+    } else if (arg == "--checkpoint" && hasValue) {
+      options.checkpoint = std::atoi(argv[++i]);
+    } else if (arg == "--check") {
+      options.check = true;
+    } else if (arg == "--continuous") {
+      options.continuous = true;
+    } else if (arg == "--shm" && hasValue) {
+      options.shm = argv[++i];
+    } else if (arg == "--rays" && hasValue) {
+      options.rays = std::atoi(argv[++i]);
+    } else if (arg == "--see-others") {
+      options.seeOthers = true;
+    } else if (arg == "--socket" && hasValue) {
+      options.socket = argv[++i];
+    } else if (arg == "--clients" && hasValue) {
+      options.clients = std::atoi(argv[++i]);
+    } else if (arg == "--weights" && hasValue) {
+      options.weights = argv[++i];
+    } else if (arg == "--generations" && hasValue) {
+      options.generations = std::atoi(argv[++i]);
+    } else if (arg == "--population" && hasValue) {
+      options.population = std::atoi(argv[++i]);
+    } else if (arg == "--objective" && hasValue) {
+      std::string objective = argv[++i];
+      if (objective == "distance") {
+        options.objective = gait::GaitOptimizer::Objective::DISTANCE;
+      } else if (objective == "cot") {
+        options.objective = gait::GaitOptimizer::Objective::COST_OF_TRANSPORT;
+      } else {
+        std::cout << "[ERROR] Unknown objective: " << objective << std::endl;
+        return false;
+      }
+    } else if (arg == "--planner") {
+      options.planner = true;
+    } else if (arg == "--lod") {
+      options.lod = true;
+    } else if (arg == "--budget" && hasValue) {
+      options.budget = (float)std::atof(argv[++i]);
+    } else if (arg == "--particles" && hasValue) {
+      options.particles = std::atoi(argv[++i]);
+    } else if (arg == "--numa") {
+      options.numa = true;
+    } else if (arg == "--analytic") {
+      options.analytic = true;
+    } else if (arg == "--friction-map" && hasValue) {
+      options.frictionMapFile = argv[++i];
+    } else {
+      std::cout << "[ERROR] Unknown option: " << arg << std::endl;
+      return false;
+    }
+  }
+  if (options.snakes <= 0 || options.particles <= 0 || options.seconds < 0.0f || options.dt <= 0.0f) {
+    std::cout << "[ERROR] --snakes, --particles, --seconds and --dt must be positive" << std::endl;
+    return false;
+  }
+  if (options.command == "sweep" && options.out.empty()) {
+    std::cout << "[ERROR] sweep needs --out" << std::endl;
+    return false;
+  }
+  if (options.command == "sweep" && !options.grid.empty() && !options.ranges.empty()) {
+    std::cout << "[ERROR] Use either --grid or --random, not both" << std::endl;
+    return false;
+  }
+  if (options.numa && options.threads <= 0) {
+    std::cout << "[ERROR] --numa needs --threads" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+std::unique_ptr<JobSystem> createJobSystem(const Options& options) {
+  if (options.threads <= 0) return nullptr;
+  if (options.numa) return std::make_unique<JobSystem>(options.threads, JobSystem::Topology::detect(), true);
+  return std::make_unique<JobSystem>(options.threads);
+}
+
+Snake::SpringIntegrator getIntegrator(const Options& options) {
+  return options.analytic ? Snake::SpringIntegrator::ANALYTIC : Snake::SpringIntegrator::EXPLICIT;
+}
+
+// ========== world ==========
+
+int runWorld(Options options) {
+  if (options.seconds == 0.0f) options.seconds = 60.0f;
+  std::unique_ptr<JobSystem> jobs = createJobSystem(options);
+  SnakeWorld world(SnakeWorld::Rules(), jobs.get());
+  world.reserve(options.snakes);
+
+  SnakeWorld::SnakeParams params;
+  params.integrator = getIntegrator(options);
+  params.frictionMap = options.frictionMap;
+  for (int i = 0; i < options.snakes; ++i) {
+    world.addSnake(params, glm::vec3(4.0f, 0.5f, 2.5f), options.seed + (unsigned int)i);
+  }
+  if (options.numa) world.shardByNode();
+  PathPlanner::Config plannerConfig;
+  if (options.budget >= 0.0f) plannerConfig.budgetMicros = options.budget;
+  for (int i = 0; i < options.snakes; ++i) {
+    if (options.planner) {
+      world.setPlannedAutopilot(i, plannerConfig);
+    } else {
+      world.setAutopilot(i, true);
+    }
+  }
+  world.startAll();
+  if (options.lod) world.setViewer(glm::vec3(0.0f, 1.0f, 0.0f));
+
+  std::cout << "[INFO] " << options.snakes << " snakes, " << options.seconds << " s at dt = " << options.dt << " s, "
+            << world.getNumThreads() << " thread(s), " << world.getNumShards() << " shard(s)" << std::endl;
+
+  long long wins = 0, wallLosses = 0, timeLosses = 0, apples = 0, kinematicFrames = 0;
+  auto collect = [&](const SnakeWorld::Agent& agent) {
+    apples += agent.score;
+    if (agent.result == SnakeWorld::GameResult::WIN) {
+      ++wins;
+    } else if (agent.hitWall) {
+      ++wallLosses;
+    } else {
+      ++timeLosses;
+    }
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  int frames = (int)std::ceil(options.seconds / options.dt);
+  for (int f = 0; f < frames; ++f) {
+    world.step(options.dt);
+    if (options.lod) kinematicFrames += world.countLod(Snake::PhysicsLod::KINEMATIC);
+    // 結束的遊戲記下結果後馬上重新開始
+    for (int i = 0; i < options.snakes; ++i) {
+      const SnakeWorld::Agent& agent = world.getAgent(i);
+      if (agent.state != SnakeWorld::GameState::RUNNING) {
+        collect(agent);
+        world.start(i);
+      }
+    }
+  }
+  double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  const SnakeWorld::Stats& stats = world.getStats();
+  std::cout << "[RESULT] games finished: " << (wins + wallLosses + timeLosses) << " (win " << wins << ", hit wall "
+            << wallLosses << ", time up " << timeLosses << "), apples eaten: " << apples << std::endl;
+  std::cout << "[RESULT] wall time: " << wallSeconds << " s, steps/s: " << stats.stepsPerSecond()
+            << ", sim-s/s: " << (wallSeconds > 0.0 ? options.snakes * (double)options.dt * frames / wallSeconds : 0.0)
+            << std::endl;
+  if (options.lod) {
+    double snakeFrames = (double)options.snakes * frames;
+    std::cout << "[RESULT] kinematic LOD: " << 100.0 * kinematicFrames / std::max(1.0, snakeFrames)
+              << "% of snake-frames" << std::endl;
+  }
+  if (options.planner) {
+    PathPlanner::Stats total;
+    for (int i = 0; i < options.snakes; ++i) {
+      const PathPlanner::Stats& planner = world.getAgent(i).planner->getStats();
+      total.plans += planner.plans;
+      total.expansions += planner.expansions;
+      total.searches += planner.searches;
+      total.incomplete += planner.incomplete;
+      total.overBudget += planner.overBudget;
+      total.noPath += planner.noPath;
+      total.totalMicros += planner.totalMicros;
+      total.maxMicros = std::max(total.maxMicros, planner.maxMicros);
+    }
+    double plans = (double)std::max(1LL, total.plans);
+    std::cout << "[RESULT] planner: " << total.totalMicros / plans << " us per plan (max " << total.maxMicros
+              << " us, budget " << plannerConfig.budgetMicros << " us), " << total.expansions / plans
+              << " expansions per plan, " << total.searches << " full searches, " << 100.0 * total.incomplete / plans
+              << "% stopped by the budget, " << 100.0 * total.overBudget / plans << "% over budget, "
+              << 100.0 * total.noPath / plans << "% without a path" << std::endl;
+  }
+  for (int n = 0; n < (int)stats.nodes.size(); ++n) {
+    std::cout << "[RESULT] node " << n << ": " << stats.nodes[n].snakes << " snakes, " << stats.nodeStepsPerSecond(n)
+              << " steps/s, " << stats.nodes[n].remoteSteps << " steps stolen by other nodes" << std::endl;
+  }
+  return 0;
+}
+
+// ========== granular ==========
+
+// 沙床鋪在蛇的周圍，層數依粒子數決定（整層，所以粒子數是大約）；蛇按住前進，每一步先推進沙床再推進蛇
+int runGranular(Options options) {
+  if (options.seconds == 0.0f) options.seconds = 0.2f;
+  std::unique_ptr<JobSystem> jobs = createJobSystem(options);
+
+  SnakeWorld::SnakeParams params;
+  Snake snake(params.numSegments, params.segmentMass, params.segmentLength, params.springK, params.damping,
+              glm::vec3(1.0f, 0.5f, 0.5f), params.radius);
+  snake.setObserved(true);
+  snake.setMovementMode(Snake::MovementMode::RECTILINEAR);
+  snake.setSpringIntegrator(getIntegrator(options));
+
+  glm::vec3 lo(INFINITY), hi(-INFINITY);
+  for (const Mass* mass : snake.getMasses()) {
+    lo = glm::min(lo, mass->getPosition());
+    hi = glm::max(hi, mass->getPosition());
+  }
+  const float margin = params.radius + 0.1f;
+  glm::vec3 bedMin(lo.x - margin, 0.0f, lo.z - margin);
+  glm::vec3 bedMax(hi.x + margin, 2.0f * params.radius, hi.z + margin);
+
+  GranularBed::Params bedParams;
+  bedParams.jobs = jobs.get();
+  const float spacing = 2.0f * bedParams.particleRadius * 1.01f;  // 與 fillBox 相同
+  const float perLayer = (bedMax.x - bedMin.x) * (bedMax.z - bedMin.z) / (spacing * spacing);
+  const float depth = std::max(1.0f, std::round(options.particles / perLayer)) * spacing;
+  bedMax.y = std::max(bedMax.y, depth);
+  GranularBed bed(bedParams, bedMin, bedMax);
+  bed.fillBox(bedMin, glm::vec3(bedMax.x, depth, bedMax.z), options.seed);
+  int removed = 0;
+  for (const Mass* mass : snake.getMasses()) removed += bed.removeInside(mass->getPosition(), params.radius);
+
+  float dt = std::min({options.dt, bed.getMaxStableDt(), snake.getMaxSubDt()});
+  int steps = (int)std::ceil(options.seconds / dt);
+  std::cout << "[INFO] " << bed.getParticleCount() << " particles (" << removed << " removed around the snake), bed "
+            << depth * 100.0f << " cm deep, " << steps << " steps of " << dt * 1e6f << " us" << std::endl;
+
+  glm::vec3 start = snake.getHeadPosition();
+  snake.setSnakeMoveDirection(0, true);
+  auto began = std::chrono::steady_clock::now();
+  for (int i = 0; i < steps; ++i) {
+    bed.step(dt, &snake);
+    snake.update(dt);
+  }
+  double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - began).count();
+
+  const GranularBed::Stats& stats = bed.getStats();
+  std::cout << "[RESULT] wall time: " << wallSeconds << " s, bed " << stats.elapsedMs / steps << " ms per step, "
+            << stats.particlesPerMs() << " particle-steps/ms, sim-s/s: " << options.seconds / wallSeconds << std::endl;
+  std::cout << "[RESULT] head moved " << glm::length(snake.getHeadPosition() - start) * 100.0f << " cm" << std::endl;
+  return 0;
+}
+
+// ========== sweep ==========
+
+int runSweep(const Options& options) {
+  gait::EvalSettings settings;
+  if (options.seconds > 0.0f) settings.simSeconds = options.seconds;
+  settings.integrator = getIntegrator(options);
+  settings.frictionMap = options.frictionMap;
+
+  std::vector<gait::GaitParams> points;
+  if (!options.ranges.empty()) {
+    points = gait::makeRandom(gait::GaitParams(), options.ranges, options.samples > 0 ? options.samples : 100,
+                              options.seed);
+  } else {
+    points = gait::makeGrid(gait::GaitParams(), options.grid);
+  }
+  if (points.empty()) {
+    std::cout << "[ERROR] No parameter points to evaluate" << std::endl;
+    return 1;
+  }
+
+  gait::ResultTable table;
+  if (!table.open(options.out)) return 1;
+
+  std::unique_ptr<JobSystem> ownJobs = createJobSystem(options);
+  JobSystem& jobs = ownJobs ? *ownJobs : JobSystem::shared();
+  std::cout << "[INFO] " << points.size() << " points, " << settings.simSeconds << " s each, " << jobs.getNumThreads()
+            << " thread(s), results in " << options.out << std::endl;
+
+  gait::SweepStats stats = gait::run(points, settings, table, jobs);
+  std::cout << "[RESULT] evaluated " << stats.evaluated << " (" << stats.unstable << " unstable), skipped "
+            << stats.skipped << " already done, " << stats.wallSeconds << " s" << std::endl;
+  return 0;
+}
+
+// ========== optimize ==========
+
+void printParams(const gait::GaitParams& params) {
+  std::cout << "numSegments=" << params.numSegments << " springK=" << params.springK << " damping=" << params.damping
+            << " waveAmplitude=" << params.waveAmplitude << " waveFrequency=" << params.waveFrequency
+            << " groundFriction=" << params.groundFriction;
+}
+
+int runOptimize(const Options& options) {
+  gait::EvalSettings evalSettings;
+  if (options.seconds > 0.0f) evalSettings.simSeconds = options.seconds;
+  evalSettings.integrator = getIntegrator(options);
+  evalSettings.frictionMap = options.frictionMap;
+
+  gait::GaitOptimizer::Settings settings;
+  settings.bounds = options.ranges;
+  settings.objective = options.objective;
+  settings.populationSize = options.population;
+  settings.seed = options.seed;
+
+  std::unique_ptr<JobSystem> ownJobs = createJobSystem(options);
+  JobSystem& jobs = ownJobs ? *ownJobs : JobSystem::shared();
+  gait::GaitOptimizer optimizer(gait::GaitParams(), settings, evalSettings, jobs);
+  if (!optimizer.isValid()) return 1;
+
+  std::cout << "[INFO] CMA-ES over " << settings.bounds.size() << " parameter(s), population "
+            << optimizer.getPopulationSize() << ", " << options.generations << " generations, "
+            << evalSettings.simSeconds << " s per episode, " << jobs.getNumThreads() << " thread(s)" << std::endl;
+  for (int g = 0; g < options.generations; ++g) {
+    const gait::GaitOptimizer::Generation& gen = optimizer.step();
+    std::cout << "[GEN " << gen.index << "] best " << gen.bestFitness << ", mean " << gen.meanFitness << ", unstable "
+              << gen.unstable << ", sigma " << gen.sigma << ", " << gen.wallMs << " ms | ";
+    printParams(gen.best);
+    std::cout << std::endl;
+  }
+
+  std::cout << "[RESULT] best fitness " << optimizer.getBestFitness() << ": ";
+  printParams(optimizer.getBest());
+  std::cout << std::endl;
+  return 0;
+}
+
+// ========== gradient ==========
+
+// 中央差分，每個參數跑兩次前向，回傳最大的相對誤差。模型是 double，步長可以很小；waveFrequency 改變的是相位
+// omega * t，影響隨模擬時間變大，步長再除以模擬秒數（1e-3 的相對步長在預設的 10 s 就差了 0.5%）
+double checkGradient(gait::DiffSnake& model, const gait::GaitParams& params, const gait::DiffSnake::Result& result,
+                     float simSeconds, bool verbose) {
+  double maxError = 0.0;
+  for (int p = 0; p < gait::DiffSnake::NUM_PARAMS; ++p) {
+    std::string name = gait::DiffSnake::getParamName(p);
+    gait::GaitParams plus = params, minus = params;
+    float value = params.get(name);
+    float eps = 1e-5f * std::max(1.0f, std::abs(value));
+    if (name == "waveFrequency") eps /= std::max(1.0f, simSeconds);
+    plus.set(name, value + eps);
+    minus.set(name, value - eps);
+    double numeric =
+        (model.rollout(plus).distance - model.rollout(minus).distance) / ((double)(value + eps) - (value - eps));
+    double error = std::abs(result.gradient[p] - numeric) / std::max(std::abs(numeric), 1e-12);
+    if (!(error <= maxError)) maxError = error;  // NaN 也算最大
+    if (verbose) {
+      std::cout << "[CHECK] " << name << ": adjoint " << result.gradient[p] << ", finite difference " << numeric
+                << ", relative error " << error << std::endl;
+    }
+  }
+  return maxError;
+}
+
+int runGradient(const Options& options) {
+  gait::EvalSettings evalSettings;
+  if (options.seconds > 0.0f) evalSettings.simSeconds = options.seconds;
+  gait::DiffSnake model(options.params.numSegments, evalSettings, options.checkpoint);
+
+  gait::DiffSnake::Result forward = model.rollout(options.params);
+  gait::DiffSnake::Result result = model.gradient(options.params);
+  std::cout << "[INFO] " << result.steps << " steps, " << result.checkpoints << " checkpoints every "
+            << model.getCheckpointInterval() << " steps, " << result.stateBytes / 1024.0 << " KiB of states"
+            << std::endl;
+  std::cout << "[RESULT] distance " << result.distance << " m" << std::endl;
+  if (!result.valid) return 1;
+  for (int p = 0; p < gait::DiffSnake::NUM_PARAMS; ++p) {
+    std::cout << "  d/d " << gait::DiffSnake::getParamName(p) << " = " << result.gradient[p] << std::endl;
+  }
+  std::cout << "[TIME] rollout " << forward.forwardMs << " ms, gradient " << result.forwardMs + result.backwardMs
+            << " ms (" << (result.forwardMs + result.backwardMs) / std::max(forward.forwardMs, 1e-6) << "x)"
+            << std::endl;
+  if (!options.check) return 0;
+
+  const double tolerance = 1e-3;
+  bool ok = checkGradient(model, options.params, result, evalSettings.simSeconds, true) <= tolerance;
+
+  // 再掃過幾組彈簧參數與較長的回合，只在預設點附近對的梯度會在這裡露出來
+  for (float seconds : {4.0f, 10.0f}) {
+    gait::EvalSettings gridSettings = evalSettings;
+    gridSettings.simSeconds = seconds;
+    gait::DiffSnake gridModel(options.params.numSegments, gridSettings, options.checkpoint);
+    for (float springK : {0.5f, 1.0f, 2.0f, 3.0f}) {
+      for (float damping : {1.0f, 3.5f}) {
+        gait::GaitParams params = options.params;
+        params.springK = springK;
+        params.damping = damping;
+        gait::DiffSnake::Result point = gridModel.gradient(params);
+        double error = point.valid ? checkGradient(gridModel, params, point, seconds, false) : INFINITY;
+        bool pass = error <= tolerance;
+        ok = ok && pass;
+        std::cout << "[CHECK] springK " << springK << ", damping " << damping << ", " << seconds
+                  << " s: max relative error " << error << (pass ? "" : "  FAILED") << std::endl;
+      }
+    }
+  }
+  return ok ? 0 : 1;
+}
+
+// ========== env ==========
+
+// 給 VecEnv 用的共享記憶體，其他行程可以用同一個名字 mmap 同一塊
+class SharedBlock {
+ public:
+  SharedBlock() = default;
+  DELETE_COPY(SharedBlock)
+  ~SharedBlock() {
+#ifndef _WIN32
+    if (memory) munmap(memory, size);
+    if (!name.empty()) shm_unlink(name.c_str());
+#endif
+  }
+
+  bool create(const std::string& shmName, size_t bytes) {
+#ifndef _WIN32
+    name = "/" + shmName;
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0600);
+    if (fd < 0 || ftruncate(fd, (off_t)bytes) != 0) {
+      std::cout << "[ERROR] Cannot create shared memory " << name << std::endl;
+      if (fd >= 0) close(fd);
+      name.clear();
+      return false;
+    }
+    void* mapped = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+      std::cout << "[ERROR] Cannot map shared memory " << name << std::endl;
+      return false;
+    }
+    memory = mapped;
+    size = bytes;
+    return true;
+#else
+    (void)shmName;
+    (void)bytes;
+    std::cout << "[ERROR] --shm is only supported on POSIX systems" << std::endl;
+    return false;
+#endif
+  }
+
+  void* getMemory() const { return memory; }
+
+ private:
+  std::string name;
+  void* memory = nullptr;
+  size_t size = 0;
+};
+
+int runEnv(Options options) {
+  if (options.seconds == 0.0f) options.seconds = 60.0f;
+  std::unique_ptr<JobSystem> jobs = createJobSystem(options);
+
+  VecEnv::Config config;
+  config.numEnvs = options.snakes;
+  config.actionMode = options.continuous ? VecEnv::ActionMode::CONTINUOUS : VecEnv::ActionMode::BUTTONS;
+  config.dt = options.dt;
+  config.seed = options.seed;
+  config.snake.integrator = getIntegrator(options);
+  config.snake.frictionMap = options.frictionMap;
+  config.rays.numRays = options.rays;
+  config.rays.seeOtherSnakes = options.seeOthers;
+  VecEnv env(config, jobs.get());
+
+  VecEnv::Layout layout = VecEnv::getLayout(config);
+  SharedBlock shared;
+  if (!options.shm.empty()) {
+    if (!shared.create(options.shm, layout.totalSize)) return 1;
+    if (!env.bindBlock(shared.getMemory(), layout.totalSize)) return 1;
+    std::cout << "[INFO] Buffers in /" << options.shm << ", " << layout.totalSize << " bytes: actions@" << layout.actions
+              << " observations@" << layout.observations << " rewards@" << layout.rewards << " terminated@"
+              << layout.terminated << " truncated@" << layout.truncated << " finalObservations@"
+              << layout.finalObservations << std::endl;
+  }
+  std::cout << "[INFO] " << config.numEnvs << " environments, "
+            << (options.continuous ? "continuous" : "button") << " actions, " << env.getWorld().getNumThreads()
+            << " thread(s)" << std::endl;
+
+  // 腳本策略：直接讀觀察陣列、寫動作陣列，和訓練程式的用法相同
+  const VecEnv::Buffers& buffers = env.getBuffers();
+  const int actionSize = env.getActionSize();
+  const int observationSize = env.getObservationSize();
+  std::vector<double> returns(config.numEnvs, 0.0);
+  double finishedReturn = 0.0;
+  long long terminated = 0, truncated = 0;
+
+  env.reset();
+  auto start = std::chrono::steady_clock::now();
+  int frames = (int)std::ceil(options.seconds / options.dt);
+  for (int f = 0; f < frames; ++f) {
+    for (int i = 0; i < config.numEnvs; ++i) {
+      const float* obs = buffers.observations + (size_t)i * observationSize;
+      float* action = buffers.actions + (size_t)i * actionSize;
+      float right = obs[5] / std::max(obs[6], 0.1f);
+      if (options.continuous) {
+        action[0] = 1.0f;
+        action[1] = std::clamp(2.0f * right, -1.0f, 1.0f);
+      } else {
+        action[0] = 1.0f;
+        action[1] = right < -0.1f ? 1.0f : 0.0f;
+        action[2] = right > 0.1f ? 1.0f : 0.0f;
+      }
+    }
+    env.step();
+    for (int i = 0; i < config.numEnvs; ++i) {
+      returns[i] += buffers.rewards[i];
+      if (buffers.terminated[i] || buffers.truncated[i]) {
+        terminated += buffers.terminated[i];
+        truncated += buffers.truncated[i];
+        finishedReturn += returns[i];
+        returns[i] = 0.0;
+      }
+    }
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  long long episodes = env.getEpisodeCount();
+  std::cout << "[RESULT] " << (double)frames * config.numEnvs / seconds << " env steps/s, " << episodes
+            << " episodes (" << terminated << " terminated, " << truncated << " truncated), mean return "
+            << (episodes > 0 ? finishedReturn / episodes : 0.0) << std::endl;
+  return 0;
+}
+
+// ========== policy ==========
+
+int runPolicy(Options options) {
+  if (options.seconds == 0.0f) options.seconds = 60.0f;
+  VecEnv::Config config;
+  config.numEnvs = options.snakes;
+  config.actionMode = VecEnv::ActionMode::CONTINUOUS_GAIT;
+  config.dt = options.dt;
+  config.seed = options.seed;
+  config.snake.integrator = getIntegrator(options);
+  config.snake.frictionMap = options.frictionMap;
+  config.rays.numRays = options.rays;
+  config.rays.seeOtherSnakes = options.seeOthers;
+  const int observationSize = VecEnv::getObservationSize(config);
+  const int actionSize = VecEnv::getActionSize(config.actionMode);
+
+  std::unique_ptr<MlpPolicy> policy;
+  if (options.weights.empty()) {
+    policy = std::make_unique<MlpPolicy>(MlpPolicy::createRandom(
+        {observationSize, 64, 64, actionSize}, MlpPolicy::Activation::TANH, MlpPolicy::Activation::TANH, options.seed));
+  } else {
+    policy.reset(MlpPolicy::fromFile(options.weights.c_str()));
+    if (!policy) return 1;
+  }
+  if (!options.out.empty() && !policy->save(options.out.c_str())) return 1;
+  if (policy->getInputSize() != observationSize || policy->getOutputSize() != actionSize) {
+    std::cout << "[ERROR] Policy must map " << observationSize << " observations to " << actionSize << " actions, got "
+              << policy->getInputSize() << " -> " << policy->getOutputSize() << std::endl;
+    return 1;
+  }
+  std::unique_ptr<JobSystem> ownJobs = createJobSystem(options);
+  JobSystem& jobs = ownJobs ? *ownJobs : JobSystem::shared();
+  VecEnv env(config, &jobs);
+  std::cout << "[INFO] " << config.numEnvs << " snakes, policy with " << policy->getNumLayers() << " layers, "
+            << jobs.getNumThreads() << " thread(s)" << std::endl;
+
+  // 觀察直接當網路的輸入，網路的輸出直接寫進動作陣列
+  const VecEnv::Buffers& buffers = env.getBuffers();
+  double inferenceSeconds = 0.0;
+  env.reset();
+  auto start = std::chrono::steady_clock::now();
+  int frames = (int)std::ceil(options.seconds / options.dt);
+  for (int f = 0; f < frames; ++f) {
+    auto inferenceStart = std::chrono::steady_clock::now();
+    policy->forward(buffers.observations, config.numEnvs, buffers.actions, jobs);
+    inferenceSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - inferenceStart).count();
+    env.step();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::cout << "[RESULT] " << (double)frames * config.numEnvs / seconds << " env steps/s, inference "
+            << inferenceSeconds * 1e6 / frames << " us per batch of " << config.numEnvs << " ("
+            << 100.0 * inferenceSeconds / seconds << "% of the loop), " << env.getEpisodeCount() << " episodes"
+            << std::endl;
+  return 0;
+}
+
+// ========== 多人連線 ==========
+
+net::GameServer::Config getServerConfig(const Options& options) {
+  net::GameServer::Config config;
+  config.socketPath = options.socket;
+  config.numSnakes = options.snakes;
+  config.tickRate = 1.0f / options.dt;
+  config.seed = options.seed;
+  config.snake.integrator = getIntegrator(options);
+  config.snake.frictionMap = options.frictionMap;
+  return config;
+}
+
+void printServerStats(const net::GameServer& server, double seconds) {
+  const net::GameServer::Stats& stats = server.getStats();
+  long long sent = std::max(1LL, stats.snapshotsSent);
+  std::cout << "[STATS] tick " << server.getTick() << ", " << server.getNumClients() << " client(s), "
+            << stats.snapshotsSent << " snapshots (" << stats.fullSnapshots << " full, " << stats.snapshotsDropped
+            << " dropped), " << stats.bytesSent / sent << " bytes/snapshot, " << stats.bytesSent / 1024.0 / seconds
+            << " KiB/s, step " << stats.stepMs * 1000.0 / std::max(1LL, stats.ticks) << " us/tick, encode "
+            << stats.encodeMs * 1000.0 / std::max(1LL, stats.encodes) << " us/encode" << std::endl;
+}
+
+// 只在按下 Ctrl-C 或 --seconds 到了時停止；每秒印一次統計
+int runServe(Options options) {
+  net::GameServer server(getServerConfig(options));
+  if (!server.start()) return 1;
+  std::cout << "[INFO] Serving " << options.snakes << " snakes on " << options.socket << " at " << 1.0f / options.dt
+            << " ticks/s" << std::endl;
+
+  const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::duration<double>(options.dt));
+  const auto duration = std::chrono::duration<float>(options.seconds);
+  auto start = std::chrono::steady_clock::now();
+  auto next = start, report = start + std::chrono::seconds(1);
+  while (options.seconds == 0.0f || std::chrono::steady_clock::now() - start < duration) {
+    server.tick();
+    next += period;
+    std::this_thread::sleep_until(next);
+    auto now = std::chrono::steady_clock::now();
+    if (now >= report) {
+      printServerStats(server, 1.0);
+      server.resetStats();
+      report += std::chrono::seconds(1);
+    }
+  }
+  return 0;
+}
+
+// 和自動駕駛一樣往蘋果轉，但只看得到收到的快照
+void steerClient(net::GameClient& client) {
+  const std::vector<net::SnakeView>& snakes = client.getSnakes();
+  int index = client.getSnakeIndex();
+  if (index < 0 || index >= (int)snakes.size() || snakes[index].masses.size() < 2) {
+    client.sendInput(false, false, false);
+    return;
+  }
+  const net::SnakeView& view = snakes[index];
+  glm::vec3 forward = view.masses[0] - view.masses[1], toApple = view.applePosition - view.masses[0];
+  forward.y = toApple.y = 0.0f;
+  if (glm::length(forward) < 1e-4f || glm::length(toApple) < 1e-4f) {
+    client.sendInput(true, false, false);
+    return;
+  }
+  float side = glm::cross(glm::normalize(forward), glm::normalize(toApple)).y;
+  client.sendInput(true, side > 0.1f, side < -0.1f);
+}
+
+int runClient(Options options) {
+  if (options.seconds == 0.0f) options.seconds = 10.0f;
+  net::GameClient client;
+  if (!client.connect(options.socket)) return 1;
+  auto start = std::chrono::steady_clock::now(), report = start + std::chrono::seconds(1);
+  uint32_t lastTick = 0;
+  while (std::chrono::steady_clock::now() - start < std::chrono::duration<float>(options.seconds)) {
+    if (!client.poll()) {
+      std::cout << "[ERROR] Server closed the connection" << std::endl;
+      return 1;
+    }
+    if (client.getTick() != lastTick) {
+      lastTick = client.getTick();
+      steerClient(client);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    if (std::chrono::steady_clock::now() >= report) {
+      const net::GameClient::Stats& stats = client.getStats();
+      int index = client.getSnakeIndex();
+      std::cout << "[STATS] tick " << client.getTick() << ", snake " << index << ", score "
+                << (index >= 0 && index < (int)client.getSnakes().size() ? client.getSnakes()[index].score : 0)
+                << ", " << stats.snapshots << " snapshots (" << stats.fullSnapshots << " full, " << stats.undecodable
+                << " undecodable), " << stats.bytesReceived / 1024.0 << " KiB, decode "
+                << stats.decodeMs * 1000.0 / std::max(1LL, stats.snapshots) << " us/snapshot" << std::endl;
+      report += std::chrono::seconds(1);
+    }
+  }
+  return 0;
+}
+
+// 伺服器與所有 client 在同一個執行緒輪流跑，不等待，量的是每個 tick 的成本和頻寬
+int runBenchNet(Options options) {
+  if (options.seconds == 0.0f) options.seconds = 10.0f;
+  net::GameServer server(getServerConfig(options));
+  if (!server.start()) return 1;
+  std::vector<std::unique_ptr<net::GameClient>> clients;
+  for (int c = 0; c < options.clients; ++c) {
+    clients.push_back(std::make_unique<net::GameClient>());
+    if (!clients.back()->connect(options.socket)) return 1;
+  }
+
+  int ticks = (int)std::ceil(options.seconds / options.dt);
+  auto start = std::chrono::steady_clock::now();
+  for (int t = 0; t < ticks; ++t) {
+    server.tick();
+    for (auto& client : clients) {
+      if (!client->poll()) {
+        std::cout << "[ERROR] Server closed the connection" << std::endl;
+        return 1;
+      }
+      steerClient(*client);
+    }
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::cout << "[RESULT] " << ticks / seconds << " ticks/s wall clock (" << options.seconds << " simulated s)"
+            << std::endl;
+  printServerStats(server, options.seconds);
+  long long snapshots = 0, full = 0, undecodable = 0, rawBytes = 0;
+  for (int i = 0; i < server.getWorld().getNumSnakes(); ++i) {
+    rawBytes += 2 * (6 + 3 * (long long)server.getWorld().getSnake(i)->getMasses().size());
+  }
+  double decodeMs = 0.0;
+  for (auto& client : clients) {
+    snapshots += client->getStats().snapshots;
+    full += client->getStats().fullSnapshots;
+    undecodable += client->getStats().undecodable;
+    decodeMs += client->getStats().decodeMs;
+  }
+  std::cout << "[RESULT] clients: " << snapshots << " snapshots (" << full << " full, " << undecodable
+            << " undecodable), decode " << decodeMs * 1000.0 / std::max(1LL, snapshots) << " us/snapshot; "
+            << "an uncompressed snapshot is " << rawBytes << " bytes" << std::endl;
+  return 0;
+}
+
+// ========== 基準測試 ==========
+
+int runBenchWorld(const Options& options) {
+  bench::WorldScenario scenario;
+  scenario.numThreads = options.threads;
+  scenario.numaAware = options.numa;
+  scenario.integrator = getIntegrator(options);
+  int threadsUsed = 0;
+  std::vector<bench::WorldResult> results = bench::runWorldScaling(scenario, &threadsUsed);
+  bench::printWorldReport(std::cout, scenario, threadsUsed, results);
+  return 0;
+}
+
+int runBenchIntegrators() {
+  bench::IntegratorScenario scenario;
+  bench::printIntegratorReport(std::cout, scenario, bench::runIntegratorComparison(scenario));
+  return 0;
+}
+
+int runBenchLod() {
+  bench::LodScenario scenario;
+  bench::printLodReport(std::cout, scenario, bench::runLodComparison(scenario));
+  return bench::checkLodSwitching(std::cout) ? 0 : 1;
+}
+
+int runBenchMlp(const Options& options) {
+  bench::InferenceScenario scenario;
+  scenario.numThreads = options.threads;
+  int threadsUsed = 0;
+  std::vector<bench::InferenceResult> results = bench::runInferenceBenchmark(scenario, &threadsUsed);
+  bench::printInferenceReport(std::cout, scenario, threadsUsed, results);
+  return 0;
+}
+
+int runBenchPrecision() {
+  bench::ChainScenario scenario;
+  bench::printPrecisionReport(std::cout, scenario, bench::runPrecisionComparison(scenario));
+  return 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage();
+    return 1;
+  }
+  std::unique_ptr<FrictionMap> frictionMap;
+  if (!options.frictionMapFile.empty()) {
+    frictionMap.reset(FrictionMap::fromFile(options.frictionMapFile.c_str()));
+    if (!frictionMap) return 1;
+    options.frictionMap = frictionMap.get();
+  }
+
+  if (options.command == "world") return runWorld(options);
+  if (options.command == "granular") return runGranular(options);
+  if (options.command == "bench-world") return runBenchWorld(options);
+  if (options.command == "bench-integrators") return runBenchIntegrators();
+  if (options.command == "bench-precision") return runBenchPrecision();
+  if (options.command == "bench-lod") return runBenchLod();
+  if (options.command == "sweep") return runSweep(options);
+  if (options.command == "optimize") return runOptimize(options);
+  if (options.command == "gradient") return runGradient(options);
+  if (options.command == "env") return runEnv(options);
+  if (options.command == "policy") return runPolicy(options);
+  if (options.command == "bench-mlp") return runBenchMlp(options);
+  if (options.command == "serve") return runServe(options);
+  if (options.command == "client") return runClient(options);
+  if (options.command == "bench-net") return runBenchNet(options);
+
+  std::cout << "[ERROR] Unknown command: " << options.command << std::endl;
+  printUsage();
+  return 1;
+}